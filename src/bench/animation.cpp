@@ -0,0 +1,98 @@
+// Measures Animations::update for many instances. Sprites are made up, so no
+// data file or display is needed: one with four 100 ms frames, one with eight
+// frames of varying length, and a single-frame one. Instances start at
+// different times, so their frames do not all change together.
+//
+// Usage: bench-animation [--seconds S]
+
+#include "animation.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Indexed like r::Sprite, so that the enum values can be used to add
+// instances; only the frame counts and durations matter
+std::vector<Sprite> makeSprites()
+{
+    auto sprites = std::vector<Sprite>(r::spriteCount);
+    for (size_t i = 0; i < sprites.size(); i++) {
+        switch (i % 3) {
+            case 0:
+                sprites[i].frames.assign(4, Frame{.rect = {}, .duration = 100});
+                break;
+            case 1:
+                for (int frame = 0; frame < 8; frame++) {
+                    sprites[i].frames.push_back(
+                        Frame{.rect = {}, .duration = 40 + 20 * frame});
+                }
+                break;
+            default:
+                sprites[i].frames.push_back(Frame{.rect = {}, .duration = 100});
+                break;
+        }
+    }
+    return sprites;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    double seconds = 1.0;
+    for (int i = 1; i < argc; i++) {
+        auto arg = std::string_view{argv[i]};
+        if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        } else {
+            std::cerr << "usage: bench-animation [--seconds S]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    static constexpr float delta = 1.f / 240;
+
+    auto sprites = makeSprites();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(10) << "instances" << std::setw(10) << "updates" <<
+        std::setw(14) << "us/update" << std::setw(14) << "ns/instance" <<
+        std::setw(14) << "changed/upd" << "\n";
+
+    for (int count : {1'000, 10'000, 50'000, 100'000, 1'000'000}) {
+        auto animations = Animations{};
+        animations.setup(sprites);
+        for (int i = 0; i < count; i++) {
+            animations.add(
+                static_cast<r::Sprite>(i % r::spriteCount), i * 0.0137f);
+        }
+
+        size_t changed = 0;
+        int updates = 0;
+        auto start = Clock::now();
+        do {
+            animations.update(delta);
+            changed += animations.changed().size();
+            updates++;
+        } while (updates < 100 ||
+            std::chrono::duration<double>{Clock::now() - start}.count() < seconds);
+        auto elapsed = std::chrono::duration<double, std::micro>{
+            Clock::now() - start}.count();
+
+        std::cout << std::setw(10) << count << std::setw(10) << updates <<
+            std::setw(14) << elapsed / updates <<
+            std::setw(14) << elapsed * 1000 / updates / count <<
+            std::setw(14) << static_cast<double>(changed) / updates << "\n";
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,199 @@
+// Renders the mixer into a buffer, without an audio device, to measure the
+// cost of one device buffer against its duration. Every few blocks a batch of
+// synthesized sounds is started from this thread, so the command queue and
+// the voice limit are exercised as they would be in the game: plays beyond
+// the limit are dropped, not stolen from playing voices.
+//
+// Before that, the mix is checked: panning, clamping, stopping, and the
+// voice limit. The bench fails if any check does.
+//
+// Usage: bench-audio [VOICES] [--seconds S]
+
+#include "audio.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <numbers>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Matches what Audio asks of the device at 240 fps
+constexpr size_t blockFrames = 128;
+
+// Decaying sine, interleaved stereo
+std::vector<float> synthesize(float frequency, float seconds)
+{
+    auto frames = static_cast<size_t>(seconds * Mixer::frequency);
+    auto samples = std::vector<float>(frames * Mixer::channels);
+    for (size_t i = 0; i < frames; i++) {
+        float t = static_cast<float>(i) / Mixer::frequency;
+        float value = 0.5f * std::exp(-8 * t) *
+            std::sin(2 * std::numbers::pi_v<float> * frequency * t);
+        samples[2 * i] = value;
+        samples[2 * i + 1] = value;
+    }
+    return samples;
+}
+
+std::vector<std::vector<float>> synthesizeSounds()
+{
+    auto sounds = std::vector<std::vector<float>>{};
+    for (size_t i = 0; i < r::soundCount; i++) {
+        sounds.push_back(synthesize(440.f * (i + 1), 0.5f));
+    }
+    return sounds;
+}
+
+// Every check renders a block of a new mixer. Returns the number of checks
+// that failed.
+int checkMixer()
+{
+    int failures = 0;
+    auto check = [&] (bool passed, std::string_view what) {
+        if (!passed) {
+            std::cerr << "check failed: " << what << "\n";
+            failures++;
+        }
+    };
+
+    auto buffer = std::vector<float>(blockFrames * Mixer::channels);
+    auto silent = [&] (size_t firstChannel, size_t step) {
+        for (size_t i = firstChannel; i < buffer.size(); i += step) {
+            if (buffer[i] != 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    {
+        auto mixer = Mixer{synthesizeSounds()};
+        mixer.play(r::Sound::Hit, 1, -1);
+        mixer.render(buffer);
+        check(!silent(0, 2), "hard left pan plays on the left");
+        check(silent(1, 2), "hard left pan is silent on the right");
+    }
+    {
+        auto mixer = Mixer{synthesizeSounds()};
+        for (size_t i = 0; i < Mixer::maxVoices; i++) {
+            mixer.play(r::Sound::Hit, 4);
+        }
+        mixer.render(buffer);
+        auto [min, max] = std::ranges::minmax(buffer);
+        check(min >= -1 && max <= 1, "mix is clamped to [-1, 1]");
+        check(min == -1 && max == 1, "loud mix reaches the clamp");
+    }
+    {
+        auto mixer = Mixer{synthesizeSounds()};
+        auto voice = mixer.play(r::Sound::Hit);
+        mixer.render(buffer);
+        mixer.stop(voice);
+        mixer.render(buffer);
+        check(silent(0, 1) && mixer.activeVoices() == 0, "stop silences the voice");
+    }
+    {
+        auto mixer = Mixer{synthesizeSounds()};
+        for (size_t i = 0; i < 4; i++) {
+            mixer.play(r::Sound::Hit);
+        }
+        mixer.render(buffer);
+        mixer.stopAll();
+        mixer.render(buffer);
+        check(silent(0, 1) && mixer.activeVoices() == 0, "stopAll silences all voices");
+    }
+    {
+        auto mixer = Mixer{synthesizeSounds()};
+        for (size_t i = 0; i < Mixer::maxVoices + 4; i++) {
+            mixer.play(r::Sound::Hit);
+        }
+        mixer.render(buffer);
+        check(mixer.activeVoices() == Mixer::maxVoices,
+            "plays beyond maxVoices are dropped");
+    }
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    size_t voices = Mixer::maxVoices;
+    double seconds = 1.0;
+    for (int i = 1; i < argc; i++) {
+        auto arg = std::string_view{argv[i]};
+        if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        } else if (!arg.starts_with("-")) {
+            voices = std::stoul(std::string{arg});
+        } else {
+            std::cerr << "usage: bench-audio [VOICES] [--seconds S]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    int failures = checkMixer();
+    auto mixer = Mixer{synthesizeSounds()};
+
+    auto buffer = std::vector<float>(blockFrames * Mixer::channels);
+    auto worst = Clock::duration{};
+    auto total = Clock::duration{};
+    float peak = 0;
+    double checksum = 0;
+    size_t blocks = 0;
+    size_t maxActive = 0;
+    auto start = Clock::now();
+    do {
+        // Top up the voices; the game thread does this between frames
+        if (blocks % 16 == 0) {
+            for (size_t i = 0; i < voices; i++) {
+                auto sound = static_cast<r::Sound>(i % r::soundCount);
+                float pan = static_cast<float>(i) / std::max<size_t>(voices, 2) * 2 - 1;
+                mixer.play(sound, 0.25f, pan);
+            }
+        }
+
+        auto blockStart = Clock::now();
+        mixer.render(buffer);
+        auto elapsed = Clock::now() - blockStart;
+
+        total += elapsed;
+        worst = std::max(worst, elapsed);
+        for (float sample : buffer) {
+            peak = std::max(peak, std::abs(sample));
+            checksum += sample;
+        }
+        maxActive = std::max(maxActive, mixer.activeVoices());
+        blocks++;
+    } while (blocks < 1000 ||
+        std::chrono::duration<double>{Clock::now() - start}.count() < seconds);
+
+    using Us = std::chrono::duration<double, std::micro>;
+    double blockUs = 1e6 * blockFrames / Mixer::frequency;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << blocks << " blocks of " << blockFrames << " frames (" <<
+        blockUs << " us each), up to " << maxActive << " voices\n";
+    std::cout << "render: " << Us{total}.count() / blocks << " us/block avg, " <<
+        Us{worst}.count() << " us worst, " <<
+        100 * Us{total}.count() / blocks / blockUs << "% of real time\n";
+    std::cout << "peak " << peak << ", checksum " << checksum << ", " <<
+        mixer.droppedCommands() << " dropped commands\n";
+
+    if (failures > 0) {
+        std::cerr << failures << " mixer checks failed\n";
+        return EXIT_FAILURE;
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,183 @@
+// Microbenchmarks for the collision code, for every scalar type the geometry
+// supports.
+//
+// "sweep" is the loop of World::update: the nearest collision of the ball
+// against every brick of a level, for many ball directions. "geometry" runs
+// the Rectangle/Segment/Line/Norm operations that collision() is built of.
+// "world" runs whole World updates on the test level, and prints the state
+// hash after a fixed number of ticks: for Fixed, it must be the same on every
+// build.
+//
+// Usage: bench-collision
+
+#include "collision.hpp"
+#include "geometry.hpp"
+#include "world.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <numbers>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr auto minDuration = std::chrono::milliseconds{200};
+
+template <Scalar T>
+std::vector<BasicRectangle<T>> brickGrid(int count)
+{
+    auto bricks = std::vector<BasicRectangle<T>>{};
+    bricks.reserve(count);
+    int columns = 1;
+    while (columns * columns < count) {
+        columns++;
+    }
+    for (int i = 0; i < count; i++) {
+        auto center = BasicVector<T>{
+            static_cast<T>(3 * (i % columns - columns / 2)),
+            static_cast<T>(10 + 2 * (i / columns))};
+        bricks.push_back(BasicRectangle<T>{center, T{2}, T{1}});
+    }
+    return bricks;
+}
+
+// Runs body until minDuration passes, returns nanoseconds per item
+template <class F>
+double measure(size_t itemsPerRun, F&& body)
+{
+    size_t runs = 0;
+    auto start = Clock::now();
+    auto finish = start;
+    do {
+        body();
+        runs++;
+        finish = Clock::now();
+    } while (finish - start < minDuration);
+
+    auto ns = std::chrono::duration<double, std::nano>{finish - start}.count();
+    return ns / static_cast<double>(runs * itemsPerRun);
+}
+
+volatile float sink = 0;
+
+template <Scalar T>
+double sweep(int brickCount)
+{
+    static constexpr int directionCount = 64;
+
+    auto bricks = brickGrid<T>(brickCount);
+    auto ball = BasicCircle<T>{{T{0}, T{2}}, T{1} / 4};
+
+    auto velocities = std::vector<BasicVector<T>>{};
+    for (int i = 0; i < directionCount; i++) {
+        double angle = std::numbers::pi * (i + 1) / (directionCount + 1);
+        velocities.push_back(BasicVector<T>{
+            static_cast<T>(5 * std::cos(angle)),
+            static_cast<T>(5 * std::sin(angle))});
+    }
+
+    return measure(bricks.size() * velocities.size(), [&] {
+        T sum = 0;
+        for (const auto& velocity : velocities) {
+            auto bestCollision = BasicCollision<T>{};
+            for (const auto& brick : bricks) {
+                auto c = collision(ball, velocity, brick);
+                if (c < bestCollision) {
+                    bestCollision = c;
+                }
+            }
+            if (bestCollision) {
+                sum += bestCollision.time;
+            }
+        }
+        sink = static_cast<float>(sum);
+    });
+}
+
+template <Scalar T>
+double geometry(int brickCount)
+{
+    auto bricks = brickGrid<T>(brickCount);
+    auto point = BasicVector<T>{T{0}, T{2}};
+
+    return measure(bricks.size(), [&] {
+        T sum = 0;
+        for (const auto& brick : bricks) {
+            auto top = shift(brick.top(), {T{0}, T{1} / 4});
+            auto n = (brick.center() - point).norm();
+            sum += dot(n, top.start()) + top.line().coordinate(point);
+            if (top.contains(point)) {
+                sum += brick.w();
+            }
+        }
+        sink = static_cast<float>(sum);
+    });
+}
+
+template <Scalar T>
+double world(int ticks, uint64_t& stateHash)
+{
+    auto delta = static_cast<T>(1.0 / 240);
+
+    auto world = BasicWorld<T>{};
+    world.setupTestLevel();
+    for (int i = 0; i < ticks; i++) {
+        world.update(delta);
+    }
+    stateHash = world.stateHash();
+
+    return measure(ticks, [&] {
+        world.setupTestLevel();
+        for (int i = 0; i < ticks; i++) {
+            world.update(delta);
+        }
+    });
+}
+
+} // namespace
+
+int main() try
+{
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(20) << "benchmark" << std::right <<
+        std::setw(10) << "bricks" << std::setw(14) << "ns/brick" << "\n";
+
+    auto report = [] (const std::string& name, int bricks, double ns) {
+        std::cout << std::left << std::setw(20) << name << std::right <<
+            std::setw(10) << bricks << std::setw(14) << ns << "\n";
+    };
+
+    for (int bricks : {16, 256, 4096, 65536}) {
+        report("sweep/float", bricks, sweep<float>(bricks));
+        report("sweep/double", bricks, sweep<double>(bricks));
+        report("sweep/fixed", bricks, sweep<Fixed>(bricks));
+    }
+    for (int bricks : {256, 65536}) {
+        report("geometry/float", bricks, geometry<float>(bricks));
+        report("geometry/double", bricks, geometry<double>(bricks));
+        report("geometry/fixed", bricks, geometry<Fixed>(bricks));
+    }
+
+    static constexpr int ticks = 240 * 60;
+    uint64_t floatHash = 0;
+    uint64_t fixedHash = 0;
+    auto floatNs = world<float>(ticks, floatHash);
+    auto fixedNs = world<Fixed>(ticks, fixedHash);
+    std::cout << "\n" << std::left << std::setw(20) << "world" << std::right <<
+        std::setw(14) << "ns/tick" << "  state hash after " << ticks <<
+        " ticks\n";
+    std::cout << std::left << std::setw(20) << "world/float" << std::right <<
+        std::setw(14) << floatNs << "  " << std::hex << floatHash << std::dec << "\n";
+    std::cout << std::left << std::setw(20) << "world/fixed" << std::right <<
+        std::setw(14) << fixedNs << "  " << std::hex << fixedHash << std::dec << "\n";
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,195 @@
+// Moves many bodies through the entity registry, as a game with more kinds
+// of moving things than a ball and pads would:
+//
+// - array: a plain vector of structs, the layout a hand-written loop uses
+// - query: a query over the bodies' position and motion, chunk by chunk
+// - + kinds: the same query after adding many archetypes that it does not
+//   match, which must not slow it down
+// - + matching: after adding archetypes that it does match, with extra
+//   components in their own columns, so the query walks the same bytes
+// - parallel: the query with its chunks spread over the jobs
+// - serial systems / staged systems: four systems, two of which conflict,
+//   run one by one and in stages on the jobs
+//
+// Usage: bench-ecs [ENTITIES] [REPEATS]
+
+#include "ecs.hpp"
+#include "geometry.hpp"
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Ns = std::chrono::duration<double, std::nano>;
+
+constexpr float delta = 1.f / 60;
+constexpr size_t kindEntities = 1000;
+
+struct Position {
+    Vector value;
+};
+
+struct Motion {
+    Vector value;
+};
+
+struct Spin {
+    float angle = 0;
+    float speed = 0;
+};
+
+struct Health {
+    float value = 0;
+    float decay = 0;
+};
+
+// Tags and payloads that make up the other kinds of entities
+template <size_t N>
+struct Extra {
+    uint32_t value = 0;
+};
+
+struct Body {
+    Vector position;
+    Vector motion;
+};
+
+// Best time per entity of a few runs
+template <class F>
+double measure(size_t entities, int repeats, F&& f)
+{
+    double best = 0;
+    for (int i = 0; i < repeats; i++) {
+        auto start = Clock::now();
+        f();
+        double ns = Ns{Clock::now() - start}.count() /
+            static_cast<double>(entities);
+        best = i == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+void integrate(Position& position, const Motion& motion)
+{
+    position.value += motion.value * delta;
+}
+
+// Archetypes of every combination of the extras with the given components
+template <class... Cs>
+void addKinds(Registry& registry, const Cs&... components)
+{
+    for (uint32_t kind = 1; kind < 64; kind++) {
+        for (size_t i = 0; i < kindEntities; i++) {
+            auto entity = registry.create(components...);
+            if (kind & 1) registry.add(entity, Extra<0>{kind});
+            if (kind & 2) registry.add(entity, Extra<1>{kind});
+            if (kind & 4) registry.add(entity, Extra<2>{kind});
+            if (kind & 8) registry.add(entity, Extra<3>{kind});
+            if (kind & 16) registry.add(entity, Extra<4>{kind});
+            if (kind & 32) registry.add(entity, Spin{});
+        }
+    }
+}
+
+void print(const std::string& name, size_t entities, size_t archetypes, double ns)
+{
+    std::cout << std::setw(18) << std::left << name << std::right <<
+        std::setw(10) << entities << std::setw(12) << archetypes <<
+        std::setw(12) << ns << "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 1'000'000;
+    int repeats = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    auto jobs = JobSystem{};
+    std::cout << count << " bodies, " << jobs.workers() << " workers, " <<
+        "best of " << repeats << "\n\n";
+    std::cout << std::setw(18) << std::left << "case" << std::right <<
+        std::setw(10) << "entities" << std::setw(12) << "archetypes" <<
+        std::setw(12) << "ns/entity" << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+
+    auto bodies = std::vector<Body>{};
+    auto registry = Registry{};
+    for (size_t i = 0; i < count; i++) {
+        auto position = Vector{static_cast<float>(i % 1000), 0};
+        auto motion = Vector{1, static_cast<float>(i % 7)};
+        bodies.push_back({position, motion});
+        registry.create(Position{position}, Motion{motion});
+    }
+
+    print("array", count, 0, measure(count, repeats, [&] {
+        for (auto& body : bodies) {
+            body.position += body.motion * delta;
+        }
+    }));
+
+    auto query = Query<Position, const Motion>{};
+    auto runQuery = [&] {
+        query.eachChunk(registry, [] (std::span<const Entity>,
+                std::span<Position> positions, std::span<const Motion> motions) {
+            for (size_t i = 0; i < positions.size(); i++) {
+                integrate(positions[i], motions[i]);
+            }
+        });
+    };
+    print("query", count, registry.archetypeCount(),
+        measure(count, repeats, runQuery));
+
+    addKinds(registry, Health{1, 0.1f});
+    print("+ kinds", count, registry.archetypeCount(),
+        measure(count, repeats, runQuery));
+
+    addKinds(registry, Position{}, Motion{{1, 1}});
+    size_t matching = count + 63 * kindEntities;
+    print("+ matching", matching, registry.archetypeCount(),
+        measure(matching, repeats, runQuery));
+
+    print("parallel", matching, registry.archetypeCount(),
+        measure(matching, repeats, [&] {
+            query.parallelEach(registry, jobs, integrate);
+        }));
+
+    // The integration, the spin and the decay write different components,
+    // so they share a stage. The bounce writes Motion, which the integration
+    // reads, so it runs in the next one.
+    auto schedule = SystemSchedule{};
+    schedule.add<Position, const Motion>(integrate);
+    schedule.add<Spin>([] (Spin& spin) {
+        spin.angle += spin.speed * delta;
+    });
+    schedule.add<Health>([] (Health& health) {
+        health.value -= health.decay * delta;
+    });
+    schedule.add<const Position, Motion>([] (
+            const Position& position, Motion& motion) {
+        if (position.value.y > 1000) {
+            motion.value.y = -motion.value.y;
+        }
+    });
+
+    size_t total = registry.size();
+    print("serial systems", total, registry.archetypeCount(),
+        measure(total, repeats, [&] { schedule.run(registry); }));
+    print("staged systems", total, registry.archetypeCount(),
+        measure(total, repeats, [&] { schedule.run(registry, &jobs); }));
+    std::cout << "\n" << schedule.stages() << " stages of systems\n";
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
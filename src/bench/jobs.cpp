@@ -0,0 +1,188 @@
+// Measures how the job system scales with the number of workers, with and
+// without pinning workers to CPUs:
+//
+// - compute: parallelFor over an array, with enough math per item to be
+//   bound by the CPU rather than by memory
+// - world: World::update on a level large enough to check bricks in
+//   parallel; the final state must not depend on the number of workers
+// - overhead: many empty jobs, run and waited for one by one from the
+//   main thread, for the cost of a single job
+//
+// Usage: bench-jobs [MAX_WORKERS] [RUNS]
+
+#include "jobs.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Ms = std::chrono::duration<double, std::milli>;
+using Ns = std::chrono::duration<double, std::nano>;
+
+constexpr size_t computeItems = 1 << 20;
+constexpr size_t computeGrain = 4096;
+constexpr int worldTicks = 300;
+constexpr int overheadJobs = 100000;
+
+struct Result {
+    double computeMs = 0;
+    double worldMs = 0;
+    double jobNs = 0;
+    uint64_t stolen = 0;
+    uint64_t worldHash = 0;
+};
+
+// Keeps the compiler from dropping the computation
+volatile float sink = 0;
+
+double computeMs(JobSystem& jobs, std::vector<float>& values)
+{
+    auto start = Clock::now();
+    jobs.parallelFor(values.size(), computeGrain, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float x = static_cast<float>(i) * 1e-6f;
+            for (int j = 0; j < 64; j++) {
+                x = std::sqrt(x * x + 0.5f) * 0.75f;
+            }
+            values[i] = x;
+        }
+    });
+    auto finish = Clock::now();
+    sink = values[values.size() / 2];
+    return Ms{finish - start}.count();
+}
+
+World bigWorld()
+{
+    constexpr int columns = 192;
+    constexpr int rows = 48;
+    constexpr float width = 24.f / columns;
+    constexpr float height = 8.f / rows;
+
+    auto bricks = std::vector<Rectangle>{};
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            bricks.push_back(Rectangle{
+                {-12 + width * (static_cast<float>(column) + 0.5f),
+                    11 + height * (static_cast<float>(row) + 0.5f)},
+                width * 0.9f,
+                height * 0.9f});
+        }
+    }
+    auto world = World{};
+    world.setupLevel(std::move(bricks));
+    return world;
+}
+
+Result measure(size_t workers, bool pin, int runs)
+{
+    auto jobs = JobSystem{{.workers = workers, .pinWorkers = pin}};
+    auto values = std::vector<float>(computeItems);
+
+    auto compute = std::vector<double>{};
+    auto world = std::vector<double>{};
+    auto overhead = std::vector<double>{};
+    uint64_t worldHash = 0;
+    for (int run = 0; run < runs; run++) {
+        compute.push_back(computeMs(jobs, values));
+
+        auto level = bigWorld();
+        level.setJobs(&jobs);
+        auto start = Clock::now();
+        for (int tick = 0; tick < worldTicks; tick++) {
+            level.setPadPosition(0.5f + 0.4f * std::sin(tick * 0.05f));
+            level.update(1.f / 60);
+        }
+        world.push_back(Ms{Clock::now() - start}.count());
+        worldHash = level.stateHash();
+
+        auto executed = std::atomic<int>{0};
+        start = Clock::now();
+        for (int i = 0; i < overheadJobs; i++) {
+            auto counter = JobCounter{};
+            jobs.run(counter, [&executed] {
+                executed.fetch_add(1, std::memory_order_relaxed);
+            });
+            jobs.wait(counter);
+        }
+        overhead.push_back(Ns{Clock::now() - start}.count() / overheadJobs);
+    }
+
+    auto median = [] (std::vector<double> values) {
+        auto middle = values.begin() + values.size() / 2;
+        std::ranges::nth_element(values, middle);
+        return *middle;
+    };
+    return Result{
+        .computeMs = median(compute),
+        .worldMs = median(world),
+        .jobNs = median(overhead),
+        .stolen = jobs.stats().stolen,
+        .worldHash = worldHash,
+    };
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    size_t hardware = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    size_t maxWorkers = argc > 1 ? std::stoul(argv[1]) : hardware;
+    int runs = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    auto counts = std::vector<size_t>{};
+    for (size_t workers = 1; workers < maxWorkers; workers *= 2) {
+        counts.push_back(workers);
+    }
+    counts.push_back(maxWorkers);
+
+    std::cout << hardware << " hardware threads, " << runs <<
+        " runs, median times\n\n";
+    std::cout << std::setw(8) << "workers" << std::setw(8) << "pinned" <<
+        std::setw(12) << "compute ms" << std::setw(9) << "speedup" <<
+        std::setw(10) << "world ms" << std::setw(9) << "speedup" <<
+        std::setw(10) << "ns/job" << std::setw(10) << "stolen" << "\n";
+
+    std::cout << std::fixed << std::setprecision(2);
+    auto baseline = Result{};
+    for (bool pin : {false, true}) {
+        for (size_t workers : counts) {
+            auto result = measure(workers, pin, runs);
+            if (workers == 1 && !pin) {
+                baseline = result;
+            }
+            if (result.worldHash != baseline.worldHash) {
+                throw std::runtime_error{std::format(
+                    "world state with {} workers differs from one worker",
+                    workers)};
+            }
+
+            std::cout << std::setw(8) << workers <<
+                std::setw(8) << (pin ? "yes" : "no") <<
+                std::setw(12) << result.computeMs <<
+                std::setw(9) << baseline.computeMs / result.computeMs <<
+                std::setw(10) << result.worldMs <<
+                std::setw(9) << baseline.worldMs / result.worldMs <<
+                std::setw(10) << result.jobNs <<
+                std::setw(10) << result.stolen << "\n";
+        }
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
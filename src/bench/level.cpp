@@ -0,0 +1,165 @@
+// Compiles a level with many bricks, writes it to a temporary file, and
+// measures:
+//
+// - load: mapping and checking the level file
+// - copy: copying the bricks out of the file, which loading no longer does
+// - setup: World::setupLevel on the mapped bricks
+// - ticks: World::update with the grid, and with every brick checked
+//
+// Both worlds must end in the same state.
+//
+// Usage: bench-level [BRICKS] [TICKS]
+
+#include "level.hpp"
+#include "levels.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Ms = std::chrono::duration<double, std::milli>;
+
+constexpr int loadRuns = 9;
+
+// Square-ish bricks over the upper part of the field, as many as asked for
+std::vector<fb::Brick> manyBricks(size_t count)
+{
+    constexpr float minx = -12;
+    constexpr float miny = 8;
+    constexpr float width = 24;
+    constexpr float height = 12;
+
+    auto columns = static_cast<size_t>(
+        std::ceil(std::sqrt(static_cast<double>(count) * width / height)));
+    auto rows = (count + columns - 1) / columns;
+    float w = width / static_cast<float>(columns);
+    float h = height / static_cast<float>(rows);
+
+    auto bricks = std::vector<fb::Brick>{};
+    bricks.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        float x = minx + w * static_cast<float>(i % columns);
+        float y = miny + h * static_cast<float>(i / columns);
+        bricks.emplace_back(
+            x + w * 0.05f, x + w * 0.95f, y + h * 0.05f, y + h * 0.95f);
+    }
+    return bricks;
+}
+
+double median(std::vector<double> values)
+{
+    auto middle = values.begin() + values.size() / 2;
+    std::ranges::nth_element(values, middle);
+    return *middle;
+}
+
+template <class F>
+double timeMs(F&& f)
+{
+    auto start = Clock::now();
+    f();
+    return Ms{Clock::now() - start}.count();
+}
+
+uint64_t run(World& world, int ticks)
+{
+    for (int tick = 0; tick < ticks; tick++) {
+        float phase = static_cast<float>(tick) * 0.05f;
+        world.setPadPosition(0.5f + 0.4f * std::sin(phase));
+        world.update(1.f / 60);
+    }
+    return world.stateHash();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    size_t brickCount = argc > 1 ? std::stoul(argv[1]) : size_t{1} << 20;
+    int ticks = argc > 2 ? std::stoi(argv[2]) : 120;
+
+    auto path = std::filesystem::temp_directory_path() / "bench-level.level";
+    auto data = compileLevel("bench", manyBricks(brickCount));
+    {
+        auto stream = std::ofstream{path, std::ios::binary};
+        stream.exceptions(std::ios::badbit | std::ios::failbit);
+        stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    auto loads = std::vector<double>{};
+    auto copies = std::vector<double>{};
+    auto setups = std::vector<double>{};
+    for (int i = 0; i < loadRuns; i++) {
+        auto level = Level{};
+        loads.push_back(timeMs([&] {
+            level = Level{path};
+        }));
+        copies.push_back(timeMs([&] {
+            auto copy = std::vector<Rectangle>(
+                level.bricks().begin(), level.bricks().end());
+            if (copy.size() != brickCount) {
+                throw std::runtime_error{"level lost bricks"};
+            }
+        }));
+        auto world = World{};
+        setups.push_back(timeMs([&] {
+            world.setupLevel(level.bricks(), level.grid());
+        }));
+    }
+
+    auto level = Level{path};
+    auto gridWorld = World{};
+    gridWorld.setupLevel(level.bricks(), level.grid());
+    auto bruteWorld = World{};
+    bruteWorld.setupLevel(level.bricks(), BrickGrid{});
+
+    uint64_t gridHash = 0;
+    uint64_t bruteHash = 0;
+    double gridMs = timeMs([&] {
+        gridHash = run(gridWorld, ticks);
+    });
+    double bruteMs = timeMs([&] {
+        bruteHash = run(bruteWorld, ticks);
+    });
+    std::filesystem::remove(path);
+
+    const auto& grid = level.grid();
+    std::cout << brickCount << " bricks, " << data.size() / (1024 * 1024) <<
+        " MiB file, " << grid.columns << "x" << grid.rows << " grid, " <<
+        ticks << " ticks\n\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(24) << "load ms" << std::setw(12) <<
+        median(loads) << "\n";
+    std::cout << std::setw(24) << "copy bricks ms" << std::setw(12) <<
+        median(copies) << "\n";
+    std::cout << std::setw(24) << "setup ms" << std::setw(12) <<
+        median(setups) << "\n";
+    std::cout << std::setw(24) << "grid ms/tick" << std::setw(12) <<
+        gridMs / ticks << "\n";
+    std::cout << std::setw(24) << "all bricks ms/tick" << std::setw(12) <<
+        bruteMs / ticks << "\n";
+    std::cout << std::setw(24) << "destroyed bricks" << std::setw(12) <<
+        gridWorld.destroyedBrickCount() << "\n";
+
+    if (gridHash != bruteHash) {
+        std::cerr << "grid and brute force checks end in different states\n";
+        return EXIT_FAILURE;
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,190 @@
+// Compares load strategies of MemoryMap on a large generated pack file.
+//
+// For every strategy, the file is loaded and then read through once (one
+// byte per cache line), like Resources::load does when decoding the
+// spritesheet. "Cold" runs drop the file from the page cache first (Linux
+// only), "warm" runs reuse the cached pages.
+//
+// Usage: bench-mmap [SIZE_MIB] [RUNS]
+
+#include "mmap.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Case {
+    std::string name;
+    MapOptions options;
+};
+
+const auto cases = std::vector<Case>{
+    {"map", {}},
+    {"map+sequential", {.sequential = true}},
+    {"map+willneed", {.willNeed = true}},
+    {"map+hugepages", {.hugePages = true}},
+    {"map+populate", {.prefault = MapOptions::Prefault::Populate}},
+    {"map+touch", {.prefault = MapOptions::Prefault::Touch}},
+    {
+        "map+populate+sequential",
+        {
+            .prefault = MapOptions::Prefault::Populate,
+            .sequential = true,
+        },
+    },
+    {"read", {.strategy = MapOptions::Strategy::Read}},
+};
+
+void writeTestFile(const std::filesystem::path& path, size_t size)
+{
+    auto stream = std::ofstream{path, std::ios::binary};
+    stream.exceptions(std::ios::badbit | std::ios::failbit);
+
+    auto chunk = std::vector<uint64_t>(1 << 17);
+    uint64_t state = 0x9e3779b97f4a7c15;
+    for (size_t written = 0; written < size; ) {
+        for (auto& value : chunk) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            value = state;
+        }
+        auto bytes = std::min(size - written, chunk.size() * sizeof(uint64_t));
+        stream.write(reinterpret_cast<const char*>(chunk.data()), bytes);
+        written += bytes;
+    }
+}
+
+// Evicts the file from the page cache. Returns false if the platform has no
+// way to do it without privileges.
+bool dropCache(const std::filesystem::path& path)
+{
+#if defined(__linux__)
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    fdatasync(fd);
+    bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+uint8_t readThrough(const MemoryMap& mmap)
+{
+    static constexpr size_t cacheLine = 64;
+
+    const auto* bytes = static_cast<const uint8_t*>(mmap.addr());
+    uint8_t sum = 0;
+    for (size_t i = 0; i < mmap.size(); i += cacheLine) {
+        sum += bytes[i];
+    }
+    return sum;
+}
+
+struct Timing {
+    double loadMs = 0;
+    double totalMs = 0;
+};
+
+// Keeps the compiler from dropping the read pass
+volatile uint8_t sink = 0;
+
+Timing measure(const std::filesystem::path& path, const MapOptions& options)
+{
+    auto start = Clock::now();
+    auto mmap = MemoryMap{path, options};
+    auto loaded = Clock::now();
+    sink = readThrough(mmap);
+    auto finish = Clock::now();
+
+    using Ms = std::chrono::duration<double, std::milli>;
+    return Timing{
+        .loadMs = Ms{loaded - start}.count(),
+        .totalMs = Ms{finish - start}.count(),
+    };
+}
+
+Timing median(std::vector<Timing> timings)
+{
+    auto middle = timings.begin() + timings.size() / 2;
+    std::ranges::nth_element(timings, middle, {}, &Timing::loadMs);
+    auto loadMs = middle->loadMs;
+    std::ranges::nth_element(timings, middle, {}, &Timing::totalMs);
+    return Timing{.loadMs = loadMs, .totalMs = middle->totalMs};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    size_t sizeMib = argc > 1 ? std::stoul(argv[1]) : 512;
+    int runs = argc > 2 ? std::stoi(argv[2]) : 5;
+    if (runs < 1) {
+        throw std::runtime_error{"runs must be at least 1"};
+    }
+
+    auto path = std::filesystem::temp_directory_path() / "boo-bench-mmap.data";
+    writeTestFile(path, sizeMib << 20);
+
+    bool canDropCache = dropCache(path);
+    if (!canDropCache) {
+        std::cerr << "cannot drop page cache, cold runs are skipped\n";
+    }
+
+    std::cout << "file: " << path.string() << ", " << sizeMib << " MiB, " <<
+        runs << " runs, median times in ms\n\n";
+    std::cout << std::left << std::setw(26) << "strategy" << std::right <<
+        std::setw(12) << "cold load" << std::setw(12) << "cold total" <<
+        std::setw(12) << "warm load" << std::setw(12) << "warm total" << "\n";
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& [name, options] : cases) {
+        auto cold = std::vector<Timing>{};
+        auto warm = std::vector<Timing>{};
+        for (int i = 0; i < runs; i++) {
+            if (canDropCache) {
+                dropCache(path);
+                cold.push_back(measure(path, options));
+            }
+            warm.push_back(measure(path, options));
+        }
+
+        std::cout << std::left << std::setw(26) << name << std::right;
+        if (canDropCache) {
+            auto [loadMs, totalMs] = median(cold);
+            std::cout << std::setw(12) << loadMs << std::setw(12) << totalMs;
+        } else {
+            std::cout << std::setw(12) << "-" << std::setw(12) << "-";
+        }
+        auto [loadMs, totalMs] = median(warm);
+        std::cout << std::setw(12) << loadMs << std::setw(12) << totalMs << "\n";
+    }
+
+    std::filesystem::remove(path);
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
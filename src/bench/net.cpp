@@ -0,0 +1,256 @@
+// Runs two rollback sessions against each other over UDP on loopback, with
+// simulated latency, jitter and packet loss, and reports how often
+// resimulation after a misprediction takes longer than the tick budget.
+//
+// Both peers play scripted inputs on a FixedWorld. After every run, the two
+// worlds and a reference world, simulated offline with the same inputs,
+// must end in the same state, with the pads where the last inputs put them.
+//
+// Usage: bench-net [TICKS]
+
+#include "net.hpp"
+#include "rollback.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Ms = std::chrono::duration<double, std::milli>;
+using Us = std::chrono::duration<double, std::micro>;
+
+struct Case {
+    std::string name;
+    LinkConditions conditions;
+};
+
+const auto cases = std::vector<Case>{
+    {"lan", {}},
+    {"2 ticks", {.latencyTicks = 2}},
+    {"4 ticks", {.latencyTicks = 4}},
+    {"4 ticks, 5% loss", {.latencyTicks = 4, .loss = 0.05f}},
+    {"6+-2 ticks, 5% loss", {.latencyTicks = 5, .jitterTicks = 2, .loss = 0.05f}},
+    {"8 ticks, 10% loss", {.latencyTicks = 8, .loss = 0.1f}},
+    {"12 ticks, 20% loss", {.latencyTicks = 12, .loss = 0.2f}},
+};
+
+const auto tickDelta = Fixed{1} / Fixed{60};
+
+// Players hold their pad still for a while and then move it somewhere else,
+// so most predictions are right and a few are not
+uint16_t scriptedInput(size_t player, uint32_t tick)
+{
+    uint64_t state = (player + 1) * 0x9e3779b97f4a7c15 + tick / 23;
+    state ^= state >> 31;
+    state *= 0xbf58476d1ce4e5b9;
+    state ^= state >> 29;
+    return static_cast<uint16_t>(state);
+}
+
+FixedWorld levelWorld()
+{
+    auto bricks = std::vector<BasicRectangle<Fixed>>{};
+    for (int row = 0; row < 6; row++) {
+        for (int column = 0; column < 10; column++) {
+            bricks.push_back(BasicRectangle<Fixed>{
+                {Fixed{column * 2 - 9}, Fixed{12 + row}}, Fixed{2}, Fixed{1}});
+        }
+    }
+    auto world = FixedWorld{};
+    world.setupLevel(std::move(bricks), maxPlayers);
+    return world;
+}
+
+uint64_t referenceHash(uint32_t ticks)
+{
+    auto world = levelWorld();
+    for (uint32_t tick = 0; tick < ticks; tick++) {
+        for (size_t player = 0; player < maxPlayers; player++) {
+            world.setPadPosition(player, FixedRollbackSession::padPosition(
+                scriptedInput(player, tick)));
+        }
+        world.update(tickDelta);
+    }
+    return world.stateHash();
+}
+
+// Where the input should put the pad, worked out in doubles, since both
+// peers and the reference world would agree on a wrong conversion
+bool padAtInput(const FixedWorld& world, size_t player, uint16_t input)
+{
+    auto field = world.field();
+    const auto& pad = world.pad(player);
+    double range = static_cast<double>(field.w()) /
+        static_cast<double>(world.players());
+    double padWidth = static_cast<double>(pad.w());
+    double from = static_cast<double>(field.xmin()) +
+        range * static_cast<double>(player) + padWidth / 2;
+    double to = from + range - padWidth;
+    double expected = from + (to - from) * input / 65536;
+    return std::abs(static_cast<double>(pad.center().x) - expected) < 1e-3;
+}
+
+struct Peer {
+    FixedWorld world;
+    Link link;
+    FixedRollbackSession session;
+
+    Peer(size_t player, UdpSocket socket, uint16_t peerPort,
+            const LinkConditions& conditions)
+        : world(levelWorld())
+        , link(std::move(socket), Endpoint::loopback(peerPort), conditions)
+        , session(world, player, link, tickDelta)
+    { }
+};
+
+void add(RollbackStats& total, const RollbackStats& stats)
+{
+    total.rollbacks += stats.rollbacks;
+    total.budgetOverruns += stats.budgetOverruns;
+    total.maxResimulation =
+        std::max(total.maxResimulation, stats.maxResimulation);
+    for (size_t depth = 0; depth <= RollbackStats::maxDepth; depth++) {
+        total.rollbacksByDepth[depth] += stats.rollbacksByDepth[depth];
+        total.overrunsByDepth[depth] += stats.overrunsByDepth[depth];
+        total.resimulationByDepth[depth] += stats.resimulationByDepth[depth];
+    }
+}
+
+double percent(uint64_t part, uint64_t whole)
+{
+    return whole == 0 ? 0 : 100.0 * static_cast<double>(part) /
+        static_cast<double>(whole);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    uint32_t ticks = argc > 1 ? std::stoul(argv[1]) : 3600;
+    if (ticks < 1) {
+        throw std::runtime_error{"ticks must be at least 1"};
+    }
+    auto expectedHash = referenceHash(ticks);
+
+    std::cout << ticks << " ticks per run, budget " <<
+        Ms{FixedRollbackSession::tickBudget}.count() << " ms\n\n";
+    std::cout << std::left << std::setw(22) << "network" << std::right <<
+        std::setw(8) << "stalls" << std::setw(10) << "rollbacks" <<
+        std::setw(10) << "avg depth" << std::setw(10) << "max us" <<
+        std::setw(10) << "overruns" << std::setw(8) << "sent" <<
+        std::setw(8) << "lost" << "  state\n";
+
+    auto total = RollbackStats{};
+    bool allMatch = true;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& [name, conditions] : cases) {
+        auto firstSocket = UdpSocket{0};
+        auto secondSocket = UdpSocket{0};
+        auto firstPort = firstSocket.port();
+        auto secondPort = secondSocket.port();
+
+        auto secondConditions = conditions;
+        secondConditions.seed = conditions.seed + 1;
+        auto peers = std::vector<std::unique_ptr<Peer>>{};
+        peers.push_back(std::make_unique<Peer>(
+            0, std::move(firstSocket), secondPort, conditions));
+        peers.push_back(std::make_unique<Peer>(
+            1, std::move(secondSocket), firstPort, secondConditions));
+
+        // Every iteration is one frame on both peers. A stalled peer retries
+        // the same tick on the next frame.
+        auto running = [&] {
+            for (const auto& peer : peers) {
+                if (peer->session.tick() < ticks ||
+                        peer->session.confirmedTick() < ticks) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        for (uint64_t frame = 0; running(); frame++) {
+            if (frame > uint64_t{ticks} * 100) {
+                throw std::runtime_error{"sessions do not make progress"};
+            }
+            for (size_t player = 0; player < peers.size(); player++) {
+                auto& [world, link, session] = *peers[player];
+                link.tick();
+                session.poll();
+                if (session.tick() < ticks) {
+                    session.advance(scriptedInput(player, session.tick()));
+                } else {
+                    session.sendInputs();
+                }
+            }
+        }
+
+        bool match = true;
+        uint64_t stalls = 0;
+        uint64_t sent = 0;
+        uint64_t dropped = 0;
+        auto stats = RollbackStats{};
+        for (const auto& peer : peers) {
+            match = match && peer->world.stateHash() == expectedHash;
+            for (size_t player = 0; player < maxPlayers; player++) {
+                match = match && padAtInput(
+                    peer->world, player, scriptedInput(player, ticks - 1));
+            }
+            stalls += peer->session.stats().stalls;
+            sent += peer->link.stats().sent + peer->link.stats().dropped;
+            dropped += peer->link.stats().dropped;
+            add(stats, peer->session.stats());
+            stats.resimulatedTicks += peer->session.stats().resimulatedTicks;
+        }
+        allMatch = allMatch && match;
+        add(total, stats);
+
+        std::cout << std::left << std::setw(22) << name << std::right <<
+            std::setw(8) << stalls << std::setw(10) << stats.rollbacks <<
+            std::setw(10) << (stats.rollbacks == 0 ? 0.0 :
+                static_cast<double>(stats.resimulatedTicks) /
+                static_cast<double>(stats.rollbacks)) <<
+            std::setw(10) << Us{stats.maxResimulation}.count() <<
+            std::setw(10) << stats.budgetOverruns <<
+            std::setw(8) << sent << std::setw(8) << dropped <<
+            "  " << (match ? "match" : "MISMATCH") << "\n";
+    }
+
+    std::cout << "\n" << std::setw(6) << "depth" << std::setw(11) <<
+        "rollbacks" << std::setw(10) << "mean us" << std::setw(10) <<
+        "overruns" << std::setw(10) << "overrun%" << "\n";
+    for (size_t depth = 1; depth <= RollbackStats::maxDepth; depth++) {
+        auto count = total.rollbacksByDepth[depth];
+        if (count == 0) {
+            continue;
+        }
+        auto overruns = total.overrunsByDepth[depth];
+        std::cout << std::setw(6) << depth << std::setw(11) << count <<
+            std::setw(10) << Us{total.resimulationByDepth[depth]}.count() /
+                static_cast<double>(count) <<
+            std::setw(10) << overruns << std::setw(10) <<
+            percent(overruns, count) << "\n";
+    }
+    std::cout << "\n" << total.budgetOverruns << " of " << total.rollbacks <<
+        " rollbacks (" << percent(total.budgetOverruns, total.rollbacks) <<
+        "%) went over the budget\n";
+
+    if (!allMatch) {
+        std::cerr << "peers ended in different states or with misplaced pads\n";
+        return EXIT_FAILURE;
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
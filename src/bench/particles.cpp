@@ -0,0 +1,114 @@
+// Measures the particle pool with 100k live particles: the SIMD update, and
+// building the vertices of the batched draw. Particles that die are emitted
+// again right away, so the free list is exercised and the count stays
+// constant. Rendering itself is measured by bench-render.
+//
+// Usage: bench-particles [COUNT] [--seconds S]
+
+#include "particles.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class Random {
+public:
+    // Uniform in [min, max)
+    float operator()(float min, float max)
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 7;
+        _state ^= _state << 17;
+        return min + (max - min) * static_cast<float>(_state >> 40) / (1 << 24);
+    }
+
+private:
+    uint64_t _state = 0x9e3779b97f4a7c15;
+};
+
+Particle randomParticle(Random& random)
+{
+    return Particle{
+        .position = {random(-12, 12), random(0, 20)},
+        .velocity = {random(-5, 5), random(-5, 5)},
+        .lifetime = random(0.5f, 2.f),
+        .size = 0.1f,
+        .sprite = static_cast<uint16_t>(random(0, 2)),
+    };
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    size_t count = 100'000;
+    double seconds = 1.0;
+    for (int i = 1; i < argc; i++) {
+        auto arg = std::string_view{argv[i]};
+        if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        } else if (!arg.starts_with("-")) {
+            count = std::stoul(std::string{arg});
+        } else {
+            std::cerr << "usage: bench-particles [COUNT] [--seconds S]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    static constexpr float delta = 1.f / 240;
+
+    auto random = Random{};
+    auto particles = Particles{count};
+    while (particles.emit(randomParticle(random))) { }
+
+    // prepare() does not touch textures, so an empty one stands in for the
+    // atlas; both sprites are on it, which gives a single batch
+    auto texture = sdl::Texture{};
+    auto sprites = std::array{
+        ParticleSprite{.texture = &texture, .uv = {0, 0, 0.5f, 1}},
+        ParticleSprite{.texture = &texture, .uv = {0.5f, 0, 0.5f, 1}},
+    };
+
+    auto updateTime = Clock::duration{};
+    auto prepareTime = Clock::duration{};
+    int frames = 0;
+    auto start = Clock::now();
+    do {
+        auto frameStart = Clock::now();
+        particles.update(delta, {0, -9.8f});
+        while (particles.size() < count) {
+            particles.emit(randomParticle(random));
+        }
+        auto updated = Clock::now();
+        particles.prepare(sprites, {512, 768}, 32);
+        auto prepared = Clock::now();
+
+        updateTime += updated - frameStart;
+        prepareTime += prepared - updated;
+        frames++;
+    } while (frames < 100 ||
+        std::chrono::duration<double>{Clock::now() - start}.count() < seconds);
+
+    using Us = std::chrono::duration<double, std::micro>;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << count << " particles, " << frames << " frames\n";
+    std::cout << "update (with re-emit): " << Us{updateTime}.count() / frames <<
+        " us/frame, " << Us{updateTime}.count() * 1000 / frames / count <<
+        " ns/particle\n";
+    std::cout << "prepare: " << Us{prepareTime}.count() / frames <<
+        " us/frame, " << Us{prepareTime}.count() * 1000 / frames / count <<
+        " ns/particle, " << particles.batches() << " batch(es)\n";
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
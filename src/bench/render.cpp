@@ -0,0 +1,161 @@
+// Measures View rendering without a display: SDL runs on the dummy video
+// driver with a software renderer. Generated scenes of 1k to 1M bricks are
+// drawn repeatedly; for each scene, frames per second and the time of every
+// render stage are reported, along with the average number of draw calls.
+//
+// Usage: bench-render [--hash] [--seconds S]
+//
+// With --hash, the FNV-1a hash of the first frame's pixels is printed too, to
+// check that rendering changes do not change the picture.
+
+#include "build-info.hpp"
+#include "resources.hpp"
+#include "view.hpp"
+#include "window.hpp"
+#include "world.hpp"
+
+#include "sdl.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Fills the visible part of the field with a grid of bricks
+std::vector<Rectangle> brickScene(int count)
+{
+    static constexpr float width = 30;
+    static constexpr float height = 22;
+
+    int columns = static_cast<int>(std::ceil(std::sqrt(count * width / height)));
+    int rows = (count + columns - 1) / columns;
+    float cellWidth = width / columns;
+    float cellHeight = height / rows;
+
+    auto bricks = std::vector<Rectangle>{};
+    bricks.reserve(count);
+    for (int i = 0; i < count; i++) {
+        auto center = Vector{
+            -width / 2 + cellWidth * (i % columns + 0.5f),
+            1 + cellHeight * (i / columns + 0.5f)};
+        bricks.push_back(
+            Rectangle{center, cellWidth * 0.9f, cellHeight * 0.9f});
+    }
+    return bricks;
+}
+
+uint64_t pixelHash(sdl::Renderer& renderer, Size size)
+{
+    auto pixels = std::vector<uint32_t>(size.w * size.h);
+    renderer.readPixels(
+        nullptr, SDL_PIXELFORMAT_ARGB8888, pixels.data(), size.w * 4);
+
+    uint64_t hash = 14695981039346656037u;
+    for (uint32_t pixel : pixels) {
+        for (int i = 0; i < 4; i++) {
+            hash ^= (pixel >> (8 * i)) & 0xff;
+            hash *= 1099511628211u;
+        }
+    }
+    return hash;
+}
+
+double ms(RenderStats::Duration duration)
+{
+    return std::chrono::duration<double, std::milli>{duration}.count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    bool printHash = false;
+    double seconds = 1.0;
+    for (int i = 1; i < argc; i++) {
+        auto arg = std::string_view{argv[i]};
+        if (arg == "--hash") {
+            printHash = true;
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        } else {
+            std::cerr << "usage: bench-render [--hash] [--seconds S]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Lets SDL_VIDEODRIVER from the environment take priority
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+
+    auto sdlInit = sdl::Init{SDL_INIT_VIDEO};
+    auto imgInit = img::Init{IMG_INIT_PNG};
+
+    auto window = Window{
+        SDL_WINDOW_HIDDEN, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE};
+    auto resources = Resources{window.renderer()};
+    resources.load(bi::dataFile);
+    auto view = View{window, resources};
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "stage times are in ms per frame\n\n";
+    std::cout << std::setw(9) << "bricks" << std::setw(8) << "frames" <<
+        std::setw(10) << "fps" << std::setw(10) << "clear" <<
+        std::setw(10) << "bricks" << std::setw(10) << "dynamic" <<
+        std::setw(10) << "present" << std::setw(8) << "calls";
+    if (printHash) {
+        std::cout << "  pixel hash";
+    }
+    std::cout << "\n";
+
+    for (int brickCount : {1'000, 10'000, 100'000, 1'000'000}) {
+        auto world = World{};
+        world.setupLevel(brickScene(brickCount));
+
+        uint64_t hash = 0;
+        auto total = RenderStats{};
+        size_t drawCalls = 0;
+        int frames = 0;
+        auto start = Clock::now();
+        do {
+            view.draw(world);
+            if (printHash && frames == 0) {
+                hash = pixelHash(window.renderer(), window.size());
+            }
+            view.present();
+
+            const auto& stats = view.stats();
+            total.clear += stats.clear;
+            total.bricks += stats.bricks;
+            total.dynamic += stats.dynamic;
+            total.present += stats.present;
+            drawCalls += stats.drawCalls;
+            frames++;
+        } while (frames < 3 ||
+            std::chrono::duration<double>{Clock::now() - start}.count() < seconds);
+        auto elapsed = std::chrono::duration<double>{Clock::now() - start};
+
+        std::cout << std::setw(9) << brickCount << std::setw(8) << frames <<
+            std::setw(10) << frames / elapsed.count() <<
+            std::setw(10) << ms(total.clear) / frames <<
+            std::setw(10) << ms(total.bricks) / frames <<
+            std::setw(10) << ms(total.dynamic) / frames <<
+            std::setw(10) << ms(total.present) / frames <<
+            std::setw(8) << drawCalls / frames;
+        if (printHash) {
+            std::cout << "  " << std::hex << std::setw(16) <<
+                std::setfill('0') << hash << std::setfill(' ') << std::dec;
+        }
+        std::cout << "\n";
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,304 @@
+// Sweeps generated levels from 10 up to 10M bricks, with bricks of one size
+// and of varied sizes, spread out and clustered, and measures every hot path
+// on each level:
+//
+// - compile: compileLevel, sorting the bricks into the grid
+// - collision: collision() of one ball against every brick, per brick
+// - update: World::update with the grid, for each ball count; every ball is
+//   a world of its own on the same mapped bricks
+// - update-all: the same without the grid, up to 1M bricks
+// - render-first: the first View frame of a level, which draws the static
+//   layer, on the dummy video driver
+// - render: later frames
+//
+// A table goes to stdout, and with --csv, one row per measurement to a CSV
+// file: path, bricks, size_spread, clustering, balls, iterations, ms (per
+// iteration) and ns_per_brick.
+//
+// Usage: bench-scaling [--max-bricks N] [--seconds S] [--csv FILE]
+//     [--no-render]
+
+#include "build-info.hpp"
+#include "collision.hpp"
+#include "level.hpp"
+#include "levels.hpp"
+#include "resources.hpp"
+#include "view.hpp"
+#include "window.hpp"
+#include "world.hpp"
+
+#include "sdl.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Ms = std::chrono::duration<double, std::milli>;
+
+constexpr size_t maxAllBricks = 1'000'000;
+constexpr auto ballCounts = std::array<size_t, 2>{1, 8};
+
+struct Shape {
+    float sizeSpread = 0;
+    float clustering = 0;
+};
+
+constexpr auto shapes = std::array{
+    Shape{0, 0},
+    Shape{0.8f, 0},
+    Shape{0, 0.9f},
+    Shape{0.8f, 0.9f},
+};
+
+struct Measurement {
+    uint64_t iterations = 0;
+    double ms = 0;
+};
+
+// Runs f at least once, and until the time is up
+template <class F>
+Measurement repeat(double seconds, F&& f)
+{
+    auto result = Measurement{};
+    auto start = Clock::now();
+    do {
+        f();
+        result.iterations++;
+    } while (std::chrono::duration<double>{Clock::now() - start}.count() <
+        seconds);
+    result.ms = Ms{Clock::now() - start}.count() /
+        static_cast<double>(result.iterations);
+    return result;
+}
+
+// Keeps the compiler from dropping the computation
+volatile float sink = 0;
+
+class Report {
+public:
+    explicit Report(const std::optional<std::filesystem::path>& csvPath)
+    {
+        if (csvPath) {
+            _csv.emplace(*csvPath);
+            _csv->exceptions(std::ios::badbit | std::ios::failbit);
+            *_csv << "path,bricks,size_spread,clustering,balls,iterations,"
+                "ms,ns_per_brick\n";
+        }
+    }
+
+    void add(
+        std::string_view path,
+        size_t bricks,
+        const Shape& shape,
+        size_t balls,
+        const Measurement& measurement)
+    {
+        if (!_csv) {
+            return;
+        }
+        double nsPerBrick = measurement.ms * 1e6 /
+            static_cast<double>(std::max<size_t>(bricks, 1));
+        *_csv << path << "," << bricks << "," << shape.sizeSpread << "," <<
+            shape.clustering << "," << balls << "," <<
+            measurement.iterations << "," << measurement.ms << "," <<
+            nsPerBrick << "\n";
+    }
+
+private:
+    std::optional<std::ofstream> _csv;
+};
+
+// Sorts the bricks into a grid and maps them, as the game loads levels
+Level compiledLevel(std::span<const fb::Brick> bricks, Measurement& compile,
+    double seconds)
+{
+    auto data = std::vector<uint8_t>{};
+    compile = repeat(seconds, [&] {
+        data = compileLevel("scaling", bricks);
+    });
+
+    auto path = std::filesystem::temp_directory_path() / "bench-scaling.level";
+    {
+        auto stream = std::ofstream{path, std::ios::binary};
+        stream.exceptions(std::ios::badbit | std::ios::failbit);
+        stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+    // The mapping stays valid after the file is removed
+    auto level = Level{path};
+    std::filesystem::remove(path);
+    return level;
+}
+
+Measurement collisions(std::span<const Rectangle> bricks, double seconds)
+{
+    auto ball = Circle{.center = {0, 2}, .radius = 0.5f};
+    auto velocity = Vector{4, 8};
+    return repeat(seconds, [&] {
+        auto nearest = Collision{};
+        for (const auto& brick : bricks) {
+            auto c = collision(ball, velocity, brick);
+            if (c < nearest) {
+                nearest = c;
+            }
+        }
+        sink = nearest.time;
+    });
+}
+
+// Every ball starts from its own pad position, and the pads sweep the field
+// out of step, so that the balls do not follow each other
+Measurement updates(
+    const Level& level, const BrickGrid& grid, size_t balls, double seconds)
+{
+    auto worlds = std::vector<World>(balls);
+    for (size_t ball = 0; ball < balls; ball++) {
+        auto position =
+            (static_cast<float>(ball) + 0.5f) / static_cast<float>(balls);
+        worlds[ball].setPadPosition(position);
+        worlds[ball].setupLevel(level.bricks(), grid);
+    }
+
+    int tick = 0;
+    return repeat(seconds, [&] {
+        for (size_t ball = 0; ball < balls; ball++) {
+            float phase = static_cast<float>(tick) * 0.05f +
+                static_cast<float>(ball);
+            worlds[ball].setPadPosition(0.5f + 0.4f * std::sin(phase));
+            worlds[ball].update(1.f / 60);
+        }
+        tick++;
+    });
+}
+
+// Every level gets a view of its own, since views keep what they drew by
+// the bricks generation, which starts over in every world
+struct Renderer {
+    sdl::Init sdlInit{SDL_INIT_VIDEO};
+    img::Init imgInit{IMG_INIT_PNG};
+    Window window{
+        SDL_WINDOW_HIDDEN, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE};
+    Resources resources{window.renderer()};
+
+    Renderer()
+    {
+        resources.load(bi::dataFile);
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    size_t maxBricks = 10'000'000;
+    double seconds = 0.2;
+    auto csvPath = std::optional<std::filesystem::path>{};
+    bool render = true;
+    for (int i = 1; i < argc; i++) {
+        auto arg = std::string_view{argv[i]};
+        if (arg == "--max-bricks" && i + 1 < argc) {
+            maxBricks = std::stoul(argv[++i]);
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if (arg == "--no-render") {
+            render = false;
+        } else {
+            std::cerr << "usage: bench-scaling [--max-bricks N] [--seconds S] "
+                "[--csv FILE] [--no-render]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto renderer = std::unique_ptr<Renderer>{};
+    if (render) {
+        // Lets SDL_VIDEODRIVER from the environment take priority
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+        renderer = std::make_unique<Renderer>();
+    }
+    auto report = Report{csvPath};
+
+    std::cout << "at least " << seconds << " s per measurement; update is " <<
+        "per tick of all balls, render per frame\n\n";
+    std::cout << std::setw(9) << "bricks" << std::setw(7) << "spread" <<
+        std::setw(7) << "clust" << std::setw(11) << "compile ms" <<
+        std::setw(10) << "coll ns" << std::setw(12) << "update1 us" <<
+        std::setw(12) << "update8 us" << std::setw(10) << "all us" <<
+        std::setw(10) << "first ms" << std::setw(10) << "frame ms" << "\n";
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t bricks = 10; bricks <= maxBricks; bricks *= 10) {
+        for (const auto& shape : shapes) {
+            auto generated = generateBricks(GeneratorOptions{
+                .seed = bricks,
+                .bricks = bricks,
+                .sizeSpread = shape.sizeSpread,
+                .clustering = shape.clustering,
+            });
+            auto compile = Measurement{};
+            auto level = compiledLevel(generated, compile, seconds);
+            generated = {};
+            report.add("compile", bricks, shape, 1, compile);
+            std::cout << std::setw(9) << bricks << std::setw(7) <<
+                std::setprecision(1) << shape.sizeSpread << std::setw(7) <<
+                shape.clustering << std::setprecision(3) << std::setw(11) <<
+                compile.ms;
+
+            auto collision = collisions(level.bricks(), seconds);
+            report.add("collision", bricks, shape, 1, collision);
+            std::cout << std::setw(10) <<
+                collision.ms * 1e6 / static_cast<double>(bricks);
+
+            for (size_t balls : ballCounts) {
+                auto update = updates(level, level.grid(), balls, seconds);
+                report.add("update", bricks, shape, balls, update);
+                std::cout << std::setw(12) << update.ms * 1000;
+            }
+
+            if (bricks <= maxAllBricks) {
+                auto update = updates(level, BrickGrid{}, 1, seconds);
+                report.add("update-all", bricks, shape, 1, update);
+                std::cout << std::setw(10) << update.ms * 1000;
+            } else {
+                std::cout << std::setw(10) << "-";
+            }
+
+            if (renderer) {
+                auto world = World{};
+                world.setupLevel(level.bricks(), level.grid());
+                auto view = View{renderer->window, renderer->resources};
+                auto first = repeat(0, [&] {
+                    view.render(world);
+                });
+                auto frames = repeat(seconds, [&] {
+                    view.render(world);
+                });
+                report.add("render-first", bricks, shape, 1, first);
+                report.add("render", bricks, shape, 1, frames);
+                std::cout << std::setw(10) << first.ms <<
+                    std::setw(10) << frames.ms;
+            }
+            std::cout << "\n";
+        }
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
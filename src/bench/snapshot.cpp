@@ -0,0 +1,187 @@
+// Measures World snapshots the way rollback uses them: every tick a snapshot
+// is taken into a ring, and then the world is rolled back a fixed number of
+// ticks and simulated forward again with the same input. A dense level makes
+// the ball destroy bricks often, so restores have bricks to bring back.
+//
+// The final state hash is compared with a run without rollback; they must be
+// equal, for float and for Fixed.
+//
+// Usage: bench-snapshot [TICKS] [--rollback N]
+
+#include "world.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t maxRollback = 64;
+
+// Rows of small bricks over the upper half of the field
+template <Scalar T>
+std::vector<BasicRectangle<T>> denseLevel()
+{
+    auto bricks = std::vector<BasicRectangle<T>>{};
+    for (int row = 0; row < 16; row++) {
+        for (int column = 0; column < 40; column++) {
+            auto center = BasicVector<T>{
+                T{-12} + static_cast<T>(column) * T{6} / T{10} + T{3} / T{10},
+                T{11} + static_cast<T>(row) / T{2}};
+            bricks.push_back(BasicRectangle<T>{center, T{1} / T{2}, T{2} / T{5}});
+        }
+    }
+    return bricks;
+}
+
+// Input is a function of the tick, so resimulation sees the same input
+template <Scalar T>
+void applyInput(BasicWorld<T>& world, int tick)
+{
+    world.setPadPosition(static_cast<T>((tick / 60) % 8) / T{7});
+}
+
+struct Result {
+    uint64_t hash = 0;
+    uint64_t straightHash = 0;
+    double snapshotNs = 0;
+    double restoreNs = 0;
+    double tickNs = 0;
+    size_t destroyed = 0;
+    size_t restoredBricks = 0;
+};
+
+template <Scalar T>
+Result run(int ticks, int rollback)
+{
+    const auto delta = T{1} / T{240};
+
+    auto straight = BasicWorld<T>{};
+    straight.setupLevel(denseLevel<T>());
+    for (int tick = 0; tick < ticks; tick++) {
+        applyInput(straight, tick);
+        straight.update(delta);
+    }
+
+    auto world = BasicWorld<T>{};
+    world.setupLevel(denseLevel<T>());
+    auto ring = std::array<BasicWorldSnapshot<T>, maxRollback>{};
+
+    auto snapshotTime = Clock::duration{};
+    auto restoreTime = Clock::duration{};
+    auto tickTime = Clock::duration{};
+    size_t resimulatedTicks = 0;
+    size_t restores = 0;
+    size_t restoredBricks = 0;
+    for (int tick = 0; tick < ticks; tick++) {
+        auto start = Clock::now();
+        ring[tick % maxRollback] = world.snapshot();
+        auto taken = Clock::now();
+        snapshotTime += taken - start;
+
+        applyInput(world, tick);
+        world.update(delta);
+
+        if (tick >= rollback) {
+            int from = tick + 1 - rollback;
+            uint64_t changesBefore = world.brickChanges();
+            auto restoreStart = Clock::now();
+            world.restore(ring[from % maxRollback]);
+            auto restored = Clock::now();
+            restoreTime += restored - restoreStart;
+            restoredBricks += world.brickChanges() - changesBefore;
+            restores++;
+
+            for (int t = from; t <= tick; t++) {
+                ring[t % maxRollback] = world.snapshot();
+                applyInput(world, t);
+                world.update(delta);
+            }
+            tickTime += Clock::now() - restored;
+            resimulatedTicks += rollback;
+        }
+    }
+
+    using Ns = std::chrono::duration<double, std::nano>;
+    size_t destroyed = 0;
+    for (size_t i = 0; i < world.bricks().size(); i++) {
+        destroyed += world.brickAlive(i) ? 0 : 1;
+    }
+    return Result{
+        .hash = world.stateHash(),
+        .straightHash = straight.stateHash(),
+        .snapshotNs = Ns{snapshotTime}.count() / ticks,
+        .restoreNs = restores ? Ns{restoreTime}.count() / restores : 0,
+        .tickNs = resimulatedTicks ?
+            Ns{tickTime}.count() / resimulatedTicks : 0,
+        .destroyed = destroyed,
+        .restoredBricks = restoredBricks,
+    };
+}
+
+void print(std::string_view name, const Result& result)
+{
+    std::cout << std::left << std::setw(8) << name << std::right <<
+        std::setw(12) << result.snapshotNs <<
+        std::setw(12) << result.restoreNs <<
+        std::setw(14) << result.tickNs <<
+        std::setw(10) << result.destroyed <<
+        std::setw(10) << result.restoredBricks <<
+        "  " << std::hex << std::setw(16) << std::setfill('0') <<
+        result.hash << std::setfill(' ') << std::dec <<
+        (result.hash == result.straightHash ? "  match" : "  MISMATCH") << "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    int ticks = 20'000;
+    int rollback = 8;
+    for (int i = 1; i < argc; i++) {
+        auto arg = std::string_view{argv[i]};
+        if (arg == "--rollback" && i + 1 < argc) {
+            rollback = std::stoi(argv[++i]);
+        } else if (!arg.starts_with("-")) {
+            ticks = std::stoi(std::string{arg});
+        } else {
+            std::cerr << "usage: bench-snapshot [TICKS] [--rollback N]\n";
+            return EXIT_FAILURE;
+        }
+    }
+    if (rollback < 1 || rollback >= static_cast<int>(maxRollback)) {
+        std::cerr << "rollback must be between 1 and " << maxRollback - 1 << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << ticks << " ticks, rolling back " << rollback <<
+        " ticks after every tick; " << sizeof(WorldSnapshot) <<
+        " bytes per snapshot; times in ns\n\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(8) << "scalar" << std::right <<
+        std::setw(12) << "snapshot" << std::setw(12) << "restore" <<
+        std::setw(14) << "resim/tick" << std::setw(10) << "bricks" <<
+        std::setw(10) << "revived" << "  state hash\n";
+
+    auto floatResult = run<float>(ticks, rollback);
+    print("float", floatResult);
+    auto fixedResult = run<Fixed>(ticks, rollback);
+    print("Fixed", fixedResult);
+
+    if (floatResult.hash != floatResult.straightHash ||
+            fixedResult.hash != fixedResult.straightHash) {
+        return EXIT_FAILURE;
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,188 @@
+// Compiles chunked levels of increasing height, streams them with the
+// default memory cap, and scrolls a view-sized focus area up from the
+// middle of each level at a steady speed, while the ball plays at the
+// bottom. Reports per-tick time, the memory of the stream, how much the
+// resident set of the process grew while playing, and how often the world
+// had to wait for a chunk.
+//
+// Ticks are paced with a short sleep, as frames are in the game, so that
+// the background thread gets to load chunks even on a single core. Only the
+// updates are timed. Time and memory per tick should stay flat however tall
+// the level is.
+//
+// Usage: bench-stream [TICKS]
+
+#include "levels.hpp"
+#include "stream.hpp"
+#include "world.hpp"
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Us = std::chrono::duration<double, std::micro>;
+
+constexpr float fieldWidth = 24;
+constexpr float viewHeight = 20;
+constexpr float chunkSize = 16;
+// World units per tick, faster than the ball
+constexpr float scrollSpeed = 0.25f;
+constexpr auto tickPause = std::chrono::milliseconds{1};
+
+// Rows of small bricks across the whole field, with a free row after every
+// four, up to the given height
+std::vector<fb::Brick> towerBricks(float height)
+{
+    constexpr int columns = 48;
+    constexpr float w = fieldWidth / columns;
+    constexpr float h = 0.5f;
+
+    auto bricks = std::vector<fb::Brick>{};
+    int rows = static_cast<int>((height - 10) / h);
+    for (int row = 0; row < rows; row++) {
+        if (row % 5 == 4) {
+            continue;
+        }
+        float y = 10 + h * static_cast<float>(row);
+        for (int column = 0; column < columns; column++) {
+            float x = -fieldWidth / 2 + w * static_cast<float>(column);
+            bricks.emplace_back(
+                x + w * 0.05f, x + w * 0.95f, y + h * 0.05f, y + h * 0.95f);
+        }
+    }
+    return bricks;
+}
+
+// Resident set of the process, or zero where it is not known
+size_t residentBytes()
+{
+#if defined(__linux__)
+    auto statm = std::ifstream{"/proc/self/statm"};
+    size_t size = 0;
+    size_t resident = 0;
+    if (statm >> size >> resident) {
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+struct Result {
+    size_t bricks = 0;
+    size_t fileBytes = 0;
+    double meanUs = 0;
+    double maxUs = 0;
+    size_t streamBytes = 0;
+    // Growth while playing, since compiling the level leaves the heap at a
+    // size that depends on the level
+    int64_t residentGrowth = 0;
+    StreamStats stats;
+};
+
+Result measure(float height, int ticks)
+{
+    // The source bricks are freed before streaming, so that they do not
+    // count towards the resident set
+    auto result = Result{};
+    auto path = std::filesystem::temp_directory_path() / "bench-stream.chunks";
+    {
+        auto bricks = towerBricks(height);
+        auto data = compileChunkedLevel(
+            "bench",
+            bricks,
+            fb::Brick{-fieldWidth / 2, fieldWidth / 2, 0, height},
+            chunkSize);
+        auto file = std::ofstream{path, std::ios::binary};
+        file.exceptions(std::ios::badbit | std::ios::failbit);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        result.bricks = bricks.size();
+        result.fileBytes = data.size();
+    }
+
+    {
+        auto stream = LevelStream{path};
+        auto world = World{};
+        world.setupLevel(stream);
+        auto residentBefore = static_cast<int64_t>(residentBytes());
+
+        double totalUs = 0;
+        for (int tick = 0; tick < ticks; tick++) {
+            float y = height / 2 + scrollSpeed * static_cast<float>(tick);
+            auto view = Rectangle{
+                {0, std::min(y, height - viewHeight / 2)},
+                fieldWidth,
+                viewHeight};
+            world.focus(std::span{&view, 1});
+            world.setPadPosition(
+                0.5f + 0.4f * std::sin(static_cast<float>(tick) * 0.05f));
+
+            auto start = Clock::now();
+            world.update(1.f / 60);
+            double us = Us{Clock::now() - start}.count();
+            totalUs += us;
+            result.maxUs = std::max(result.maxUs, us);
+            std::this_thread::sleep_for(tickPause);
+        }
+        result.meanUs = totalUs / ticks;
+        result.streamBytes = stream.memoryBytes();
+        result.residentGrowth =
+            static_cast<int64_t>(residentBytes()) - residentBefore;
+        result.stats = stream.stats();
+    }
+    std::filesystem::remove(path);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    int ticks = argc > 1 ? std::stoi(argv[1]) : 3600;
+
+    std::cout << ticks << " ticks per level, " << chunkSize <<
+        " unit chunks, " << (StreamOptions{}.memoryCap >> 20) <<
+        " MiB cap\n\n";
+    std::cout << std::setw(8) << "height" << std::setw(10) << "bricks" <<
+        std::setw(10) << "file MiB" << std::setw(10) << "mean us" <<
+        std::setw(10) << "max us" << std::setw(11) << "stream MiB" <<
+        std::setw(10) << "RSS+ KiB" << std::setw(8) << "loads" <<
+        std::setw(8) << "sync" << std::setw(8) << "dropped" <<
+        std::setw(8) << "evicted" << "\n";
+
+    std::cout << std::fixed << std::setprecision(2);
+    constexpr double mib = 1 << 20;
+    for (float height : {256.f, 1024.f, 4096.f, 16384.f, 65536.f}) {
+        auto result = measure(height, ticks);
+        std::cout << std::setw(8) << height << std::setw(10) << result.bricks <<
+            std::setw(10) << static_cast<double>(result.fileBytes) / mib <<
+            std::setw(10) << result.meanUs <<
+            std::setw(10) << result.maxUs <<
+            std::setw(11) << static_cast<double>(result.streamBytes) / mib <<
+            std::setw(10) << result.residentGrowth / 1024 <<
+            std::setw(8) << result.stats.loads <<
+            std::setw(8) << result.stats.syncLoads <<
+            std::setw(8) << result.stats.dropped <<
+            std::setw(8) << result.stats.evictions << "\n";
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,117 @@
+// Measures a HUD of changing numbers: every frame, COUNT numbers that all
+// differ from the previous frame are drawn next to COUNT / 4 fixed labels,
+// then queued and submitted. SDL runs on the dummy video driver with a
+// software renderer, so only the submit time includes rasterization.
+//
+// Usage: bench-text [COUNT] [--seconds S]
+
+#include "build-info.hpp"
+#include "queue.hpp"
+#include "resources.hpp"
+#include "text.hpp"
+#include "window.hpp"
+
+#include "sdl.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    size_t count = 400;
+    double seconds = 1.0;
+    for (int i = 1; i < argc; i++) {
+        auto arg = std::string_view{argv[i]};
+        if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        } else if (!arg.starts_with("-")) {
+            count = std::stoul(std::string{arg});
+        } else {
+            std::cerr << "usage: bench-text [COUNT] [--seconds S]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Lets SDL_VIDEODRIVER from the environment take priority
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+
+    auto sdlInit = sdl::Init{SDL_INIT_VIDEO};
+    auto imgInit = img::Init{IMG_INIT_PNG};
+
+    auto window = Window{
+        SDL_WINDOW_HIDDEN, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE};
+    auto resources = Resources{window.renderer()};
+    resources.load(bi::dataFile);
+    const auto& font = resources.font(r::Font::Mono);
+    float line = static_cast<float>(font.lineHeight);
+
+    auto labels = std::vector<std::string>{};
+    for (size_t i = 0; i < count / 4; i++) {
+        labels.push_back("counter " + std::to_string(i));
+    }
+
+    auto text = Text{};
+    auto queue = RenderQueue{};
+    auto layoutTime = Clock::duration{};
+    auto submitTime = Clock::duration{};
+    size_t glyphs = 0;
+    size_t drawCalls = 0;
+    int64_t frames = 0;
+    auto start = Clock::now();
+    do {
+        auto frameStart = Clock::now();
+        for (size_t i = 0; i < labels.size(); i++) {
+            text.draw(font, labels[i], {0, line * static_cast<float>(i % 48)});
+        }
+        for (size_t i = 0; i < count; i++) {
+            auto value = static_cast<int64_t>(i) * 1'000'003 + frames;
+            text.draw(
+                font,
+                value,
+                {200 + 160 * static_cast<float>(i / 48),
+                    line * static_cast<float>(i % 48)});
+        }
+        text.submit(queue, 0);
+        auto laidOut = Clock::now();
+        queue.submit(window.renderer());
+        window.renderer().present();
+        auto submitted = Clock::now();
+
+        layoutTime += laidOut - frameStart;
+        submitTime += submitted - laidOut;
+        glyphs += text.stats().glyphs;
+        drawCalls += queue.stats().batches;
+        frames++;
+    } while (frames < 100 ||
+        std::chrono::duration<double>{Clock::now() - start}.count() < seconds);
+
+    using Us = std::chrono::duration<double, std::micro>;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << count << " numbers and " << labels.size() << " labels, " <<
+        frames << " frames, " << glyphs / frames << " glyphs and " <<
+        drawCalls / frames << " draw call(s) per frame\n";
+    std::cout << "layout and queue: " << Us{layoutTime}.count() / frames <<
+        " us/frame, " << Us{layoutTime}.count() * 1000 / glyphs <<
+        " ns/glyph\n";
+    std::cout << "submit and present: " << Us{submitTime}.count() / frames <<
+        " us/frame\n";
+    std::cout << "layout cache: " << text.stats().cachedLayouts <<
+        " layouts, " << text.stats().cacheHits << " hits and " <<
+        text.stats().cacheMisses << " misses in the last frame\n";
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,241 @@
+// Predicts the paths of many balls per frame through generated levels of
+// increasing size, as aim guides and computer players would:
+//
+// - scan: every bounce checks all bricks, as a loop over collision() would
+// - grid: the predictor, on a fresh frame, after the bricks changed
+// - cached: the same queries again, with nothing changed in the world
+//
+// The predictor must find the same bounces as the scan. The scan is skipped
+// on the largest levels.
+//
+// Usage: bench-trajectory [QUERIES_PER_FRAME] [FRAMES]
+
+#include "levels.hpp"
+#include "trajectory.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Us = std::chrono::duration<double, std::micro>;
+
+constexpr size_t maxScanBricks = 100'000;
+constexpr float horizon = 4;
+constexpr size_t maxBounces = 8;
+
+std::vector<Rectangle> levelBricks(size_t count)
+{
+    auto bricks = std::vector<Rectangle>{};
+    for (const auto& brick : generateBricks(GeneratorOptions{
+            .seed = count,
+            .bricks = count,
+            .sizeSpread = 0.5f,
+            .clustering = 0.5f,
+        })) {
+        bricks.push_back(Rectangle{
+            {(brick.xmin() + brick.xmax()) / 2,
+                (brick.ymin() + brick.ymax()) / 2},
+            brick.xmax() - brick.xmin(),
+            brick.ymax() - brick.ymin()});
+    }
+    return bricks;
+}
+
+// Balls below the bricks, flying up at the game's speed in all directions
+std::vector<TrajectoryQuery> frameQueries(size_t count, int frame)
+{
+    auto queries = std::vector<TrajectoryQuery>{};
+    for (size_t i = 0; i < count; i++) {
+        float t = static_cast<float>(i) + static_cast<float>(frame) * 0.37f;
+        float angle = 0.3f + 2.5f * std::fmod(t * 0.618034f, 1.f);
+        queries.push_back(TrajectoryQuery{
+            .ball = {
+                .center = {-11 + 22 * std::fmod(t * 0.414214f, 1.f), 4},
+                .radius = 0.5f,
+            },
+            .velocity = {
+                std::cos(angle) * 8.94f, std::sin(angle) * 8.94f},
+            .horizon = horizon,
+            .maxBounces = maxBounces,
+        });
+    }
+    return queries;
+}
+
+// The predictor's rules, with every brick checked on every bounce
+std::vector<size_t> scanBounces(const World& world, TrajectoryQuery query)
+{
+    auto bricks = world.bricks();
+    auto walls = world.walls();
+    auto hitBricks = std::vector<size_t>{};
+    auto obstacles = std::vector<size_t>{};
+    size_t ignore = query.ignore;
+    float time = 0;
+    while (obstacles.size() < query.maxBounces && time < query.horizon) {
+        float remaining = query.horizon - time;
+        auto best = Collision{};
+        size_t obstacle = SIZE_MAX;
+        auto check = [&] (size_t id, const Rectangle& rectangle) {
+            if (id == ignore ||
+                    std::ranges::find(hitBricks, id) != hitBricks.end()) {
+                return;
+            }
+            auto c = collision(query.ball, query.velocity, rectangle);
+            if (c < best) {
+                best = c;
+                obstacle = id;
+            }
+        };
+        for (size_t i = 0; i < bricks.size(); i++) {
+            if (world.brickAlive(i)) {
+                check(i, bricks[i]);
+            }
+        }
+        check(bricks.size(), world.pad());
+        for (size_t i = 0; i < walls.size(); i++) {
+            check(bricks.size() + 1 + i, walls[i]);
+        }
+
+        if (query.velocity.y < 0) {
+            float drop = std::max(
+                (world.field().ymin() - query.ball.radius -
+                    query.ball.center.y) / query.velocity.y,
+                0.f);
+            if (drop <= remaining && !(best.time < drop)) {
+                break;
+            }
+        }
+        if (!best || best.time > remaining) {
+            break;
+        }
+
+        query.ball.center += query.velocity * best.time;
+        query.velocity = reflect(query.velocity, best.norm);
+        time += best.time;
+        ignore = obstacle;
+        if (obstacle < bricks.size()) {
+            hitBricks.push_back(obstacle);
+        }
+        obstacles.push_back(obstacle);
+    }
+    return obstacles;
+}
+
+struct Result {
+    double scanUs = 0;
+    double gridUs = 0;
+    double cachedUs = 0;
+    double bounces = 0;
+    double checked = 0;
+};
+
+Result measure(size_t brickCount, size_t queryCount, int frames)
+{
+    auto world = World{};
+    world.setupLevel(levelBricks(brickCount));
+    auto predictor = TrajectoryPredictor{world};
+    bool scan = brickCount <= maxScanBricks;
+
+    auto result = Result{};
+    double scanUs = 0;
+    double gridUs = 0;
+    double cachedUs = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        auto queries = frameQueries(queryCount, frame);
+        // The ball plays on between frames, and may destroy bricks
+        world.update(1.f / 60);
+
+        auto stats = predictor.stats();
+        auto start = Clock::now();
+        for (const auto& query : queries) {
+            predictor.predict(query);
+        }
+        gridUs += Us{Clock::now() - start}.count();
+        auto fresh = predictor.stats();
+        result.checked +=
+            static_cast<double>(fresh.bricksChecked - stats.bricksChecked);
+
+        start = Clock::now();
+        for (const auto& query : queries) {
+            result.bounces += static_cast<double>(
+                predictor.predict(query).bounces.size());
+        }
+        cachedUs += Us{Clock::now() - start}.count();
+        if (predictor.stats().cacheHits - fresh.cacheHits != queries.size()) {
+            throw std::runtime_error{
+                "queries on an unchanged world missed the cache"};
+        }
+
+        if (!scan) {
+            continue;
+        }
+        start = Clock::now();
+        for (const auto& query : queries) {
+            auto expected = scanBounces(world, query);
+            const auto& trajectory = predictor.predict(query);
+            if (!std::ranges::equal(expected, trajectory.bounces, {}, {},
+                    &Bounce::obstacle)) {
+                throw std::runtime_error{std::format(
+                    "{} bricks: the grid and the scan bounce differently",
+                    brickCount)};
+            }
+        }
+        scanUs += Us{Clock::now() - start}.count();
+    }
+
+    double queries = static_cast<double>(queryCount) * frames;
+    result.scanUs = scan ? scanUs / queries : 0;
+    result.gridUs = gridUs / queries;
+    result.cachedUs = cachedUs / queries;
+    result.bounces /= queries;
+    result.checked /= queries;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    size_t queries = argc > 1 ? std::stoul(argv[1]) : 1000;
+    int frames = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    std::cout << queries << " queries per frame, " << frames << " frames, " <<
+        horizon << " s or " << maxBounces << " bounces ahead\n\n";
+    std::cout << std::setw(9) << "bricks" << std::setw(10) << "scan us" <<
+        std::setw(10) << "grid us" << std::setw(11) << "cached us" <<
+        std::setw(10) << "bounces" << std::setw(10) << "checked" <<
+        std::setw(12) << "frame ms" << "\n";
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (size_t bricks : {1'000, 10'000, 100'000, 1'000'000}) {
+        auto result = measure(bricks, queries, frames);
+        std::cout << std::setw(9) << bricks << std::setw(10);
+        if (result.scanUs > 0) {
+            std::cout << result.scanUs;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << std::setw(10) << result.gridUs <<
+            std::setw(11) << result.cachedUs <<
+            std::setw(10) << result.bounces <<
+            std::setw(10) << result.checked <<
+            std::setw(12) << result.gridUs * static_cast<double>(queries) / 1000 <<
+            "\n";
+    }
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,94 @@
+// Replacements of the global operator new and operator delete that count
+// every allocation of the process, which is what makes allocations in the
+// frame loop visible. They are part of the game and not of the core, so
+// that benches and tools that link the core keep the standard ones.
+//
+// Array and nothrow forms call these, aligned ones included, so replacing
+// the plain and the aligned forms covers all of them.
+
+#include "perf.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+// Retries through the new handler, as the standard operator new does
+template <class F>
+void* allocate(F&& tryAllocate)
+{
+    perfCounters().allocations.fetch_add(1, std::memory_order_relaxed);
+    for (;;) {
+        if (void* ptr = tryAllocate()) {
+            return ptr;
+        }
+        auto handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc{};
+        }
+        handler();
+    }
+}
+
+void countDeallocation(void* ptr)
+{
+    if (ptr) {
+        perfCounters().deallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    return allocate([size] {
+        return std::malloc(size == 0 ? 1 : size);
+    });
+}
+
+// aligned_alloc() wants a size that is a multiple of the alignment, and
+// Windows has no aligned_alloc() at all
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    auto align = static_cast<std::size_t>(alignment);
+    size = (std::max<std::size_t>(size, 1) + align - 1) / align * align;
+    return allocate([size, align] {
+#ifdef _WIN32
+        return _aligned_malloc(size, align);
+#else
+        return std::aligned_alloc(align, size);
+#endif
+    });
+}
+
+void operator delete(void* ptr) noexcept
+{
+    countDeallocation(ptr);
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    countDeallocation(ptr);
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
@@ -0,0 +1,153 @@
+#include "animation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+uint32_t microseconds(float seconds)
+{
+    return static_cast<uint32_t>(std::lround(seconds * 1e6f));
+}
+
+} // namespace
+
+void Animations::setup(std::span<const Sprite> sprites)
+{
+    if (sprites.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error{"Animations: too many sprites"};
+    }
+
+    // Times of instances are taken before the tables they depend on change
+    auto times = std::vector<uint32_t>(_sprites.size());
+    for (size_t i = 0; i < _sprites.size(); i++) {
+        times[i] = time(i);
+    }
+
+    _cycles.clear();
+    _firstFrames.clear();
+    _frameEnds.clear();
+    for (const auto& sprite : sprites) {
+        _firstFrames.push_back(static_cast<uint32_t>(_frameEnds.size()));
+        uint32_t end = 0;
+        for (const auto& frame : sprite.frames) {
+            end += static_cast<uint32_t>(std::max(frame.duration, 0)) * 1000;
+            _frameEnds.push_back(end);
+        }
+        _cycles.push_back(end);
+    }
+
+    for (size_t i = 0; i < _sprites.size(); i++) {
+        seek(i, times[i]);
+    }
+}
+
+size_t Animations::add(r::Sprite sprite, float startSeconds)
+{
+    _sprites.push_back(static_cast<uint16_t>(sprite));
+    _remaining.push_back(0);
+    _frames.push_back(0);
+
+    auto instance = _sprites.size() - 1;
+    seek(instance, microseconds(startSeconds));
+    return instance;
+}
+
+void Animations::clear()
+{
+    _sprites.clear();
+    _remaining.clear();
+    _frames.clear();
+    _changed.clear();
+}
+
+size_t Animations::size() const
+{
+    return _sprites.size();
+}
+
+// The countdown pass has no branches and is vectorized. Instances whose frame
+// ran out are rare, and are advanced in a separate pass.
+void Animations::update(float deltaSeconds)
+{
+    _changed.clear();
+
+    auto delta = static_cast<int32_t>(microseconds(deltaSeconds));
+    int32_t* remaining = _remaining.data();
+    size_t n = _remaining.size();
+    for (size_t i = 0; i < n; i++) {
+        remaining[i] -= delta;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (remaining[i] <= 0) {
+            advance(i);
+        }
+    }
+}
+
+r::Sprite Animations::sprite(size_t instance) const
+{
+    return static_cast<r::Sprite>(_sprites[instance]);
+}
+
+size_t Animations::frame(size_t instance) const
+{
+    return _frames[instance];
+}
+
+const std::vector<size_t>& Animations::changed() const
+{
+    return _changed;
+}
+
+uint32_t Animations::time(size_t instance) const
+{
+    auto sprite = _sprites[instance];
+    if (_cycles[sprite] == 0) {
+        return 0;
+    }
+    auto end = _frameEnds[_firstFrames[sprite] + _frames[instance]];
+    return end - static_cast<uint32_t>(_remaining[instance]);
+}
+
+// Sprites that do not animate get a countdown that never runs out
+void Animations::seek(size_t instance, uint32_t time)
+{
+    auto sprite = _sprites.at(instance);
+    auto cycle = _cycles.at(sprite);
+    if (cycle == 0) {
+        _frames[instance] = 0;
+        _remaining[instance] = std::numeric_limits<int32_t>::max();
+        return;
+    }
+
+    time %= cycle;
+    const uint32_t* ends = _frameEnds.data() + _firstFrames[sprite];
+    uint16_t frame = 0;
+    while (ends[frame] <= time) {
+        frame++;
+    }
+    _frames[instance] = frame;
+    _remaining[instance] = static_cast<int32_t>(ends[frame] - time);
+}
+
+void Animations::advance(size_t instance)
+{
+    auto sprite = _sprites[instance];
+    auto cycle = _cycles[sprite];
+    if (cycle == 0) {
+        _remaining[instance] = std::numeric_limits<int32_t>::max();
+        return;
+    }
+
+    auto oldFrame = _frames[instance];
+    auto overshoot = static_cast<uint32_t>(-_remaining[instance]);
+    auto end = _frameEnds[_firstFrames[sprite] + oldFrame];
+    seek(instance, (end + overshoot) % cycle);
+    if (_frames[instance] != oldFrame) {
+        _changed.push_back(instance);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "resources.hpp"
+
+#include "r.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Plays sprite animations for many instances at once. Instance state is kept
+// in parallel arrays, and update() advances all of them in one pass. Frame
+// durations are in milliseconds, as exported from Aseprite; internally time is
+// counted in whole microseconds, so that it does not drift. A sprite cycle
+// must be shorter than half an hour.
+class Animations {
+public:
+    // Takes frame durations from the sprites, indexed by r::Sprite. Must be
+    // called before adding instances, and again when the sprites change;
+    // instances keep their time, and their frames are looked up again.
+    void setup(std::span<const Sprite> sprites);
+
+    // Returns the index of the new instance. Indices are stable until clear().
+    size_t add(r::Sprite sprite, float startSeconds = 0);
+    void clear();
+    size_t size() const;
+
+    void update(float deltaSeconds);
+
+    r::Sprite sprite(size_t instance) const;
+    // Index of the current frame within the sprite
+    size_t frame(size_t instance) const;
+
+    // Instances whose frame changed in the last update()
+    const std::vector<size_t>& changed() const;
+
+private:
+    // Time into the animation, between zero and the cycle length
+    uint32_t time(size_t instance) const;
+    void seek(size_t instance, uint32_t time);
+    void advance(size_t instance);
+
+    // Per sprite: total length of the animation, and where its frames start
+    // in _frameEnds. A sprite with zero total length never changes frames.
+    std::vector<uint32_t> _cycles;
+    std::vector<uint32_t> _firstFrames;
+    // End time of every frame relative to the start of its animation, so
+    // the current frame is the first one that ends after the current time
+    std::vector<uint32_t> _frameEnds;
+
+    // Instances count down the time left in their current frame, so most of
+    // them only need a subtraction per update
+    std::vector<uint16_t> _sprites;
+    std::vector<int32_t> _remaining;
+    std::vector<uint16_t> _frames;
+    std::vector<size_t> _changed;
+};
@@ -0,0 +1,208 @@
+#include "audio.hpp"
+
+#include "config.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define BOO_AUDIO_SSE2
+#endif
+
+namespace {
+
+// Largest power of two that is shorter than a frame
+Uint16 deviceBufferFrames()
+{
+    auto frames = static_cast<unsigned>(Mixer::frequency / config.fps);
+    return static_cast<Uint16>(std::bit_floor(std::max(frames, 2u) - 1));
+}
+
+void clamp(float* samples, size_t count)
+{
+    size_t i = 0;
+#if defined(BOO_AUDIO_SSE2)
+    const __m128 low = _mm_set1_ps(-1.f);
+    const __m128 high = _mm_set1_ps(1.f);
+    for (; i + 4 <= count; i += 4) {
+        __m128 value = _mm_loadu_ps(samples + i);
+        _mm_storeu_ps(samples + i, _mm_min_ps(_mm_max_ps(value, low), high));
+    }
+#endif
+    for (; i < count; i++) {
+        samples[i] = std::clamp(samples[i], -1.f, 1.f);
+    }
+}
+
+} // namespace
+
+Mixer::Mixer(std::vector<std::vector<float>> sounds)
+    : _sounds(std::move(sounds))
+{ }
+
+// Constant power panning: the gains follow a quarter of a circle
+uint32_t Mixer::play(r::Sound sound, float volume, float pan)
+{
+    float angle = (std::clamp(pan, -1.f, 1.f) + 1) * std::numbers::pi_v<float> / 4;
+    auto command = Command{
+        .type = Command::Type::Play,
+        .sound = static_cast<uint32_t>(sound),
+        .voice = _nextVoiceId,
+        .gainLeft = volume * std::cos(angle),
+        .gainRight = volume * std::sin(angle),
+    };
+    if (!_commands.push(command)) {
+        _droppedCommands.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    // Zero is never an id
+    if (++_nextVoiceId == 0) {
+        _nextVoiceId = 1;
+    }
+    return command.voice;
+}
+
+void Mixer::stop(uint32_t voice)
+{
+    send(Command{.type = Command::Type::Stop, .voice = voice});
+}
+
+void Mixer::stopAll()
+{
+    send(Command{.type = Command::Type::StopAll});
+}
+
+void Mixer::render(std::span<float> samples)
+{
+    auto command = Command{};
+    while (_commands.pop(command)) {
+        apply(command);
+    }
+
+    std::fill(samples.begin(), samples.end(), 0.f);
+    for (size_t i = 0; i < _voiceCount; ) {
+        mix(_voices[i], samples.data(), samples.size());
+        if (_voices[i].position >= _voices[i].length) {
+            _voices[i] = _voices[--_voiceCount];
+        } else {
+            i++;
+        }
+    }
+    clamp(samples.data(), samples.size());
+
+    _activeVoices.store(_voiceCount, std::memory_order_relaxed);
+}
+
+size_t Mixer::activeVoices() const
+{
+    return _activeVoices.load(std::memory_order_relaxed);
+}
+
+size_t Mixer::droppedCommands() const
+{
+    return _droppedCommands.load(std::memory_order_relaxed);
+}
+
+void Mixer::send(const Command& command)
+{
+    if (!_commands.push(command)) {
+        _droppedCommands.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Mixer::apply(const Command& command)
+{
+    switch (command.type) {
+        case Command::Type::Play: {
+            if (_voiceCount == maxVoices || command.sound >= _sounds.size()) {
+                return;
+            }
+            const auto& sound = _sounds[command.sound];
+            _voices[_voiceCount++] = Voice{
+                .samples = sound.data(),
+                .length = sound.size(),
+                .position = 0,
+                .gainLeft = command.gainLeft,
+                .gainRight = command.gainRight,
+                .id = command.voice,
+            };
+            break;
+        }
+        case Command::Type::Stop:
+            for (size_t i = 0; i < _voiceCount; i++) {
+                if (_voices[i].id == command.voice) {
+                    _voices[i] = _voices[--_voiceCount];
+                    break;
+                }
+            }
+            break;
+        case Command::Type::StopAll:
+            _voiceCount = 0;
+            break;
+    }
+}
+
+// Samples are interleaved left and right, so four floats are two frames, and
+// the gains are applied as (left, right, left, right)
+void Mixer::mix(Voice& voice, float* samples, size_t count)
+{
+    size_t n = std::min(count, voice.length - voice.position);
+    const float* source = voice.samples + voice.position;
+
+    size_t i = 0;
+#if defined(BOO_AUDIO_SSE2)
+    const __m128 gains = _mm_setr_ps(
+        voice.gainLeft, voice.gainRight, voice.gainLeft, voice.gainRight);
+    for (; i + 4 <= n; i += 4) {
+        __m128 mixed = _mm_add_ps(
+            _mm_loadu_ps(samples + i),
+            _mm_mul_ps(_mm_loadu_ps(source + i), gains));
+        _mm_storeu_ps(samples + i, mixed);
+    }
+#endif
+    for (; i < n; i++) {
+        samples[i] += source[i] * (i % 2 == 0 ? voice.gainLeft : voice.gainRight);
+    }
+
+    voice.position += n;
+}
+
+Audio::Audio(std::vector<std::vector<float>> sounds)
+    : _mixer(std::move(sounds))
+    , _spec{
+        .freq = Mixer::frequency,
+        .format = AUDIO_F32SYS,
+        .channels = Mixer::channels,
+        .silence = 0,
+        .samples = deviceBufferFrames(),
+        .padding = 0,
+        .size = 0,
+        .callback = callback,
+        .userdata = &_mixer,
+    }
+    , _device(_spec, _spec, 0)
+{
+    _device.pause(false);
+}
+
+Mixer& Audio::mixer()
+{
+    return _mixer;
+}
+
+int Audio::bufferFrames() const
+{
+    return _spec.samples;
+}
+
+void Audio::callback(void* userdata, Uint8* stream, int length)
+{
+    auto* mixer = static_cast<Mixer*>(userdata);
+    mixer->render({
+        reinterpret_cast<float*>(stream),
+        static_cast<size_t>(length) / sizeof(float)});
+}
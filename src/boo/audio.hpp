@@ -0,0 +1,102 @@
+#pragma once
+
+#include "spsc.hpp"
+
+#include "r.hpp"
+#include "sdl.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Mixes sound effects into interleaved stereo float samples. Commands are
+// sent from the game thread through a lock-free queue; render() runs on the
+// audio thread, and never locks or allocates. Nothing here depends on an
+// audio device, so the mix can also be rendered into a buffer.
+class Mixer {
+public:
+    static constexpr int frequency = 48000;
+    static constexpr int channels = 2;
+    static constexpr size_t maxVoices = 32;
+
+    // Sounds are indexed by r::Sound, in the format above
+    explicit Mixer(std::vector<std::vector<float>> sounds);
+
+    // Game thread. Pan goes from -1 (left) to 1 (right). Returns the id of
+    // the new voice, or zero if the command was dropped because the queue
+    // was full. When all voices are busy, the sound is not played.
+    uint32_t play(r::Sound sound, float volume = 1, float pan = 0);
+    void stop(uint32_t voice);
+    void stopAll();
+
+    // Audio thread. Applies pending commands, and overwrites the buffer with
+    // the mix of all voices, clamped to [-1, 1].
+    void render(std::span<float> samples);
+
+    // Safe to call from any thread
+    size_t activeVoices() const;
+    size_t droppedCommands() const;
+
+private:
+    struct Command {
+        enum class Type : uint8_t {
+            Play,
+            Stop,
+            StopAll,
+        };
+
+        Type type = Type::Play;
+        uint32_t sound = 0;
+        uint32_t voice = 0;
+        float gainLeft = 0;
+        float gainRight = 0;
+    };
+
+    struct Voice {
+        const float* samples = nullptr;
+        size_t length = 0;
+        size_t position = 0;
+        float gainLeft = 0;
+        float gainRight = 0;
+        uint32_t id = 0;
+    };
+
+    void send(const Command& command);
+    void apply(const Command& command);
+    void mix(Voice& voice, float* samples, size_t count);
+
+    std::vector<std::vector<float>> _sounds;
+    SpscQueue<Command, 256> _commands;
+
+    // Game thread state
+    uint32_t _nextVoiceId = 1;
+
+    // Audio thread state; active voices are kept at the front
+    std::array<Voice, maxVoices> _voices;
+    size_t _voiceCount = 0;
+
+    std::atomic<size_t> _activeVoices = 0;
+    std::atomic<size_t> _droppedCommands = 0;
+};
+
+// Plays the mixer on the default audio device. The device buffer is shorter
+// than one frame at config.fps, so sounds start within a frame of play().
+class Audio {
+public:
+    explicit Audio(std::vector<std::vector<float>> sounds);
+
+    Mixer& mixer();
+
+    // Samples per channel in one device buffer
+    int bufferFrames() const;
+
+private:
+    static void callback(void* userdata, Uint8* stream, int length);
+
+    Mixer _mixer;
+    SDL_AudioSpec _spec {};
+    sdl::AudioDevice _device;
+};
@@ -2,27 +2,194 @@
 
 #include "geometry.hpp"
 
+#include <array>
+#include <cmath>
+#include <compare>
+#include <concepts>
 #include <limits>
 #include <optional>
 
-std::optional<Vector> intersection(const Line& lhs, const Line& rhs);
-std::optional<Vector> intersection(const Ray& ray, const Segment& segment);
+// Collision functions are templates on the scalar type, like the geometry.
+// With Fixed, results are bit-identical across compilers, flags and CPUs.
 
-struct Collision {
-    explicit operator bool() const;
-    std::partial_ordering operator<=>(const Collision& other) const;
+template <Scalar T>
+constexpr std::optional<BasicVector<T>> intersection(
+    const BasicLine<T>& lhs, const BasicLine<T>& rhs)
+{
+    // lhs: a1 * x + b1 * y = c1
+    // rhs: a2 * x + b2 * y = c2
 
-    float time = std::numeric_limits<float>::infinity();
-    Norm norm;
+    T a1 = lhs.norm().x();
+    T b1 = lhs.norm().y();
+    T c1 = lhs.value();
+
+    T a2 = rhs.norm().x();
+    T b2 = rhs.norm().y();
+    T c2 = rhs.value();
+
+    T det = a1 * b2 - a2 * b1;
+    if (det == T{0}) {
+        return std::nullopt;
+    }
+
+    T dx = c1 * b2 - c2 * b1;
+    T dy = a1 * c2 - a2 * c1;
+
+    return BasicVector<T>{dx / det, dy / det};
+}
+
+template <Scalar T>
+constexpr std::optional<BasicVector<T>> intersection(
+    const BasicRay<T>& ray, const BasicSegment<T>& segment)
+{
+    auto x = intersection(ray.line(), segment.line());
+    if (!x) {
+        return std::nullopt;
+    }
+
+    if (ray.contains(*x) && segment.contains(*x)) {
+        return x;
+    }
+    return std::nullopt;
+}
+
+// No collision is an infinite time for floating point types, and the largest
+// representable time for Fixed
+template <Scalar T>
+struct BasicCollision {
+    static constexpr T never = [] {
+        if constexpr (std::numeric_limits<T>::has_infinity) {
+            return std::numeric_limits<T>::infinity();
+        } else {
+            return std::numeric_limits<T>::max();
+        }
+    }();
+
+    constexpr explicit operator bool() const
+    {
+        if constexpr (std::floating_point<T>) {
+            return std::isfinite(time);
+        } else {
+            return time != never;
+        }
+    }
+
+    constexpr std::partial_ordering operator<=>(
+        const BasicCollision& other) const
+    {
+        return time <=> other.time;
+    }
+
+    T time = never;
+    BasicNorm<T> norm;
 };
 
-Collision collision(
-    const Vector& point, const Vector& velocity, const Circle& circle);
-Collision collision(
-    const Circle& circle, const Vector& velocity, const Vector& point);
+template <Scalar T>
+constexpr BasicCollision<T> collision(
+    const BasicVector<T>& point,
+    const BasicVector<T>& velocity,
+    const BasicCircle<T>& circle)
+{
+    T r = circle.radius;
+    auto n = velocity.norm();
+    auto u = ccw(n);
+
+    // Comparing |d| instead of d * d keeps Fixed from overflowing on far
+    // away circles
+    T d = dot(u, circle.center) - dot(u, point);
+    if (d > r || -d > r) {
+        return {};
+    }
+
+    // A circle behind the point, or one the point is already inside of, is
+    // not a collision
+    T lp = dot(n, circle.center) - dot(n, point);
+    T lq = lp - squareRoot(r * r - d * d);
+    if (lq < T{0}) {
+        return {};
+    }
+
+    return BasicCollision<T>{
+        .time = lq / velocity.len(),
+        .norm = BasicNorm<T>{point + lq * n - circle.center},
+    };
+}
+
+template <Scalar T>
+constexpr BasicCollision<T> collision(
+    const BasicCircle<T>& circle,
+    const BasicVector<T>& velocity,
+    const BasicVector<T>& point)
+{
+    return collision(
+        circle.center, velocity, BasicCircle<T>{point, circle.radius});
+}
+
+template <Scalar T>
+constexpr BasicCollision<T> collision(
+    const BasicVector<T>& point,
+    const BasicVector<T>& velocity,
+    const BasicSegment<T>& segment)
+{
+    auto x = intersection(BasicRay<T>{point, velocity}, segment);
+    if (!x) {
+        return {};
+    }
+
+    auto collisionNorm = segment.line().norm();
+    if (dot(*x - point, collisionNorm) > T{0}) {
+        collisionNorm = -collisionNorm;
+    }
+
+    return BasicCollision<T>{
+        .time = (*x - point).len() / velocity.len(),
+        .norm = collisionNorm,
+    };
+}
+
+template <Scalar T>
+constexpr BasicCollision<T> collision(
+    const BasicCircle<T>& circle,
+    const BasicVector<T>& velocity,
+    const BasicRectangle<T>& rectangle)
+{
+    auto angleCircles = std::array{
+        BasicCircle<T>{rectangle.topLeft(), circle.radius},
+        BasicCircle<T>{rectangle.topRight(), circle.radius},
+        BasicCircle<T>{rectangle.bottomRight(), circle.radius},
+        BasicCircle<T>{rectangle.bottomLeft(), circle.radius},
+    };
+
+    auto sides = std::array{
+        shift(rectangle.top(), {T{0}, circle.radius}),
+        shift(rectangle.bottom(), {T{0}, -circle.radius}),
+        shift(rectangle.left(), {-circle.radius, T{0}}),
+        shift(rectangle.right(), {circle.radius, T{0}}),
+    };
+
+    auto bestCollision = BasicCollision<T>{};
+    for (const auto& angleCircle : angleCircles) {
+        auto c = collision(circle.center, velocity, angleCircle);
+        if (c < bestCollision) {
+            bestCollision = c;
+        }
+    }
+    for (const auto& side : sides) {
+        auto c = collision(circle.center, velocity, side);
+        if (c < bestCollision) {
+            bestCollision = c;
+        }
+    }
+
+    return bestCollision;
+}
 
-Collision collision(
-    const Vector& point, const Vector& velocity, const Segment& segment);
+// Velocity after bouncing off a surface with the given normal
+template <Scalar T>
+constexpr BasicVector<T> reflect(
+    const BasicVector<T>& vector, const BasicNorm<T>& norm)
+{
+    return vector - norm * (T{2} * dot(vector, norm));
+}
 
-Collision collision(
-    const Circle& circle, const Vector& velocity, const Rectangle& rectangle);
\ No newline at end of file
+using Collision = BasicCollision<float>;
\ No newline at end of file
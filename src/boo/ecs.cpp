@@ -0,0 +1,311 @@
+#include "ecs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <format>
+#include <mutex>
+
+namespace {
+
+// Written once per type and only read after, so lookups need no lock
+std::array<ComponentInfo, maxComponentTypes> components;
+std::atomic<size_t> componentCount = 0;
+std::mutex registerMutex;
+
+std::atomic<uint64_t> nextSerial = 1;
+
+size_t alignUp(size_t offset, size_t align)
+{
+    return (offset + align - 1) / align * align;
+}
+
+} // namespace
+
+size_t registerComponent(const ComponentInfo& info)
+{
+    auto lock = std::lock_guard{registerMutex};
+    size_t id = componentCount.load(std::memory_order_relaxed);
+    if (id == maxComponentTypes) {
+        throw std::runtime_error{std::format(
+            "more than {} component types", maxComponentTypes)};
+    }
+    components[id] = info;
+    componentCount.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+const ComponentInfo& componentInfo(size_t id)
+{
+    if (id >= componentCount.load(std::memory_order_acquire)) {
+        throw std::runtime_error{std::format("no component type {}", id)};
+    }
+    return components[id];
+}
+
+bool SystemAccess::conflicts(const SystemAccess& other) const
+{
+    return (writes & (other.reads | other.writes)) != 0 ||
+        (other.writes & reads) != 0;
+}
+
+Archetype::Archetype(ComponentMask mask)
+    : _mask(mask)
+{
+    _columnOf.fill(noColumn);
+    size_t rowSize = 0;
+    for (size_t id = 0; id < maxComponentTypes; id++) {
+        if (mask & (ComponentMask{1} << id)) {
+            const auto& info = componentInfo(id);
+            _columnOf[id] = static_cast<uint8_t>(_columns.size());
+            _columns.push_back({.component = id, .size = info.size});
+            rowSize += info.size;
+        }
+    }
+
+    // Entities without components still take their slot in the chunk
+    _capacity = std::max<size_t>(
+        chunkBytes / std::max(rowSize, sizeof(Entity)), 1);
+    for (auto& column : _columns) {
+        _chunkSize = alignUp(_chunkSize, componentInfo(column.component).align);
+        column.offset = _chunkSize;
+        _chunkSize += column.size * _capacity;
+    }
+}
+
+ComponentMask Archetype::mask() const
+{
+    return _mask;
+}
+
+size_t Archetype::size() const
+{
+    return _size;
+}
+
+size_t Archetype::chunkCount() const
+{
+    return _chunks.size();
+}
+
+std::span<const Entity> Archetype::entities(size_t chunk) const
+{
+    return _chunks.at(chunk).entities;
+}
+
+size_t Archetype::push(Entity entity)
+{
+    if (_size == _chunks.size() * _capacity) {
+        auto& chunk = _chunks.emplace_back();
+        chunk.data.resize(_chunkSize);
+        chunk.entities.reserve(_capacity);
+    }
+    _chunks[_size / _capacity].entities.push_back(entity);
+    return _size++;
+}
+
+Entity Archetype::swapRemove(size_t row)
+{
+    if (row >= _size) {
+        throw std::runtime_error{std::format(
+            "Archetype: no row {} of {}", row, _size)};
+    }
+
+    size_t last = _size - 1;
+    auto moved = Entity{};
+    if (row != last) {
+        for (const auto& column : _columns) {
+            std::memcpy(
+                element(column, row), element(column, last), column.size);
+        }
+        moved = _chunks[last / _capacity].entities.back();
+        _chunks[row / _capacity].entities[row % _capacity] = moved;
+    }
+
+    _chunks.back().entities.pop_back();
+    if (_chunks.back().entities.empty()) {
+        _chunks.pop_back();
+    }
+    _size--;
+    return moved;
+}
+
+void Archetype::copyShared(size_t row, const Archetype& from, size_t fromRow)
+{
+    for (const auto& column : _columns) {
+        uint8_t index = from._columnOf[column.component];
+        if (index != noColumn) {
+            std::memcpy(
+                element(column, row),
+                from.element(from._columns[index], fromRow),
+                column.size);
+        }
+    }
+}
+
+std::byte* Archetype::columnData(size_t chunk, size_t component)
+{
+    uint8_t index = _columnOf[component];
+    if (index == noColumn) {
+        throw std::runtime_error{std::format(
+            "Archetype: no component type {}", component)};
+    }
+    return _chunks[chunk].data.data() + _columns[index].offset;
+}
+
+const std::byte* Archetype::element(const Column& column, size_t row) const
+{
+    return _chunks[row / _capacity].data.data() + column.offset +
+        row % _capacity * column.size;
+}
+
+std::byte* Archetype::element(const Column& column, size_t row)
+{
+    return _chunks[row / _capacity].data.data() + column.offset +
+        row % _capacity * column.size;
+}
+
+Registry::Serial::Serial()
+    : _value(nextSerial++)
+{ }
+
+Registry::Serial::Serial(const Serial&)
+    : Serial()
+{ }
+
+Registry::Serial& Registry::Serial::operator=(const Serial&)
+{
+    _value = nextSerial++;
+    return *this;
+}
+
+uint64_t Registry::Serial::value() const
+{
+    return _value;
+}
+
+Registry::Registry()
+{
+    archetypeFor(0);
+}
+
+void Registry::destroy(Entity entity)
+{
+    record(entity);
+    auto& r = _records[entity.index];
+    auto moved = _archetypes[r.archetype].swapRemove(r.row);
+    if (moved) {
+        _records[moved.index].row = r.row;
+    }
+    r.alive = false;
+    r.generation++;
+    _free.push_back(entity.index);
+    _size--;
+}
+
+bool Registry::alive(Entity entity) const
+{
+    return entity.index < _records.size() &&
+        _records[entity.index].alive &&
+        _records[entity.index].generation == entity.generation;
+}
+
+size_t Registry::size() const
+{
+    return _size;
+}
+
+size_t Registry::archetypeCount() const
+{
+    return _archetypes.size();
+}
+
+const Registry::Record& Registry::record(Entity entity) const
+{
+    if (!alive(entity)) {
+        throw std::runtime_error{std::format(
+            "Registry: entity {}:{} is not alive",
+            entity.index, entity.generation)};
+    }
+    return _records[entity.index];
+}
+
+uint32_t Registry::archetypeFor(ComponentMask mask)
+{
+    auto [it, added] = _archetypeIndex.try_emplace(
+        mask, static_cast<uint32_t>(_archetypes.size()));
+    if (added) {
+        _archetypes.emplace_back(mask);
+    }
+    return it->second;
+}
+
+void Registry::move(Entity entity, uint32_t archetype)
+{
+    record(entity);
+    auto& r = _records[entity.index];
+    auto& from = _archetypes[r.archetype];
+    auto& to = _archetypes[archetype];
+
+    size_t row = to.push(entity);
+    to.copyShared(row, from, r.row);
+    auto moved = from.swapRemove(r.row);
+    if (moved) {
+        _records[moved.index].row = r.row;
+    }
+    r.archetype = archetype;
+    r.row = static_cast<uint32_t>(row);
+}
+
+Entity Registry::allocate()
+{
+    if (!_free.empty()) {
+        uint32_t index = _free.back();
+        _free.pop_back();
+        return Entity{index, _records[index].generation};
+    }
+    _records.emplace_back();
+    return Entity{static_cast<uint32_t>(_records.size() - 1), 0};
+}
+
+void SystemSchedule::add(const SystemAccess& access, System system)
+{
+    size_t stage = 0;
+    for (size_t i = _stages.size(); i > 0; i--) {
+        if (std::ranges::any_of(_stages[i - 1], [&] (size_t other) {
+                return _systems[other].access.conflicts(access);
+            })) {
+            stage = i;
+            break;
+        }
+    }
+
+    if (stage == _stages.size()) {
+        _stages.emplace_back();
+    }
+    _stages[stage].push_back(_systems.size());
+    _systems.push_back({access, std::move(system)});
+}
+
+void SystemSchedule::run(Registry& registry, JobSystem* jobs)
+{
+    if (!jobs) {
+        for (auto& entry : _systems) {
+            entry.system(registry);
+        }
+        return;
+    }
+
+    for (const auto& stage : _stages) {
+        jobs->parallelFor(stage.size(), 1, [&] (size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                _systems[stage[i]].system(registry);
+            }
+        });
+    }
+}
+
+size_t SystemSchedule::stages() const
+{
+    return _stages.size();
+}
@@ -0,0 +1,439 @@
+#pragma once
+
+#include "jobs.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Handle of an entity in a Registry. The generation tells an entity apart
+// from a later one that reuses its index.
+struct Entity {
+    static constexpr uint32_t none = UINT32_MAX;
+
+    uint32_t index = none;
+    uint32_t generation = 0;
+
+    bool operator==(const Entity& other) const = default;
+
+    explicit operator bool() const
+    {
+        return index != none;
+    }
+};
+
+// Components are plain values. Storage moves them with memcpy and never
+// runs their destructors.
+template <class C>
+concept Component = std::is_trivially_copyable_v<C> &&
+    std::is_default_constructible_v<C> &&
+    alignof(C) <= alignof(std::max_align_t);
+
+using ComponentMask = uint64_t;
+inline constexpr size_t maxComponentTypes = 64;
+
+struct ComponentInfo {
+    size_t size = 0;
+    size_t align = 0;
+};
+
+// Component types are numbered in the order they are first used, the same
+// for all registries of the process
+size_t registerComponent(const ComponentInfo& info);
+const ComponentInfo& componentInfo(size_t id);
+
+template <Component C>
+size_t componentId()
+{
+    static const size_t id = registerComponent({sizeof(C), alignof(C)});
+    return id;
+}
+
+template <class... Cs>
+ComponentMask componentMask()
+{
+    auto mask = ComponentMask{0};
+    ((mask |= ComponentMask{1} << componentId<std::remove_const_t<Cs>>()), ...);
+    return mask;
+}
+
+// Components that a system reads and writes. Systems conflict when one
+// writes what the other reads or writes.
+struct SystemAccess {
+    ComponentMask reads = 0;
+    ComponentMask writes = 0;
+
+    bool conflicts(const SystemAccess& other) const;
+};
+
+// Entities that have the same set of components. They are stored in chunks
+// of about chunkBytes, and within a chunk every component is a packed
+// array, so that a query walks contiguous memory of only the components it
+// asks for. Entities stay dense: removing one moves the last one into its
+// place, so only the last chunk is partly filled.
+class Archetype {
+public:
+    static constexpr size_t chunkBytes = 16 * 1024;
+
+    explicit Archetype(ComponentMask mask);
+
+    ComponentMask mask() const;
+    size_t size() const;
+    size_t chunkCount() const;
+    std::span<const Entity> entities(size_t chunk) const;
+
+    // First element of the component's array in a chunk
+    template <Component C>
+    C* column(size_t chunk);
+    template <Component C>
+    C& component(size_t row);
+
+    // Adds a row at the end, with components left as they are in memory
+    size_t push(Entity entity);
+    // Moves the last row into the removed one, and returns the entity that
+    // moved, or a null entity if it was the last one
+    Entity swapRemove(size_t row);
+    // Copies the components that both archetypes have
+    void copyShared(size_t row, const Archetype& from, size_t fromRow);
+
+private:
+    static constexpr uint8_t noColumn = UINT8_MAX;
+
+    struct Column {
+        size_t component = 0;
+        size_t size = 0;
+        // Of the array within every chunk
+        size_t offset = 0;
+    };
+
+    struct Chunk {
+        std::vector<std::byte> data;
+        std::vector<Entity> entities;
+    };
+
+    std::byte* columnData(size_t chunk, size_t component);
+    const std::byte* element(const Column& column, size_t row) const;
+    std::byte* element(const Column& column, size_t row);
+
+    ComponentMask _mask = 0;
+    std::vector<Column> _columns;
+    std::array<uint8_t, maxComponentTypes> _columnOf;
+    size_t _capacity = 0;
+    size_t _chunkSize = 0;
+    std::vector<Chunk> _chunks;
+    size_t _size = 0;
+};
+
+template <class... Cs>
+class Query;
+
+// Entities with any set of components, one archetype per set. Adding or
+// removing a component moves the entity to another archetype, which copies
+// its components; creating the first entity of a set adds the archetype.
+// References to components stay valid until the next such change.
+//
+// Copies of a registry have the same entities under the same handles.
+class Registry {
+public:
+    Registry();
+
+    template <Component... Cs>
+    Entity create(const Cs&... components);
+    void destroy(Entity entity);
+    bool alive(Entity entity) const;
+    size_t size() const;
+
+    template <Component C>
+    bool has(Entity entity) const;
+    template <Component C>
+    C& get(Entity entity);
+    template <Component C>
+    const C& get(Entity entity) const;
+    template <Component C>
+    void add(Entity entity, const C& component);
+    template <Component C>
+    void remove(Entity entity);
+
+    // Calls f with the components of every entity that has all of them. For
+    // repeated use, a Query remembers the archetypes that match.
+    template <class... Cs, class F>
+    void each(F&& f);
+
+    size_t archetypeCount() const;
+
+private:
+    template <class... Cs>
+    friend class Query;
+
+    struct Record {
+        uint32_t archetype = 0;
+        uint32_t row = 0;
+        uint32_t generation = 0;
+        bool alive = false;
+    };
+
+    // Tells registries apart for the queries that remember archetypes;
+    // copies, moves and assignments get a number of their own
+    class Serial {
+    public:
+        Serial();
+        Serial(const Serial&);
+        Serial& operator=(const Serial&);
+
+        uint64_t value() const;
+
+    private:
+        uint64_t _value = 0;
+    };
+
+    const Record& record(Entity entity) const;
+    uint32_t archetypeFor(ComponentMask mask);
+    void move(Entity entity, uint32_t archetype);
+    Entity allocate();
+
+    std::vector<Record> _records;
+    std::vector<uint32_t> _free;
+    std::vector<Archetype> _archetypes;
+    std::unordered_map<ComponentMask, uint32_t> _archetypeIndex;
+    size_t _size = 0;
+    Serial _serial;
+};
+
+// Entities that have all of the components Cs. Const components are only
+// read, which lets systems that read the same components run at the same
+// time. A query remembers which archetypes match, and only looks at
+// archetypes that were added since it last ran, so new kinds of entities
+// cost nothing to queries that do not match them.
+template <class... Cs>
+class Query {
+public:
+    static SystemAccess access();
+
+    // f(std::span<const Entity>, std::span<Cs>...) for every chunk
+    template <class F>
+    void eachChunk(Registry& registry, F&& f);
+    // f(Cs&...) for every entity
+    template <class F>
+    void each(Registry& registry, F&& f);
+    // Chunks are spread over the jobs, so f must not add or remove
+    // entities or components
+    template <class F>
+    void parallelEach(Registry& registry, JobSystem& jobs, F&& f);
+
+private:
+    void refresh(const Registry& registry);
+
+    uint64_t _serial = 0;
+    std::vector<uint32_t> _archetypes;
+    size_t _seen = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> _chunks;
+};
+
+// Systems that run in stages, once per run(). A system goes into the stage
+// after the last one that has a system it conflicts with, so conflicting
+// systems run in the order they were added, and the systems of a stage run
+// at the same time on the jobs.
+class SystemSchedule {
+public:
+    using System = std::move_only_function<void(Registry&)>;
+
+    void add(const SystemAccess& access, System system);
+    // A system that calls f with the components of every matching entity
+    template <class... Cs, class F>
+    void add(F&& f);
+
+    // Without jobs, systems run one by one in the order they were added
+    void run(Registry& registry, JobSystem* jobs = nullptr);
+    size_t stages() const;
+
+private:
+    struct Entry {
+        SystemAccess access;
+        System system;
+    };
+
+    std::vector<Entry> _systems;
+    std::vector<std::vector<size_t>> _stages;
+};
+
+template <Component C>
+C* Archetype::column(size_t chunk)
+{
+    return reinterpret_cast<C*>(columnData(chunk, componentId<C>()));
+}
+
+template <Component C>
+C& Archetype::component(size_t row)
+{
+    return column<C>(row / _capacity)[row % _capacity];
+}
+
+template <Component... Cs>
+Entity Registry::create(const Cs&... components)
+{
+    auto mask = componentMask<Cs...>();
+    if (std::popcount(mask) != sizeof...(Cs)) {
+        throw std::runtime_error{"Registry: components repeat"};
+    }
+
+    uint32_t index = archetypeFor(mask);
+    auto entity = allocate();
+    auto& archetype = _archetypes[index];
+    size_t row = archetype.push(entity);
+    ((archetype.component<Cs>(row) = components), ...);
+    _records[entity.index] = Record{
+        .archetype = index,
+        .row = static_cast<uint32_t>(row),
+        .generation = entity.generation,
+        .alive = true,
+    };
+    _size++;
+    return entity;
+}
+
+template <Component C>
+bool Registry::has(Entity entity) const
+{
+    const auto& r = record(entity);
+    return (_archetypes[r.archetype].mask() & componentMask<C>()) != 0;
+}
+
+template <Component C>
+C& Registry::get(Entity entity)
+{
+    if (!has<C>(entity)) {
+        throw std::runtime_error{"Registry: entity lacks the component"};
+    }
+    const auto& r = record(entity);
+    return _archetypes[r.archetype].component<C>(r.row);
+}
+
+template <Component C>
+const C& Registry::get(Entity entity) const
+{
+    return const_cast<Registry*>(this)->get<C>(entity);
+}
+
+template <Component C>
+void Registry::add(Entity entity, const C& component)
+{
+    if (!has<C>(entity)) {
+        auto mask = _archetypes[record(entity).archetype].mask();
+        move(entity, archetypeFor(mask | componentMask<C>()));
+    }
+    get<C>(entity) = component;
+}
+
+template <Component C>
+void Registry::remove(Entity entity)
+{
+    if (has<C>(entity)) {
+        auto mask = _archetypes[record(entity).archetype].mask();
+        move(entity, archetypeFor(mask & ~componentMask<C>()));
+    }
+}
+
+template <class... Cs, class F>
+void Registry::each(F&& f)
+{
+    auto query = Query<Cs...>{};
+    query.each(*this, f);
+}
+
+template <class... Cs>
+SystemAccess Query<Cs...>::access()
+{
+    auto result = SystemAccess{};
+    (((std::is_const_v<Cs> ? result.reads : result.writes) |=
+        componentMask<Cs>()), ...);
+    return result;
+}
+
+template <class... Cs>
+void Query<Cs...>::refresh(const Registry& registry)
+{
+    if (_serial != registry._serial.value()) {
+        _serial = registry._serial.value();
+        _archetypes.clear();
+        _seen = 0;
+    }
+
+    auto mask = componentMask<Cs...>();
+    for (; _seen < registry._archetypes.size(); _seen++) {
+        if ((registry._archetypes[_seen].mask() & mask) == mask) {
+            _archetypes.push_back(static_cast<uint32_t>(_seen));
+        }
+    }
+}
+
+template <class... Cs>
+template <class F>
+void Query<Cs...>::eachChunk(Registry& registry, F&& f)
+{
+    refresh(registry);
+    for (uint32_t index : _archetypes) {
+        auto& archetype = registry._archetypes[index];
+        for (size_t chunk = 0; chunk < archetype.chunkCount(); chunk++) {
+            auto entities = archetype.entities(chunk);
+            f(entities, std::span<Cs>{
+                archetype.column<std::remove_const_t<Cs>>(chunk),
+                entities.size()}...);
+        }
+    }
+}
+
+template <class... Cs>
+template <class F>
+void Query<Cs...>::each(Registry& registry, F&& f)
+{
+    eachChunk(registry, [&f] (
+            std::span<const Entity> entities, std::span<Cs>... columns) {
+        for (size_t i = 0; i < entities.size(); i++) {
+            f(columns[i]...);
+        }
+    });
+}
+
+template <class... Cs>
+template <class F>
+void Query<Cs...>::parallelEach(Registry& registry, JobSystem& jobs, F&& f)
+{
+    refresh(registry);
+    _chunks.clear();
+    for (uint32_t index : _archetypes) {
+        size_t chunks = registry._archetypes[index].chunkCount();
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            _chunks.emplace_back(index, static_cast<uint32_t>(chunk));
+        }
+    }
+
+    jobs.parallelFor(_chunks.size(), 1, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto [index, chunk] = _chunks[i];
+            auto& archetype = registry._archetypes[index];
+            size_t count = archetype.entities(chunk).size();
+            [&f, count] (auto*... columns) {
+                for (size_t row = 0; row < count; row++) {
+                    f(columns[row]...);
+                }
+            }(archetype.column<std::remove_const_t<Cs>>(chunk)...);
+        }
+    });
+}
+
+template <class... Cs, class F>
+void SystemSchedule::add(F&& f)
+{
+    add(Query<Cs...>::access(), [query = Query<Cs...>{},
+            f = std::forward<F>(f)] (Registry& registry) mutable {
+        query.each(registry, f);
+    });
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <compare>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+// Signed Q16.16 fixed-point number. Arithmetic is done on integers with
+// 64-bit intermediates and rounds towards negative infinity, so results are
+// bit-identical on every compiler and CPU. Addition, subtraction and
+// multiplication wrap around on overflow instead of being undefined; division
+// saturates, including division by zero. Conversions from int and floating
+// point saturate too, to the range of about -32768 to 32768, and NaN
+// converts to zero.
+class Fixed {
+public:
+    static constexpr int fractionBits = 16;
+    static constexpr int32_t one = 1 << fractionBits;
+
+    constexpr Fixed() = default;
+
+    constexpr Fixed(int value)
+        : _raw(saturate(static_cast<int64_t>(value) * one))
+    { }
+
+    constexpr explicit Fixed(float value)
+        : Fixed(static_cast<double>(value))
+    { }
+
+    constexpr explicit Fixed(double value)
+        : _raw(round(value * one))
+    { }
+
+    static constexpr Fixed fromRaw(int32_t raw)
+    {
+        auto fixed = Fixed{};
+        fixed._raw = raw;
+        return fixed;
+    }
+
+    constexpr int32_t raw() const
+    {
+        return _raw;
+    }
+
+    constexpr explicit operator float() const
+    {
+        return static_cast<float>(_raw) / one;
+    }
+
+    constexpr explicit operator double() const
+    {
+        return static_cast<double>(_raw) / one;
+    }
+
+    constexpr Fixed& operator+=(Fixed other)
+    {
+        _raw = wrap(static_cast<int64_t>(_raw) + other._raw);
+        return *this;
+    }
+
+    constexpr Fixed& operator-=(Fixed other)
+    {
+        _raw = wrap(static_cast<int64_t>(_raw) - other._raw);
+        return *this;
+    }
+
+    constexpr Fixed& operator*=(Fixed other)
+    {
+        _raw = wrap((static_cast<int64_t>(_raw) * other._raw) >> fractionBits);
+        return *this;
+    }
+
+    constexpr Fixed& operator/=(Fixed other)
+    {
+        if (other._raw == 0) {
+            _raw = _raw >= 0 ? INT32_MAX : INT32_MIN;
+            return *this;
+        }
+
+        auto dividend = static_cast<int64_t>(_raw) * one;
+        auto quotient = dividend / other._raw;
+        if ((dividend % other._raw != 0) && ((dividend < 0) != (other._raw < 0))) {
+            quotient--;
+        }
+        _raw = saturate(quotient);
+        return *this;
+    }
+
+    friend constexpr Fixed operator-(Fixed fixed)
+    {
+        return fromRaw(wrap(-static_cast<int64_t>(fixed._raw)));
+    }
+
+    friend constexpr Fixed operator+(Fixed lhs, Fixed rhs)
+    {
+        return lhs += rhs;
+    }
+
+    friend constexpr Fixed operator-(Fixed lhs, Fixed rhs)
+    {
+        return lhs -= rhs;
+    }
+
+    friend constexpr Fixed operator*(Fixed lhs, Fixed rhs)
+    {
+        return lhs *= rhs;
+    }
+
+    friend constexpr Fixed operator/(Fixed lhs, Fixed rhs)
+    {
+        return lhs /= rhs;
+    }
+
+    friend constexpr bool operator==(Fixed lhs, Fixed rhs) = default;
+    friend constexpr std::strong_ordering operator<=>(
+        Fixed lhs, Fixed rhs) = default;
+
+    // Rounds down. Negative values give zero.
+    friend constexpr Fixed sqrt(Fixed fixed)
+    {
+        if (fixed._raw <= 0) {
+            return Fixed{};
+        }
+        return fromRaw(static_cast<int32_t>(
+            isqrt(static_cast<uint64_t>(fixed._raw) << fractionBits)));
+    }
+
+    // Length of the (x, y) vector. The squares are summed in 64 bits, so
+    // this does not overflow for any representable x and y.
+    friend constexpr Fixed hypot(Fixed x, Fixed y)
+    {
+        auto sqLen =
+            static_cast<uint64_t>(static_cast<int64_t>(x._raw) * x._raw) +
+            static_cast<uint64_t>(static_cast<int64_t>(y._raw) * y._raw);
+        return fromRaw(saturate(static_cast<int64_t>(isqrt(sqLen))));
+    }
+
+    friend constexpr Fixed abs(Fixed fixed)
+    {
+        return fixed._raw < 0 ? -fixed : fixed;
+    }
+
+    friend std::ostream& operator<<(std::ostream& output, Fixed fixed)
+    {
+        return output << static_cast<double>(fixed);
+    }
+
+private:
+    static constexpr int32_t wrap(int64_t value)
+    {
+        return static_cast<int32_t>(static_cast<uint32_t>(value));
+    }
+
+    static constexpr int32_t saturate(int64_t value)
+    {
+        return value > INT32_MAX ? INT32_MAX :
+            value < INT32_MIN ? INT32_MIN : static_cast<int32_t>(value);
+    }
+
+    // Rounds to the nearest integer, away from zero on ties. Values out of
+    // range are clamped before the cast, which would be undefined for them.
+    static constexpr int32_t round(double value)
+    {
+        if (value != value) {
+            return 0;
+        }
+        if (value >= INT32_MAX) {
+            return INT32_MAX;
+        }
+        if (value <= INT32_MIN) {
+            return INT32_MIN;
+        }
+        return static_cast<int32_t>(value >= 0 ? value + 0.5 : value - 0.5);
+    }
+
+    // Bit-by-bit integer square root, rounded down
+    static constexpr uint64_t isqrt(uint64_t value)
+    {
+        uint64_t result = 0;
+        uint64_t bit = uint64_t{1} << 62;
+        while (bit > value) {
+            bit >>= 2;
+        }
+        while (bit != 0) {
+            if (value >= result + bit) {
+                value -= result + bit;
+                result = (result >> 1) + bit;
+            } else {
+                result >>= 1;
+            }
+            bit >>= 2;
+        }
+        return result;
+    }
+
+    int32_t _raw = 0;
+};
+
+template <>
+class std::numeric_limits<Fixed> {
+public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = true;
+    static constexpr bool has_infinity = false;
+    static constexpr bool has_quiet_NaN = false;
+    static constexpr bool has_signaling_NaN = false;
+    static constexpr bool is_bounded = true;
+    static constexpr bool is_modulo = true;
+    static constexpr int digits = 31;
+    static constexpr int radix = 2;
+
+    static constexpr Fixed min() noexcept
+    {
+        return Fixed::fromRaw(1);
+    }
+
+    static constexpr Fixed lowest() noexcept
+    {
+        return Fixed::fromRaw(INT32_MIN);
+    }
+
+    static constexpr Fixed max() noexcept
+    {
+        return Fixed::fromRaw(INT32_MAX);
+    }
+
+    static constexpr Fixed epsilon() noexcept
+    {
+        return Fixed::fromRaw(1);
+    }
+};
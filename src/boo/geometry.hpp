@@ -1,149 +1,467 @@
 #pragma once
 
+#include "fixed.hpp"
+
 #include <cmath>
 #include <concepts>
 #include <ostream>
 
-class Norm;
-
-struct Vector {
-    Vector() = default;
-    Vector(float x, float y);
-
-    Vector(const Norm& norm);
-
-    Vector& operator+=(const Vector& other);
-    Vector& operator-=(const Vector& other);
-    Vector& operator*=(float scalar);
-    Vector& operator/=(float scalar);
-
-    float sqLen() const;
-    float len() const;
-    Norm norm() const;
-
-    float x = 0.f;
-    float y = 0.f;
+// Geometry is header-only and templated on the scalar type, so that every
+// operation can be inlined into the collision loops. The rest of the game
+// uses the float instantiations through the aliases at the end of the file.
+
+template <class T>
+concept Scalar = std::floating_point<T> || std::same_as<T, Fixed>;
+
+template <Scalar T>
+constexpr T squareRoot(T value)
+{
+    using std::sqrt;
+    return sqrt(value);
+}
+
+// Fixed has a narrow range, so it sums the squares in a wider type
+template <Scalar T>
+constexpr T length(T x, T y)
+{
+    if constexpr (std::same_as<T, Fixed>) {
+        return hypot(x, y);
+    } else {
+        return squareRoot(x * x + y * y);
+    }
+}
+
+template <Scalar T>
+class BasicNorm;
+
+template <Scalar T>
+struct BasicVector {
+    constexpr BasicVector() = default;
+
+    constexpr BasicVector(T x, T y)
+        : x(x)
+        , y(y)
+    { }
+
+    constexpr BasicVector(const BasicNorm<T>& norm);
+
+    constexpr BasicVector& operator+=(const BasicVector& other)
+    {
+        x += other.x;
+        y += other.y;
+        return *this;
+    }
+
+    constexpr BasicVector& operator-=(const BasicVector& other)
+    {
+        x -= other.x;
+        y -= other.y;
+        return *this;
+    }
+
+    constexpr BasicVector& operator*=(T scalar)
+    {
+        x *= scalar;
+        y *= scalar;
+        return *this;
+    }
+
+    constexpr BasicVector& operator/=(T scalar)
+    {
+        x /= scalar;
+        y /= scalar;
+        return *this;
+    }
+
+    constexpr T sqLen() const
+    {
+        return x * x + y * y;
+    }
+
+    constexpr T len() const
+    {
+        return length(x, y);
+    }
+
+    constexpr BasicNorm<T> norm() const;
+
+    friend constexpr BasicVector operator-(const BasicVector& vector)
+    {
+        return {-vector.x, -vector.y};
+    }
+
+    friend constexpr BasicVector operator+(
+        BasicVector lhs, const BasicVector& rhs)
+    {
+        lhs += rhs;
+        return lhs;
+    }
+
+    friend constexpr BasicVector operator-(
+        BasicVector lhs, const BasicVector& rhs)
+    {
+        lhs -= rhs;
+        return lhs;
+    }
+
+    friend constexpr BasicVector operator*(BasicVector vector, T scalar)
+    {
+        vector *= scalar;
+        return vector;
+    }
+
+    friend constexpr BasicVector operator*(T scalar, BasicVector vector)
+    {
+        vector *= scalar;
+        return vector;
+    }
+
+    friend constexpr BasicVector operator/(BasicVector vector, T scalar)
+    {
+        vector /= scalar;
+        return vector;
+    }
+
+    // Norm arguments are accepted through the implicit conversion, since
+    // hidden friends are found by ADL and are not templates
+    friend constexpr T dot(const BasicVector& lhs, const BasicVector& rhs)
+    {
+        return lhs.x * rhs.x + lhs.y * rhs.y;
+    }
+
+    friend constexpr BasicVector ccw(const BasicVector& vector)
+    {
+        return BasicVector{-vector.y, vector.x};
+    }
+
+    friend std::ostream& operator<<(
+        std::ostream& output, const BasicVector& vector)
+    {
+        return output << "(" << vector.x << ", " << vector.y << ")";
+    }
+
+    T x = 0;
+    T y = 0;
 };
 
-Vector operator-(const Vector& vector);
-Vector operator+(Vector lhs, const Vector& rhs);
-Vector operator-(Vector lhs, const Vector& rhs);
-Vector operator*(Vector vector, float scalar);
-Vector operator*(float scalar, Vector vector);
-Vector operator/(Vector vector, float scalar);
-
-float dot(const Vector& lhs, const Vector& rhs);
-Vector ccw(const Vector& vector);
-
-std::ostream& operator<<(std::ostream& output, const Vector& vector);
-
-class Norm {
+template <Scalar T>
+class BasicNorm {
 public:
-    Norm() = default;
-    explicit Norm(float x, float y);
-    explicit Norm(const Vector& vector);
-
-    float x() const;
-    float y() const;
+    constexpr BasicNorm() = default;
+
+    constexpr explicit BasicNorm(T x, T y)
+    {
+        auto l = length(x, y);
+        _x = x / l;
+        _y = y / l;
+    }
+
+    constexpr explicit BasicNorm(const BasicVector<T>& vector)
+        : BasicNorm(vector.x, vector.y)
+    { }
+
+    constexpr T x() const
+    {
+        return _x;
+    }
+
+    constexpr T y() const
+    {
+        return _y;
+    }
+
+    friend constexpr BasicNorm operator-(const BasicNorm& norm)
+    {
+        return BasicNorm{NoCheck{}, -norm._x, -norm._y};
+    }
+
+    friend constexpr BasicNorm cw(const BasicNorm& norm)
+    {
+        return BasicNorm{NoCheck{}, norm._y, -norm._x};
+    }
+
+    friend constexpr BasicNorm ccw(const BasicNorm& norm)
+    {
+        return BasicNorm{NoCheck{}, -norm._y, norm._x};
+    }
+
+    friend constexpr BasicVector<T> operator*(const BasicNorm& norm, T scalar)
+    {
+        return BasicVector<T>{norm} * scalar;
+    }
+
+    friend constexpr BasicVector<T> operator*(T scalar, const BasicNorm& norm)
+    {
+        return scalar * BasicVector<T>{norm};
+    }
 
 private:
     struct NoCheck {};
-    explicit Norm(NoCheck, float x, float y);
 
-    friend Norm operator-(const Norm& norm);
+    constexpr explicit BasicNorm(NoCheck, T x, T y)
+        : _x(x)
+        , _y(y)
+    { }
 
-    friend Norm cw(const Norm& norm);
-    friend Norm ccw(const Norm& norm);
-
-    float _x = 0.f;
-    float _y = 0.f;
+    T _x = 0;
+    T _y = 0;
 };
 
-
-struct Circle {
-    Vector center;
-    float radius = 0.f;
+template <Scalar T>
+constexpr BasicVector<T>::BasicVector(const BasicNorm<T>& norm)
+    : x(norm.x())
+    , y(norm.y())
+{ }
+
+template <Scalar T>
+constexpr BasicNorm<T> BasicVector<T>::norm() const
+{
+    return BasicNorm<T>{x, y};
+}
+
+template <Scalar T>
+struct BasicCircle {
+    BasicVector<T> center;
+    T radius = 0;
 };
 
-class Line {
+template <Scalar T>
+class BasicLine {
 public:
-    Line(const Norm& norm, float value);
-
-    static Line fromPointAndDirection(
-        const Vector& point, const Vector& direction);
-    static Line betweenPoints(const Vector& u, const Vector& v);
-
-    const Norm& norm() const;
-    Norm direction() const;
-    float value() const;
-    float coordinate(const Vector& v) const;
-    Vector pointAtCoordinate(float coordinate) const;
+    constexpr BasicLine(const BasicNorm<T>& norm, T value)
+        : _norm(norm)
+        , _value(value)
+    { }
+
+    static constexpr BasicLine fromPointAndDirection(
+        const BasicVector<T>& point, const BasicVector<T>& direction)
+    {
+        auto norm = ccw(BasicNorm<T>{direction});
+        return BasicLine{norm, dot(norm, point)};
+    }
+
+    static constexpr BasicLine betweenPoints(
+        const BasicVector<T>& u, const BasicVector<T>& v)
+    {
+        return fromPointAndDirection(u, v - u);
+    }
+
+    constexpr const BasicNorm<T>& norm() const
+    {
+        return _norm;
+    }
+
+    constexpr BasicNorm<T> direction() const
+    {
+        return cw(_norm);
+    }
+
+    constexpr T value() const
+    {
+        return _value;
+    }
+
+    constexpr T coordinate(const BasicVector<T>& v) const
+    {
+        return dot(direction(), v);
+    }
+
+    constexpr BasicVector<T> pointAtCoordinate(T coordinate) const
+    {
+        auto origin = norm() * _value;
+        return origin + direction() * coordinate;
+    }
 
 private:
-    Norm _norm;
-    float _value = 0.f;
+    BasicNorm<T> _norm;
+    T _value = 0;
 };
 
-class Ray {
+template <Scalar T>
+class BasicRay {
 public:
-    Ray(Line line, float startValue);
-    Ray(const Vector& point, const Vector& direction);
-
-    const Line& line() const;
-    bool contains(const Vector& point) const;
+    constexpr BasicRay(BasicLine<T> line, T startValue)
+        : _line(line)
+        , _startValue(startValue)
+    { }
+
+    constexpr BasicRay(
+            const BasicVector<T>& point, const BasicVector<T>& direction)
+        : _line(BasicLine<T>::fromPointAndDirection(point, direction))
+        , _startValue(_line.coordinate(point))
+    { }
+
+    constexpr const BasicLine<T>& line() const
+    {
+        return _line;
+    }
+
+    constexpr bool contains(const BasicVector<T>& point) const
+    {
+        auto c = _line.coordinate(point);
+        return c >= _startValue;
+    }
 
 private:
-    Line _line;
-    float _startValue = 0.f;
+    BasicLine<T> _line;
+    T _startValue = 0;
 };
 
-class Segment {
+template <Scalar T>
+class BasicSegment {
 public:
-    Segment(Line line, float startValue, float endValue);
-    Segment(const Vector& u, const Vector& v);
-
-    const Line& line() const;
-    bool contains(const Vector& point) const;
-
-    Vector start() const;
-    Vector end() const;
+    constexpr BasicSegment(BasicLine<T> line, T startValue, T endValue)
+        : _line(line)
+        , _startValue(startValue)
+        , _endValue(endValue)
+    { }
+
+    constexpr BasicSegment(const BasicVector<T>& u, const BasicVector<T>& v)
+        : _line(BasicLine<T>::betweenPoints(u, v))
+        , _startValue(_line.coordinate(u))
+        , _endValue(_line.coordinate(v))
+    { }
+
+    constexpr const BasicLine<T>& line() const
+    {
+        return _line;
+    }
+
+    constexpr bool contains(const BasicVector<T>& point) const
+    {
+        auto c = _line.coordinate(point);
+        return c >= _startValue && c <= _endValue;
+    }
+
+    constexpr BasicVector<T> start() const
+    {
+        return _line.pointAtCoordinate(_startValue);
+    }
+
+    constexpr BasicVector<T> end() const
+    {
+        return _line.pointAtCoordinate(_endValue);
+    }
+
+    friend constexpr BasicSegment shift(
+        const BasicSegment& segment, const BasicVector<T>& offset)
+    {
+        return BasicSegment{segment.start() + offset, segment.end() + offset};
+    }
 
 private:
-    Line _line;
-    float _startValue = 0.f;
-    float _endValue = 0.f;
+    BasicLine<T> _line;
+    T _startValue = 0;
+    T _endValue = 0;
 };
 
-Segment shift(const Segment& segment, const Vector& offset);
-
-class Rectangle {
+template <Scalar T>
+class BasicRectangle {
 public:
-    Rectangle(const Vector& center, float w, float h);
-
-    Vector topLeft() const;
-    Vector topRight() const;
-    Vector bottomLeft() const;
-    Vector bottomRight() const;
-
-    Segment top() const;
-    Segment bottom() const;
-    Segment left() const;
-    Segment right() const;
-
-    float xmin() const;
-    float xmax() const;
-    float ymin() const;
-    float ymax() const;
-
-    float w() const;
-    float h() const;
-    Vector center() const;
-
-    void moveTo(const Vector& newCenter);
+    constexpr BasicRectangle() = default;
+
+    constexpr BasicRectangle(const BasicVector<T>& center, T w, T h)
+        : _xmin(center.x - w / 2)
+        , _xmax(center.x + w / 2)
+        , _ymin(center.y - h / 2)
+        , _ymax(center.y + h / 2)
+    { }
+
+    constexpr BasicVector<T> topLeft() const
+    {
+        return {_xmin, _ymax};
+    }
+
+    constexpr BasicVector<T> topRight() const
+    {
+        return {_xmax, _ymax};
+    }
+
+    constexpr BasicVector<T> bottomLeft() const
+    {
+        return {_xmin, _ymin};
+    }
+
+    constexpr BasicVector<T> bottomRight() const
+    {
+        return {_xmax, _ymin};
+    }
+
+    constexpr BasicSegment<T> top() const
+    {
+        return BasicSegment<T>{topLeft(), topRight()};
+    }
+
+    constexpr BasicSegment<T> bottom() const
+    {
+        return BasicSegment<T>{bottomLeft(), bottomRight()};
+    }
+
+    constexpr BasicSegment<T> left() const
+    {
+        return BasicSegment<T>{topLeft(), bottomLeft()};
+    }
+
+    constexpr BasicSegment<T> right() const
+    {
+        return BasicSegment<T>{topRight(), bottomRight()};
+    }
+
+    constexpr T xmin() const
+    {
+        return _xmin;
+    }
+
+    constexpr T xmax() const
+    {
+        return _xmax;
+    }
+
+    constexpr T ymin() const
+    {
+        return _ymin;
+    }
+
+    constexpr T ymax() const
+    {
+        return _ymax;
+    }
+
+    constexpr T w() const
+    {
+        return _xmax - _xmin;
+    }
+
+    constexpr T h() const
+    {
+        return _ymax - _ymin;
+    }
+
+    constexpr BasicVector<T> center() const
+    {
+        return {(_xmin + _xmax) / 2, (_ymin + _ymax) / 2};
+    }
+
+    constexpr void moveTo(const BasicVector<T>& newCenter)
+    {
+        auto offset = newCenter - center();
+        _xmin += offset.x;
+        _xmax += offset.x;
+        _ymin += offset.y;
+        _ymax += offset.y;
+    }
 
 private:
-    float _xmin = 0.f;
-    float _xmax = 0.f;
-    float _ymin = 0.f;
-    float _ymax = 0.f;
-};
\ No newline at end of file
+    T _xmin = 0;
+    T _xmax = 0;
+    T _ymin = 0;
+    T _ymax = 0;
+};
+
+using Vector = BasicVector<float>;
+using Norm = BasicNorm<float>;
+using Circle = BasicCircle<float>;
+using Line = BasicLine<float>;
+using Ray = BasicRay<float>;
+using Segment = BasicSegment<float>;
+using Rectangle = BasicRectangle<float>;
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "fixed.hpp"
+#include "geometry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Cells from the one that holds from up to the one that holds to, clamped to
+// the grid, or an empty range if the interval misses the grid
+template <Scalar T>
+std::pair<uint32_t, uint32_t> cellRange(
+    T from, T to, T origin, T cellSize, uint32_t cells)
+{
+    auto cell = [&] (T value) -> int64_t {
+        T position = (value - origin) / cellSize;
+        if constexpr (std::same_as<T, Fixed>) {
+            return position.raw() >> Fixed::fractionBits;
+        } else {
+            // Clamped first, so that far away values fit in the integer
+            return static_cast<int64_t>(std::floor(std::clamp<T>(
+                position, -1, static_cast<T>(cells))));
+        }
+    };
+
+    int64_t first = cell(from);
+    int64_t last = cell(to);
+    if (last < 0 || first >= cells) {
+        return {1, 0};
+    }
+    return {
+        static_cast<uint32_t>(std::max<int64_t>(first, 0)),
+        static_cast<uint32_t>(std::min<int64_t>(last, cells - 1)),
+    };
+}
+
+// Uniform grid over a set of rectangles, for finding the ones near an area.
+// The cells are stored back to back in one array, with the start of every
+// cell in another. Rectangles that overlap several cells are in all of them,
+// so a query can find one more than once.
+template <Scalar T>
+class BasicRectangleGrid {
+public:
+    // Sorts the rectangles that are used into cells, in index order. Cells
+    // are sized after the used rectangles, which cover the whole grid.
+    void build(
+        std::span<const BasicRectangle<T>> rectangles,
+        const std::vector<bool>& used);
+
+    // A grid of no rectangles has no cells
+    bool empty() const;
+    T cellSize() const;
+
+    // Calls f(index) for every rectangle in the cells that the area
+    // touches, row by row
+    template <class F>
+    void forEach(T xmin, T xmax, T ymin, T ymax, F&& f) const;
+
+private:
+    // Rectangles are about half a cell across on average, and there are at
+    // most a few cells per rectangle, so that sparse sets do not make huge
+    // grids
+    static constexpr double cellsPerSize = 2;
+    static constexpr double maxCellsPerRectangle = 4;
+
+    BasicVector<T> _origin;
+    T _cellSize = 0;
+    uint32_t _columns = 0;
+    uint32_t _rows = 0;
+    std::vector<uint32_t> _cellStarts;
+    std::vector<uint32_t> _items;
+};
+
+template <Scalar T>
+void BasicRectangleGrid<T>::build(
+    std::span<const BasicRectangle<T>> rectangles,
+    const std::vector<bool>& used)
+{
+    double xmin = 0;
+    double xmax = 0;
+    double ymin = 0;
+    double ymax = 0;
+    double sizes = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < rectangles.size(); i++) {
+        if (!used[i]) {
+            continue;
+        }
+        const auto& rectangle = rectangles[i];
+        auto left = static_cast<double>(rectangle.xmin());
+        auto right = static_cast<double>(rectangle.xmax());
+        auto bottom = static_cast<double>(rectangle.ymin());
+        auto top = static_cast<double>(rectangle.ymax());
+        xmin = count == 0 ? left : std::min(xmin, left);
+        xmax = count == 0 ? right : std::max(xmax, right);
+        ymin = count == 0 ? bottom : std::min(ymin, bottom);
+        ymax = count == 0 ? top : std::max(ymax, top);
+        sizes += std::max(right - left, top - bottom);
+        count++;
+    }
+
+    _columns = 0;
+    _rows = 0;
+    _cellStarts.assign(1, 0);
+    _items.clear();
+    if (count == 0) {
+        return;
+    }
+
+    double cellSize = std::max(
+        cellsPerSize * sizes / static_cast<double>(count), 1. / 64);
+    auto cells = [&] (double size) {
+        return ((xmax - xmin) / size + 1) * ((ymax - ymin) / size + 1);
+    };
+    while (cells(cellSize) >
+            maxCellsPerRectangle * static_cast<double>(count) + 64) {
+        cellSize *= 2;
+    }
+
+    _origin = {static_cast<T>(xmin), static_cast<T>(ymin)};
+    _cellSize = static_cast<T>(cellSize);
+    _columns = static_cast<uint32_t>((xmax - xmin) / cellSize) + 1;
+    _rows = static_cast<uint32_t>((ymax - ymin) / cellSize) + 1;
+
+    // Counts rectangles per cell, turns the counts into starts, and then
+    // fills the cells
+    auto forCells = [&] (const BasicRectangle<T>& rectangle, auto&& f) {
+        auto [firstColumn, lastColumn] = cellRange(
+            rectangle.xmin(), rectangle.xmax(), _origin.x, _cellSize, _columns);
+        auto [firstRow, lastRow] = cellRange(
+            rectangle.ymin(), rectangle.ymax(), _origin.y, _cellSize, _rows);
+        for (size_t row = firstRow; row <= lastRow; row++) {
+            for (size_t column = firstColumn; column <= lastColumn; column++) {
+                f(row * _columns + column);
+            }
+        }
+    };
+
+    _cellStarts.assign(size_t{_columns} * _rows + 1, 0);
+    for (size_t i = 0; i < rectangles.size(); i++) {
+        if (used[i]) {
+            forCells(rectangles[i], [&] (size_t cell) {
+                _cellStarts[cell + 1]++;
+            });
+        }
+    }
+    for (size_t cell = 1; cell < _cellStarts.size(); cell++) {
+        _cellStarts[cell] += _cellStarts[cell - 1];
+    }
+
+    _items.resize(_cellStarts.back());
+    auto next = std::vector<uint32_t>(_cellStarts.begin(), _cellStarts.end() - 1);
+    for (size_t i = 0; i < rectangles.size(); i++) {
+        if (used[i]) {
+            forCells(rectangles[i], [&] (size_t cell) {
+                _items[next[cell]++] = static_cast<uint32_t>(i);
+            });
+        }
+    }
+}
+
+template <Scalar T>
+bool BasicRectangleGrid<T>::empty() const
+{
+    return _columns == 0;
+}
+
+template <Scalar T>
+T BasicRectangleGrid<T>::cellSize() const
+{
+    return _cellSize;
+}
+
+template <Scalar T>
+template <class F>
+void BasicRectangleGrid<T>::forEach(T xmin, T xmax, T ymin, T ymax, F&& f) const
+{
+    if (empty()) {
+        return;
+    }
+
+    auto [firstColumn, lastColumn] =
+        cellRange(xmin, xmax, _origin.x, _cellSize, _columns);
+    auto [firstRow, lastRow] =
+        cellRange(ymin, ymax, _origin.y, _cellSize, _rows);
+    if (firstColumn > lastColumn || firstRow > lastRow) {
+        return;
+    }
+
+    for (size_t row = firstRow; row <= lastRow; row++) {
+        size_t cell = row * _columns;
+        uint32_t begin = _cellStarts[cell + firstColumn];
+        uint32_t end = _cellStarts[cell + lastColumn + 1];
+        for (uint32_t i = begin; i < end; i++) {
+            f(_items[i]);
+        }
+    }
+}
+
+using RectangleGrid = BasicRectangleGrid<float>;
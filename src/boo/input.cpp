@@ -0,0 +1,128 @@
+#include "input.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace {
+
+using Clock = InputQueue::Clock;
+
+// SDL stamps events with milliseconds since it started, as SDL_GetTicks()
+// counts them, so the age of an event moves it back from now. The age is
+// unsigned, so that the counter wrapping around does not matter.
+Clock::time_point eventTime(const SDL_Event& event)
+{
+    uint32_t age = SDL_GetTicks() - event.common.timestamp;
+    return Clock::now() - std::chrono::milliseconds{age};
+}
+
+} // namespace
+
+InputQueue::InputQueue(const InputOptions& options)
+    : _options(options)
+{ }
+
+bool InputQueue::push(const SDL_Event& event, int windowWidth)
+{
+    auto input = PadInput{.time = eventTime(event)};
+    if (event.type == SDL_MOUSEMOTION && windowWidth > 0) {
+        input.pointer = true;
+        input.value = std::clamp(
+            static_cast<float>(event.motion.x) /
+                static_cast<float>(windowWidth),
+            0.f,
+            1.f);
+    } else if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) &&
+            !event.key.repeat &&
+            (event.key.keysym.sym == SDLK_LEFT ||
+                event.key.keysym.sym == SDLK_RIGHT)) {
+        bool down = event.type == SDL_KEYDOWN;
+        (event.key.keysym.sym == SDLK_LEFT ? _left : _right) = down;
+        input.value = (_right ? 1.f : 0.f) - (_left ? 1.f : 0.f);
+    } else {
+        return false;
+    }
+
+    // Stamps are coarser than ticks, so they can tie or step back a little
+    // against the previous input
+    if (!_pending.empty()) {
+        input.time = std::max(input.time, _pending.back().time);
+    }
+    _pending.push_back(input);
+    return true;
+}
+
+void InputQueue::clear()
+{
+    _pending.clear();
+    _direction = 0;
+    _left = false;
+    _right = false;
+}
+
+void InputQueue::update(
+    World& world,
+    Clock::time_point tickStart,
+    Clock::duration tickDuration,
+    float delta)
+{
+    auto tickEnd = tickStart + tickDuration;
+    float seconds = std::chrono::duration<float>{tickDuration}.count();
+    float done = 0;
+
+    size_t used = 0;
+    for (; used < _pending.size() && _pending[used].time < tickEnd; used++) {
+        const auto& input = _pending[used];
+        // Pointer motion only counts where it ends before the next key, so
+        // the mouse does not split the tick once per event
+        bool next = used + 1 < _pending.size() &&
+            _pending[used + 1].time < tickEnd;
+        if (input.pointer && next && _pending[used + 1].pointer) {
+            _applied.push_back(input.time);
+            continue;
+        }
+
+        // In simulated time, which runs at the rate of the ticks
+        float at = std::chrono::duration<float>{
+            std::max(input.time, tickStart) - tickStart}.count() *
+            delta / seconds;
+        step(world, std::min(at, delta) - done);
+        done = std::max(done, std::min(at, delta));
+
+        if (input.pointer) {
+            _position = input.value;
+        } else {
+            _direction = input.value;
+        }
+        world.setPadPosition(_position);
+        _applied.push_back(input.time);
+    }
+    _pending.erase(_pending.begin(), _pending.begin() + used);
+
+    step(world, delta - done);
+}
+
+std::span<const Clock::time_point> InputQueue::applied() const
+{
+    return _applied;
+}
+
+void InputQueue::clearApplied()
+{
+    _applied.clear();
+}
+
+// A held key moves the pad in steps, one per piece of a tick
+void InputQueue::step(World& world, float seconds)
+{
+    if (seconds <= 0) {
+        return;
+    }
+    world.update(seconds);
+    if (_direction != 0) {
+        _position = std::clamp(
+            _position + _direction * _options.keySpeed * seconds, 0.f, 1.f);
+        world.setPadPosition(_position);
+    }
+}
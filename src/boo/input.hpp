@@ -0,0 +1,69 @@
+#pragma once
+
+#include "timer.hpp"
+#include "world.hpp"
+
+#include "sdl.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+struct InputOptions {
+    // Share of the pad's range per second while an arrow key is held
+    float keySpeed = 1.5f;
+};
+
+// Pad input of one player, kept with the time it happened, so that ticks
+// apply it at that time instead of at their start. The mouse puts the pad
+// under the pointer; the arrow keys move it at a steady speed while held.
+//
+// Times come from SDL event timestamps, which SDL takes when it reads the
+// events from the system, in milliseconds.
+class InputQueue {
+public:
+    using Clock = FrameTimer::Clock;
+
+    explicit InputQueue(const InputOptions& options = {});
+
+    // Returns whether the event was pad input
+    bool push(const SDL_Event& event, int windowWidth);
+    // Drops pending input, e.g. when the game resumes after a pause
+    void clear();
+
+    // Runs one tick of the world that covers the time from tickStart on,
+    // split at the keys pressed and released within it, and at the last
+    // pointer position before each of them and before the end. The world
+    // updates at most twice per key event and once more, however fast the
+    // mouse moves. Inputs from before the tick are applied at its start,
+    // and later ones wait for their tick.
+    void update(
+        World& world,
+        Clock::time_point tickStart,
+        Clock::duration tickDuration,
+        float delta);
+
+    // Times of the inputs applied since clearApplied(), for measuring how
+    // long they took to reach the screen
+    std::span<const Clock::time_point> applied() const;
+    void clearApplied();
+
+private:
+    struct PadInput {
+        Clock::time_point time;
+        bool pointer = false;
+        // For the pointer: the pad position from 0 to 1. For keys: the
+        // direction of movement, from -1 to 1.
+        float value = 0;
+    };
+
+    void step(World& world, float seconds);
+
+    InputOptions _options;
+    std::vector<PadInput> _pending;
+    std::vector<Clock::time_point> _applied;
+    float _position = 0.5f;
+    bool _left = false;
+    bool _right = false;
+    float _direction = 0;
+};
@@ -0,0 +1,279 @@
+#include "jobs.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <Windows.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+struct CurrentWorker {
+    const JobSystem* system = nullptr;
+    size_t index = 0;
+};
+
+thread_local CurrentWorker threadWorker;
+
+// Pins the thread to the n-th CPU that the process is allowed to run on
+void pinThread(std::thread& thread, size_t n)
+{
+#if defined(__linux__)
+    auto allowed = cpu_set_t{};
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        throw std::runtime_error{"cannot get CPU affinity"};
+    }
+    size_t cpuCount = static_cast<size_t>(CPU_COUNT(&allowed));
+    n %= cpuCount;
+
+    int cpu = 0;
+    for (size_t seen = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && seen++ == n) {
+            break;
+        }
+    }
+
+    auto cpus = cpu_set_t{};
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if (int e = pthread_setaffinity_np(
+            thread.native_handle(), sizeof(cpus), &cpus); e != 0) {
+        throw std::runtime_error{std::format(
+            "cannot pin worker to CPU {}: {}", cpu, strerrordesc_np(e))};
+    }
+#elif defined(_WIN32)
+    DWORD_PTR processMask = 0;
+    DWORD_PTR systemMask = 0;
+    if (!GetProcessAffinityMask(
+            GetCurrentProcess(), &processMask, &systemMask)) {
+        throw std::runtime_error{"cannot get CPU affinity"};
+    }
+    n %= std::popcount(static_cast<uint64_t>(processMask));
+
+    DWORD_PTR mask = processMask;
+    for (size_t i = 0; i < n; i++) {
+        mask &= mask - 1;
+    }
+    mask &= ~(mask - 1);
+    if (SetThreadAffinityMask(
+            static_cast<HANDLE>(thread.native_handle()), mask) == 0) {
+        throw std::runtime_error{std::format(
+            "cannot pin worker to CPU mask {:#x}: error {}",
+            mask, GetLastError())};
+    }
+#else
+    (void)thread;
+    (void)n;
+#endif
+}
+
+} // namespace
+
+bool JobSystem::TaskDeque::empty() const
+{
+    return _head == _tail;
+}
+
+void JobSystem::TaskDeque::pushBack(Task task)
+{
+    if (_tail - _head == _tasks.size()) {
+        auto tasks = std::vector<Task>(std::max<size_t>(_tasks.size() * 2, 64));
+        for (size_t i = _head; i < _tail; i++) {
+            tasks[i & (tasks.size() - 1)] =
+                std::move(_tasks[i & (_tasks.size() - 1)]);
+        }
+        _tasks = std::move(tasks);
+    }
+    _tasks[_tail++ & (_tasks.size() - 1)] = std::move(task);
+}
+
+auto JobSystem::TaskDeque::popBack() -> Task
+{
+    return std::move(_tasks[--_tail & (_tasks.size() - 1)]);
+}
+
+auto JobSystem::TaskDeque::popFront() -> Task
+{
+    return std::move(_tasks[_head++ & (_tasks.size() - 1)]);
+}
+
+bool JobCounter::done() const
+{
+    return _pending.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(const JobOptions& options)
+{
+    size_t workers = options.workers;
+    if (workers == 0) {
+        workers = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    for (size_t i = 0; i < workers; i++) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    threadWorker = CurrentWorker{.system = this, .index = 0};
+
+    try {
+        for (size_t i = 1; i < workers; i++) {
+            auto& thread = _threads.emplace_back([this, i] {
+                workerLoop(i);
+            });
+            if (options.pinWorkers) {
+                pinThread(thread, i);
+            }
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    stop();
+}
+
+void JobSystem::stop()
+{
+    _stopping.store(true, std::memory_order_release);
+    _queued.fetch_add(1, std::memory_order_release);
+    _queued.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+    _threads.clear();
+
+    if (threadWorker.system == this) {
+        threadWorker = CurrentWorker{};
+    }
+}
+
+size_t JobSystem::workers() const
+{
+    return _workers.size();
+}
+
+// The counter goes up before the task is queued, since a thief may run it
+// right away, and back down if queuing it throws
+void JobSystem::run(JobCounter& counter, Job job)
+{
+    counter._pending.fetch_add(1, std::memory_order_relaxed);
+
+    auto& worker = *_workers[currentWorker()];
+    try {
+        auto lock = std::lock_guard{worker.mutex};
+        worker.tasks.pushBack(Task{std::move(job), &counter});
+    } catch (...) {
+        counter._pending.fetch_sub(1, std::memory_order_relaxed);
+        throw;
+    }
+    _queued.fetch_add(1, std::memory_order_release);
+    _queued.notify_one();
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    size_t worker = currentWorker();
+    while (!counter.done()) {
+        if (!runOne(worker)) {
+            std::this_thread::yield();
+        }
+    }
+
+    if (counter._failed.load(std::memory_order_acquire)) {
+        auto exception = std::exchange(counter._exception, nullptr);
+        counter._failed.store(false, std::memory_order_relaxed);
+        std::rethrow_exception(exception);
+    }
+}
+
+JobStats JobSystem::stats() const
+{
+    auto stats = JobStats{};
+    for (const auto& worker : _workers) {
+        stats.executed += worker->executed.load(std::memory_order_relaxed);
+        stats.stolen += worker->stolen.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+size_t JobSystem::currentWorker() const
+{
+    return threadWorker.system == this ? threadWorker.index : 0;
+}
+
+// Takes the newest job of the worker's own deque, which is likely still in
+// cache, or else the oldest job of another worker, which is likely the
+// largest piece of work left there
+bool JobSystem::runOne(size_t worker)
+{
+    auto task = Task{};
+    bool found = false;
+    bool stolen = false;
+    {
+        auto& own = *_workers[worker];
+        auto lock = std::lock_guard{own.mutex};
+        if (!own.tasks.empty()) {
+            task = own.tasks.popBack();
+            found = true;
+        }
+    }
+    for (size_t i = 1; !found && i < _workers.size(); i++) {
+        auto& victim = *_workers[(worker + i) % _workers.size()];
+        auto lock = std::lock_guard{victim.mutex};
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.popFront();
+            found = stolen = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+
+    try {
+        task.job();
+    } catch (...) {
+        if (!task.counter->_failed.exchange(true, std::memory_order_relaxed)) {
+            task.counter->_exception = std::current_exception();
+        }
+    }
+    task.job = nullptr;
+
+    auto& self = *_workers[worker];
+    self.executed.fetch_add(1, std::memory_order_relaxed);
+    if (stolen) {
+        self.stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Everything the job wrote is visible to the thread that sees the
+    // counter reach zero
+    task.counter->_pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JobSystem::workerLoop(size_t worker)
+{
+    threadWorker = CurrentWorker{.system = this, .index = worker};
+
+    while (!_stopping.load(std::memory_order_acquire)) {
+        if (runOne(worker)) {
+            continue;
+        }
+        // The count is updated after the deques, so it can briefly say there
+        // are jobs when the last one has just been taken
+        if (_queued.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        _queued.wait(0, std::memory_order_acquire);
+    }
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of jobs that have not finished yet. A job that throws stores the
+// first exception here, and JobSystem::wait() rethrows it.
+class JobCounter {
+public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const;
+
+private:
+    friend class JobSystem;
+
+    std::atomic<size_t> _pending = 0;
+    std::atomic<bool> _failed = false;
+    std::exception_ptr _exception;
+};
+
+struct JobOptions {
+    // Threads including the one that creates the system; zero means one per
+    // hardware thread
+    size_t workers = 0;
+    // Pins worker n to logical CPU n. The creating thread is left alone.
+    bool pinWorkers = false;
+};
+
+struct JobStats {
+    uint64_t executed = 0;
+    uint64_t stolen = 0;
+};
+
+// Pool of worker threads shared by the whole engine. Every worker has its
+// own deque: it pushes and pops jobs at the back, and when it runs out, it
+// steals from the front of the others. The thread that created the system
+// is worker 0; other threads that are not workers also push to its deque.
+//
+// Waiting on a counter runs jobs instead of blocking, so jobs can spawn and
+// wait for jobs of their own, and the main thread does its share of the
+// work.
+class JobSystem {
+public:
+    using Job = std::move_only_function<void()>;
+
+    explicit JobSystem(const JobOptions& options = {});
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    size_t workers() const;
+
+    void run(JobCounter& counter, Job job);
+    void wait(JobCounter& counter);
+
+    // Calls body(begin, end) on consecutive ranges that cover [0, count),
+    // and returns when all of them are done. Ranges hold at least grain
+    // items, unless count itself is smaller.
+    template <class F>
+    void parallelFor(size_t count, size_t grain, F&& body);
+
+    // Runs background as a job and foreground on the calling thread, and
+    // returns when both are done. If either throws, the exception is
+    // rethrown once both have finished.
+    template <class F, class G>
+    void invokeBoth(F&& background, G&& foreground);
+
+    JobStats stats() const;
+
+private:
+    struct Task {
+        Job job;
+        JobCounter* counter = nullptr;
+    };
+
+    // Ring buffer of tasks that grows when full and never shrinks, so that
+    // pushing a job does not allocate once the pool has warmed up. The
+    // indices only grow, and are wrapped on access.
+    class TaskDeque {
+    public:
+        bool empty() const;
+        void pushBack(Task task);
+        Task popBack();
+        Task popFront();
+
+    private:
+        std::vector<Task> _tasks;
+        size_t _head = 0;
+        size_t _tail = 0;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        TaskDeque tasks;
+        std::atomic<uint64_t> executed = 0;
+        std::atomic<uint64_t> stolen = 0;
+    };
+
+    template <class F>
+    void waitAfter(JobCounter& counter, F&& work);
+
+    void stop();
+    size_t currentWorker() const;
+    bool runOne(size_t worker);
+    void workerLoop(size_t worker);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+    // Jobs waiting in all deques, for idle workers to sleep on
+    std::atomic<size_t> _queued = 0;
+    std::atomic<bool> _stopping = false;
+};
+
+template <class F>
+void JobSystem::parallelFor(size_t count, size_t grain, F&& body)
+{
+    if (count == 0) {
+        return;
+    }
+
+    // A few ranges per worker, so that stealing can even out the load
+    grain = std::max<size_t>(grain, 1);
+    size_t ranges = std::min(count / grain, _workers.size() * 4);
+    if (ranges <= 1) {
+        body(size_t{0}, count);
+        return;
+    }
+
+    // Jobs capture two words, which fits the small buffer of the function
+    // wrapper, so no job allocates
+    struct Range {
+        F& body;
+        size_t count;
+        size_t ranges;
+    };
+    auto range = Range{body, count, ranges};
+    auto counter = JobCounter{};
+    for (size_t i = 1; i < ranges; i++) {
+        run(counter, [&range, i] {
+            range.body(
+                range.count * i / range.ranges,
+                range.count * (i + 1) / range.ranges);
+        });
+    }
+    waitAfter(counter, [&body, count, ranges] {
+        body(size_t{0}, count / ranges);
+    });
+}
+
+template <class F, class G>
+void JobSystem::invokeBoth(F&& background, G&& foreground)
+{
+    auto counter = JobCounter{};
+    run(counter, [&background] {
+        background();
+    });
+    waitAfter(counter, foreground);
+}
+
+// The jobs may point into the caller's frame, so they are waited for even
+// when the calling thread's own work throws
+template <class F>
+void JobSystem::waitAfter(JobCounter& counter, F&& work)
+{
+    try {
+        work();
+    } catch (...) {
+        try {
+            wait(counter);
+        } catch (...) {
+        }
+        throw;
+    }
+    wait(counter);
+}
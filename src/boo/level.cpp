@@ -0,0 +1,81 @@
+#include "level.hpp"
+
+#include "level_generated.h"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <stdexcept>
+#include <type_traits>
+
+// Bricks in the file are read as rectangles, which only works if both have
+// the same layout and the file's little-endian floats are native
+static_assert(std::is_standard_layout_v<Rectangle>);
+static_assert(sizeof(Rectangle) == sizeof(fb::Brick));
+static_assert(alignof(Rectangle) <= alignof(fb::Brick));
+static_assert(std::endian::native == std::endian::little);
+
+// The verifier only looks at the sizes of the arrays, not at the bricks, so
+// pages of bricks are not read here. Cell starts are checked in full, since
+// the world indexes bricks with them.
+Level::Level(const std::filesystem::path& path)
+    : _mmap(path)
+{
+    const auto* data = static_cast<const uint8_t*>(_mmap.addr());
+    auto verifier = flatbuffers::Verifier{data, _mmap.size()};
+    if (!flatbuffers::BufferHasIdentifier(data, fb::LevelIdentifier()) ||
+            !fb::VerifyLevelBuffer(verifier)) {
+        throw std::runtime_error{std::format(
+            "{}: invalid level file", path.string())};
+    }
+    const auto* level = fb::GetLevel(data);
+    auto fail = [&path] (std::string_view what) {
+        throw std::runtime_error{std::format(
+            "{}: {}", path.string(), what)};
+    };
+
+    if (!level->bricks() || !level->cell_starts()) {
+        fail("missing bricks");
+    }
+    auto cellStarts = std::span{
+        level->cell_starts()->data(), level->cell_starts()->size()};
+    size_t brickCount = level->bricks()->size();
+    if (!(level->cell_size() > 0) || cellStarts.size() !=
+            size_t{level->columns()} * level->rows() + 1) {
+        fail("invalid grid");
+    }
+    if (cellStarts.front() != 0 || cellStarts.back() != brickCount ||
+            !std::ranges::is_sorted(cellStarts)) {
+        fail("grid does not match bricks");
+    }
+
+    if (level->name()) {
+        _name = level->name()->string_view();
+    }
+    _bricks = std::span{
+        reinterpret_cast<const Rectangle*>(level->bricks()->Data()),
+        brickCount};
+    _grid = BrickGrid{
+        .origin = {level->grid_x(), level->grid_y()},
+        .cellSize = level->cell_size(),
+        .columns = level->columns(),
+        .rows = level->rows(),
+        .margin = level->margin(),
+        .cellStarts = cellStarts,
+    };
+}
+
+std::string_view Level::name() const
+{
+    return _name;
+}
+
+std::span<const Rectangle> Level::bricks() const
+{
+    return _bricks;
+}
+
+const BrickGrid& Level::grid() const
+{
+    return _grid;
+}
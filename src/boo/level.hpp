@@ -0,0 +1,29 @@
+#pragma once
+
+#include "geometry.hpp"
+#include "mmap.hpp"
+#include "world.hpp"
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+// A level file compiled by the packer, mapped into memory. The bricks and
+// their grid are used straight from the mapping, so loading a level costs
+// the same whatever its size, and pages are read as the ball gets to them.
+// The level must outlive any world set up with it.
+class Level {
+public:
+    Level() = default;
+    explicit Level(const std::filesystem::path& path);
+
+    std::string_view name() const;
+    std::span<const Rectangle> bricks() const;
+    const BrickGrid& grid() const;
+
+private:
+    MemoryMap _mmap;
+    std::string_view _name;
+    std::span<const Rectangle> _bricks;
+    BrickGrid _grid;
+};
@@ -1,33 +1,137 @@
+#include "audio.hpp"
 #include "build-info.hpp"
 #include "config.hpp"
+#include "input.hpp"
+#include "jobs.hpp"
+#include "level.hpp"
+#include "perf.hpp"
 #include "resources.hpp"
+#include "stream.hpp"
 #include "timer.hpp"
 #include "view.hpp"
+#include "watcher.hpp"
 #include "window.hpp"
 
 #include "sdl.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
-int main(int, char*[])
+// Usage: boo [--latency] [LEVEL]
+//
+// With --latency, the time from every pad input to the present of the
+// frame that shows it is summed up on stdout once per second.
+int main(int argc, char* argv[])
 {
+    auto levelName = std::string{"test"};
+    bool measureLatency = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view{argv[i]} == "--latency") {
+            measureLatency = true;
+        } else {
+            levelName = argv[i];
+        }
+    }
+
     auto sdlInit = sdl::Init{SDL_INIT_VIDEO | SDL_INIT_AUDIO};
     auto imgInit = img::Init{IMG_INIT_PNG};
 
     auto window = Window{};
 
-    auto resources = Resources{window.renderer()};
+    // Shared by loading, simulation and rendering; the main thread is one of
+    // the workers
+    auto jobs = JobSystem{};
+
+    auto resources = Resources{window.renderer(), &jobs};
     resources.load(bi::dataFile);
+    auto dataWatcher = FileWatcher{bi::dataFile};
+
+    // Sounds are copied out of the data file, so that the audio thread never
+    // sees a reload. The game runs without sound if there is no device.
+    auto audio = std::optional<Audio>{};
+    try {
+        auto sounds = std::vector<std::vector<float>>{};
+        for (size_t i = 0; i < r::soundCount; i++) {
+            auto samples = resources.sound(static_cast<r::Sound>(i));
+            sounds.emplace_back(samples.begin(), samples.end());
+        }
+        audio.emplace(std::move(sounds));
+    } catch (const std::exception& e) {
+        std::cerr << "no audio: " << e.what() << "\n";
+    }
 
-    auto view = View{window, resources};
+    auto view = View{window, resources, &jobs};
 
+    // The world uses the bricks straight from the mapped level file. Large
+    // levels are compiled into chunks, and only the chunks around the view
+    // and the ball are kept in memory.
+    auto level = std::optional<Level>{};
+    auto stream = std::optional<LevelStream>{};
     auto world = World{};
-    world.setupTestLevel();
+    world.setJobs(&jobs);
+    if (auto chunks = bi::levelDir / (levelName + ".chunks");
+            std::filesystem::exists(chunks)) {
+        stream.emplace(chunks);
+        world.setupLevel(*stream);
+    } else {
+        level.emplace(bi::levelDir / (levelName + ".level"));
+        world.setupLevel(level->bricks(), level->grid());
+    }
+
+    // Brick changes that were already heard, and the level they are from
+    uint64_t heardBricks = 0;
+    uint64_t heardGeneration = world.bricksGeneration();
+
+    // F3 shows the performance overlay
+    using Clock = std::chrono::steady_clock;
+    auto overlay = PerfOverlay{resources, config.fps};
+    auto lastFrame = Clock::now();
+    uint64_t allocationsSeen =
+        perfCounters().allocations.load(std::memory_order_relaxed);
+
+    auto input = InputQueue{};
+    auto latency = std::optional<LatencyMeter>{};
+    if (measureLatency) {
+        latency.emplace(std::cout);
+    }
+
+    // The game pauses with P, and while the window is out of focus or hidden.
+    // Paused, it sleeps in the event queue and only draws when something
+    // besides the simulation changed the picture. It still wakes a few times
+    // per second to check for a new data file, and less often when hidden.
+    using namespace std::chrono_literals;
+    constexpr auto idleWake = 250ms;
+    constexpr auto hiddenWake = 1000ms;
+    bool paused = false;
+    bool unfocused = false;
+    bool hidden = false;
+    bool wasIdle = false;
+    bool redraw = true;
 
     auto timer = FrameTimer{config.fps};
     for (;;) {
+        bool idle = paused || unfocused || hidden;
+        auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+            timer.untilNext());
+        if (idle) {
+            timeout = hidden ? hiddenWake : idleWake;
+        }
+        if (redraw && !hidden) {
+            timeout = 0ms;
+        }
+
         bool done = false;
-        for (const auto& event : sdl::pollEvents()) {
+        for (const auto& event : sdl::waitEvents(timeout)) {
             if (event.type == SDL_QUIT) {
                 done = true;
                 break;
@@ -36,21 +140,163 @@ int main(int, char*[])
                 done = true;
                 break;
             }
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+                overlay.toggle();
+                redraw = true;
+            }
+            // Input while paused is dropped
+            if (!idle && input.push(event, window.size().w)) {
+                continue;
+            }
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p &&
+                    !event.key.repeat) {
+                paused = !paused;
+                redraw = true;
+            }
+            if (event.type == SDL_WINDOWEVENT) {
+                switch (event.window.event) {
+                case SDL_WINDOWEVENT_FOCUS_LOST:
+                    unfocused = true;
+                    redraw = true;
+                    break;
+                case SDL_WINDOWEVENT_FOCUS_GAINED:
+                    unfocused = false;
+                    break;
+                case SDL_WINDOWEVENT_HIDDEN:
+                case SDL_WINDOWEVENT_MINIMIZED:
+                    hidden = true;
+                    break;
+                case SDL_WINDOWEVENT_SHOWN:
+                case SDL_WINDOWEVENT_RESTORED:
+                case SDL_WINDOWEVENT_MAXIMIZED:
+                    hidden = false;
+                    redraw = true;
+                    break;
+                case SDL_WINDOWEVENT_EXPOSED:
+                case SDL_WINDOWEVENT_SIZE_CHANGED:
+                    redraw = true;
+                    break;
+                }
+            }
+            if (event.type == SDL_RENDER_TARGETS_RESET ||
+                    event.type == SDL_RENDER_DEVICE_RESET) {
+                view.invalidate();
+                redraw = true;
+            }
         }
 
         if (done) {
             break;
         }
 
-        if (int framesPassed = timer(); framesPassed > 0) {
-            for (int i = 0; i < framesPassed; i++) {
-                world.update(timer.delta());
+        if (dataWatcher.changed()) {
+            try {
+                resources.reload(bi::dataFile);
+                redraw = true;
+            } catch (const std::exception& e) {
+                std::cerr << "cannot reload " << bi::dataFile.string() <<
+                    ": " << e.what() << "\n";
             }
+        }
 
-            view.render(world);
+        // Time spent paused is not caught up on
+        idle = paused || unfocused || hidden;
+        if (idle != wasIdle) {
+            wasIdle = idle;
+            if (!idle) {
+                timer.reset();
+                input.clear();
+            }
         }
 
-        timer.relax();
+        int framesPassed = idle ? 0 : timer();
+        if (framesPassed > 0 || (redraw && !hidden)) {
+            redraw = false;
+            auto frameStart = Clock::now();
+            auto visible = view.camera().visibleArea();
+            world.focus(std::span{&visible, 1});
+            // Ticks cover the time up to the frame that is due, and apply
+            // the input that happened within them
+            auto tick = timer.frameDuration();
+            auto ticksStart = timer.frameTime() - tick * framesPassed;
+            for (int i = 0; i < framesPassed; i++) {
+                input.update(world, ticksStart + tick * i, tick, timer.delta());
+            }
+            auto updated = Clock::now();
+
+            if (heardGeneration != world.bricksGeneration()) {
+                heardBricks = 0;
+                heardGeneration = world.bricksGeneration();
+            }
+            // Changes too old to be kept are not worth a sound anymore
+            heardBricks = std::max(heardBricks, world.oldestBrickChange());
+            for (; heardBricks < world.brickChanges(); heardBricks++) {
+                auto change = world.brickChange(heardBricks);
+                if (audio && change.kind == BrickChange::Kind::State &&
+                        !change.alive) {
+                    audio->mixer().play(r::Sound::Hit);
+                }
+            }
+            view.animate(world, timer.delta() * framesPassed);
+
+            // Debug HUD, with the numbers of the previous frame
+            const auto& stats = view.stats();
+            float line = static_cast<float>(
+                resources.font(r::Font::Mono).lineHeight);
+            view.text(r::Font::Mono, "bricks\ndraw calls\nrender us", {8, 8});
+            view.text(
+                r::Font::Mono,
+                static_cast<int64_t>(world.liveBricks()),
+                {120, 8});
+            view.text(
+                r::Font::Mono,
+                static_cast<int64_t>(stats.drawCalls),
+                {120, 8 + line});
+            view.text(
+                r::Font::Mono,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    stats.clear + stats.bricks + stats.dynamic).count(),
+                {120, 8 + 2 * line});
+            if (idle) {
+                view.text(r::Font::Mono, "paused", {8, 8 + 4 * line});
+            }
+
+            overlay.queueText(view);
+            view.draw(world);
+            overlay.draw(window.renderer());
+            view.present();
+            auto rendered = Clock::now();
+
+            auto inputLatency = PerfSample::Duration{};
+            for (auto time : input.applied()) {
+                inputLatency = std::max(inputLatency, rendered - time);
+                if (latency) {
+                    latency->record(rendered - time);
+                }
+            }
+            input.clearApplied();
+            if (latency) {
+                latency->report(rendered);
+            }
+
+            auto allocations =
+                perfCounters().allocations.load(std::memory_order_relaxed);
+            overlay.record(PerfSample{
+                .frame = frameStart - lastFrame,
+                .update = updated - frameStart,
+                .render = rendered - updated,
+                .ticks = framesPassed,
+                .drawCalls = view.stats().drawCalls,
+                .allocations = allocations - allocationsSeen,
+                .input = inputLatency,
+            });
+            lastFrame = frameStart;
+            allocationsSeen = allocations;
+        } else if (!idle) {
+            // Events end the wait early, and the wait is in whole
+            // milliseconds, so this sleeps for what is left of the frame
+            timer.relax();
+        }
     }
 
 
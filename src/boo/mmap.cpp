@@ -1,20 +1,30 @@
 #include "mmap.hpp"
 
-#ifdef _WIN32
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#elif defined(_WIN32)
 #include <Windows.h>
 #endif
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <format>
 #include <source_location>
 #include <stdexcept>
 
 namespace {
 
 #if defined(__linux__)
-void checkErrno(std::source_location sl = std::source_location::current())
+[[noreturn]] void checkErrno(
+    std::source_location sl = std::source_location::current())
 {
     int e = errno;
-    throw Error{sl} << strerrorname_np(e) << ": " << strerrordesc_np(e);
+    throw std::runtime_error{std::format(
+        "{}:{}: {}: {}",
+        sl.file_name(), sl.line(), strerrorname_np(e), strerrordesc_np(e))};
 }
 #elif defined(_WIN32)
 [[noreturn]] void throwWindowsError()
@@ -41,11 +51,62 @@ void checkErrno(std::source_location sl = std::source_location::current())
 }
 #endif
 
+// Closes the file on every way out of the function that opened it, so that
+// errors after opening do not leak it. The mapping or the buffer holds the
+// contents, and failing to close a file that was only read loses nothing.
+class FileGuard {
+public:
+#if defined(__linux__)
+    explicit FileGuard(int fd)
+        : _fd(fd)
+    { }
+
+    ~FileGuard()
+    {
+        close(_fd);
+    }
+#elif defined(_WIN32)
+    explicit FileGuard(HANDLE handle)
+        : _handle(handle)
+    { }
+
+    ~FileGuard()
+    {
+        CloseHandle(_handle);
+    }
+#endif
+
+    FileGuard(const FileGuard&) = delete;
+    FileGuard& operator=(const FileGuard&) = delete;
+
+private:
+#if defined(__linux__)
+    int _fd = -1;
+#elif defined(_WIN32)
+    HANDLE _handle = nullptr;
+#endif
+};
+
+size_t systemPageSize()
+{
+#if defined(__linux__)
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+#elif defined(_WIN32)
+    static const size_t pageSize = [] {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwPageSize);
+    }();
+#endif
+    return pageSize;
+}
+
 } // namespace
 
-MemoryMap::MemoryMap(const std::filesystem::path& path)
+MemoryMap::MemoryMap(
+    const std::filesystem::path& path, const MapOptions& options)
 {
-    map(path);
+    map(path, options);
 }
 
 MemoryMap::~MemoryMap()
@@ -67,27 +128,42 @@ MemoryMap& MemoryMap::operator=(MemoryMap&& other) noexcept
     return *this;
 }
 
-void MemoryMap::map(const std::filesystem::path& path)
+void MemoryMap::map(
+    const std::filesystem::path& path, const MapOptions& options)
 {
-#if defined(__linux)
+    clear();
+
+    if (options.strategy == MapOptions::Strategy::Read) {
+        read(path);
+        return;
+    }
+
+#if defined(__linux__)
     int fd = open(path.string().c_str(), O_RDONLY);
     if (fd == -1) {
         int e = errno;
-        throw Error{} << "cannot open file " << path << ": " <<
-            strerrorname_np(e) << ": " << strerrordesc_np(e);
+        throw std::runtime_error{std::format(
+            "cannot open file {}: {}: {}",
+            path.string(), strerrorname_np(e), strerrordesc_np(e))};
     };
+    auto file = FileGuard{fd};
 
     auto fileSize = lseek(fd, 0, SEEK_END);
     if (fileSize == -1) {
         checkErrno();
     }
-    _len = fileSize;
 
-    void* addr = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    int flags = MAP_SHARED;
+    if (options.prefault == MapOptions::Prefault::Populate) {
+        flags |= MAP_POPULATE;
+    }
+
+    void* addr = mmap(nullptr, fileSize, PROT_READ, flags, fd, 0);
     if (addr == MAP_FAILED) {
         checkErrno();
     }
     _addr = addr;
+    _len = fileSize;
 #elif defined(_WIN32)
     HANDLE fileHandle = CreateFileW(
         path.c_str(),
@@ -95,11 +171,13 @@ void MemoryMap::map(const std::filesystem::path& path)
         FILE_SHARE_READ,
         NULL,
         OPEN_EXISTING,
-        FILE_ATTRIBUTE_NORMAL,
+        options.sequential ?
+            FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL,
         NULL);
     if (fileHandle == INVALID_HANDLE_VALUE) {
         throwWindowsError();
     }
+    auto file = FileGuard{fileHandle};
 
     LARGE_INTEGER fileSize;
     if (GetFileSizeEx(fileHandle, &fileSize) == 0) {
@@ -117,11 +195,6 @@ void MemoryMap::map(const std::filesystem::path& path)
     if (mappingHandle == NULL) {
         throwWindowsError();
     }
-    _mappingHandle = mappingHandle;
-
-    if (CloseHandle(fileHandle) == 0) {
-        throwWindowsError();
-    }
 
     LPVOID addr = MapViewOfFile(
         mappingHandle,
@@ -130,15 +203,159 @@ void MemoryMap::map(const std::filesystem::path& path)
         0,
         0);
     if (addr == NULL) {
+        auto mapping = FileGuard{mappingHandle};
         throwWindowsError();
     }
+    _mappingHandle = mappingHandle;
     _addr = addr;
 #endif
+
+    advise(options);
+    if (options.prefault == MapOptions::Prefault::Touch) {
+        touch();
+    }
+}
+
+void MemoryMap::read(const std::filesystem::path& path)
+{
+#if defined(__linux__)
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        int e = errno;
+        throw std::runtime_error{std::format(
+            "cannot open file {}: {}: {}",
+            path.string(), strerrorname_np(e), strerrordesc_np(e))};
+    };
+    auto file = FileGuard{fd};
+
+    auto fileSize = lseek(fd, 0, SEEK_END);
+    if (fileSize == -1) {
+        checkErrno();
+    }
+
+    auto buffer = std::make_unique_for_overwrite<std::byte[]>(fileSize);
+    for (off_t offset = 0; offset < fileSize; ) {
+        auto bytesRead = pread(
+            fd, buffer.get() + offset, fileSize - offset, offset);
+        if (bytesRead == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            checkErrno();
+        }
+        if (bytesRead == 0) {
+            throw std::runtime_error{std::format(
+                "unexpected end of file {}", path.string())};
+        }
+        offset += bytesRead;
+    }
+    _len = fileSize;
+#elif defined(_WIN32)
+    HANDLE fileHandle = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        throwWindowsError();
+    }
+    auto file = FileGuard{fileHandle};
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(fileHandle, &fileSize) == 0) {
+        throwWindowsError();
+    }
+
+    auto buffer =
+        std::make_unique_for_overwrite<std::byte[]>(fileSize.QuadPart);
+    for (LONGLONG offset = 0; offset < fileSize.QuadPart; ) {
+        DWORD chunk = static_cast<DWORD>(std::min<LONGLONG>(
+            fileSize.QuadPart - offset, 1 << 30));
+        DWORD bytesRead = 0;
+        if (ReadFile(
+                fileHandle, buffer.get() + offset, chunk, &bytesRead, NULL) == 0) {
+            throwWindowsError();
+        }
+        if (bytesRead == 0) {
+            throw std::runtime_error{"unexpected end of file"};
+        }
+        offset += bytesRead;
+    }
+    _len = fileSize.QuadPart;
+#endif
+
+    _buffer = std::move(buffer);
+    _addr = _buffer.get();
+}
+
+// Hints are advisory, so failures are ignored: e.g. huge pages for file
+// mappings are only supported by some kernels and file systems.
+void MemoryMap::advise(const MapOptions& options)
+{
+#if defined(__linux__)
+    if (options.sequential) {
+        madvise(_addr, _len, MADV_SEQUENTIAL);
+    }
+    if (options.willNeed) {
+        madvise(_addr, _len, MADV_WILLNEED);
+    }
+    if (options.random) {
+        madvise(_addr, _len, MADV_RANDOM);
+    }
+#ifdef MADV_HUGEPAGE
+    if (options.hugePages) {
+        madvise(_addr, _len, MADV_HUGEPAGE);
+    }
+#endif
+#elif defined(_WIN32)
+    if (options.willNeed ||
+            options.prefault == MapOptions::Prefault::Populate) {
+        WIN32_MEMORY_RANGE_ENTRY range{.VirtualAddress = _addr, .NumberOfBytes = _len};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#endif
+}
+
+void MemoryMap::release(size_t offset, size_t size) const
+{
+    if (_buffer || offset >= _len) {
+        return;
+    }
+    size = std::min(size, _len - offset);
+
+    size_t pageSize = systemPageSize();
+    size_t begin = offset / pageSize * pageSize;
+    size_t end = std::min(
+        (offset + size + pageSize - 1) / pageSize * pageSize, _len);
+    if (end <= begin) {
+        return;
+    }
+    auto* pages = static_cast<std::byte*>(_addr) + begin;
+#if defined(__linux__)
+    madvise(pages, end - begin, MADV_DONTNEED);
+#elif defined(_WIN32)
+    // Unlocking pages that are not locked removes them from the working set
+    VirtualUnlock(pages, end - begin);
+#endif
+}
+
+void MemoryMap::touch() const
+{
+    size_t pageSize = systemPageSize();
+    const volatile auto* bytes = static_cast<const volatile std::byte*>(_addr);
+    for (size_t offset = 0; offset < _len; offset += pageSize) {
+        (void)bytes[offset];
+    }
 }
 
 void MemoryMap::clear()
 {
-    if (_addr) {
+    if (_buffer) {
+        _buffer.reset();
+    } else if (_addr) {
 #if defined(__linux__)
         munmap(_addr, _len);
 #elif defined(_WIN32)
@@ -164,6 +381,7 @@ void swap(MemoryMap& x, MemoryMap& y) noexcept
 {
     std::swap(x._addr, y._addr);
     std::swap(x._len, y._len);
+    std::swap(x._buffer, y._buffer);
 #ifdef _WIN32
     std::swap(x._mappingHandle, y._mappingHandle);
 #endif
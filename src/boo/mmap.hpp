@@ -1,11 +1,45 @@
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
+#include <memory>
+
+// How the contents of a file end up in memory, and what the OS is told about
+// the way they are going to be accessed. Hints are best effort: they are
+// ignored where the platform does not support them.
+struct MapOptions {
+    enum class Strategy {
+        // Map the file; pages are read on first access
+        Map,
+        // Read the whole file into an allocated buffer
+        Read,
+    };
+
+    enum class Prefault {
+        // Leave pages to be faulted in on first access
+        None,
+        // Let the kernel read the file and fill page tables while mapping
+        // (MAP_POPULATE)
+        Populate,
+        // Read one byte of every page right after mapping
+        Touch,
+    };
+
+    Strategy strategy = Strategy::Map;
+    Prefault prefault = Prefault::None;
+    bool sequential = false;
+    bool willNeed = false;
+    // Pages are accessed in no particular order, so the OS should not read
+    // or map the pages around the one that is accessed
+    bool random = false;
+    bool hugePages = false;
+};
 
 class MemoryMap {
 public:
     MemoryMap() = default;
-    explicit MemoryMap(const std::filesystem::path& path);
+    explicit MemoryMap(
+        const std::filesystem::path& path, const MapOptions& options = {});
     ~MemoryMap();
 
     MemoryMap(MemoryMap&& other) noexcept;
@@ -14,18 +48,28 @@ public:
     MemoryMap(const MemoryMap&) = delete;
     MemoryMap& operator=(const MemoryMap&) = delete;
 
-    void map(const std::filesystem::path& path);
+    void map(const std::filesystem::path& path, const MapOptions& options = {});
     void clear();
 
     const void* addr() const;
     size_t size() const;
 
+    // Lets the OS drop every page that the range touches from memory; they
+    // are read from the file again on the next access. Does nothing when the
+    // file was read into a buffer.
+    void release(size_t offset, size_t size) const;
+
     friend void swap(MemoryMap& x, MemoryMap& y) noexcept;
 
 private:
+    void read(const std::filesystem::path& path);
+    void advise(const MapOptions& options);
+    void touch() const;
+
     void* _addr = nullptr;
     size_t _len = 0;
+    std::unique_ptr<std::byte[]> _buffer;
 #if defined(_WIN32)
     void* _mappingHandle = nullptr;
 #endif
-};
\ No newline at end of file
+};
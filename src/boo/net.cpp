@@ -0,0 +1,323 @@
+#include "net.hpp"
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+#if defined(__linux__)
+[[noreturn]] void checkErrno(
+    std::source_location sl = std::source_location::current())
+{
+    int e = errno;
+    throw std::runtime_error{std::format(
+        "{}:{}: {}: {}",
+        sl.file_name(), sl.line(), strerrorname_np(e), strerrordesc_np(e))};
+}
+
+bool wouldBlock()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+void closeSocket(intptr_t handle)
+{
+    ::close(static_cast<int>(handle));
+}
+#elif defined(_WIN32)
+[[noreturn]] void throwSocketError(
+    std::source_location sl = std::source_location::current())
+{
+    throw std::runtime_error{std::format(
+        "{}:{}: socket error {}", sl.file_name(), sl.line(), WSAGetLastError())};
+}
+
+bool wouldBlock()
+{
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+void closeSocket(intptr_t handle)
+{
+    closesocket(static_cast<SOCKET>(handle));
+}
+
+// Winsock is started on first use and never cleaned up, which is fine for a
+// process that keeps its sockets until exit
+void startWinsock()
+{
+    static const int result = [] {
+        auto data = WSADATA{};
+        return WSAStartup(MAKEWORD(2, 2), &data);
+    }();
+    if (result != 0) {
+        throw std::runtime_error{
+            std::format("cannot start Winsock: error {}", result)};
+    }
+}
+#endif
+
+sockaddr_in toSockaddr(const Endpoint& endpoint)
+{
+    auto address = sockaddr_in{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(endpoint.address);
+    address.sin_port = htons(endpoint.port);
+    return address;
+}
+
+// Uniform in [0, 1), the same on every standard library
+double uniform(std::mt19937_64& random)
+{
+    return static_cast<double>(random() >> 11) * 0x1.0p-53;
+}
+
+} // namespace
+
+Endpoint Endpoint::loopback(uint16_t port)
+{
+    return Endpoint{.address = INADDR_LOOPBACK, .port = port};
+}
+
+UdpSocket::UdpSocket(uint16_t port)
+{
+#if defined(__linux__)
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        checkErrno();
+    }
+    _handle = fd;
+
+    auto address = toSockaddr(Endpoint{.address = INADDR_ANY, .port = port});
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address))
+            == -1) {
+        int e = errno;
+        close();
+        throw std::runtime_error{std::format(
+            "cannot bind UDP port {}: {}: {}",
+            port, strerrorname_np(e), strerrordesc_np(e))};
+    }
+#elif defined(_WIN32)
+    startWinsock();
+
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        throwSocketError();
+    }
+    _handle = static_cast<intptr_t>(s);
+
+    u_long nonBlocking = 1;
+    if (ioctlsocket(s, FIONBIO, &nonBlocking) == SOCKET_ERROR) {
+        throwSocketError();
+    }
+
+    auto address = toSockaddr(Endpoint{.address = INADDR_ANY, .port = port});
+    if (bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address))
+            == SOCKET_ERROR) {
+        int error = WSAGetLastError();
+        close();
+        throw std::runtime_error{std::format(
+            "cannot bind UDP port {}: socket error {}", port, error)};
+    }
+#endif
+}
+
+UdpSocket::~UdpSocket()
+{
+    close();
+}
+
+UdpSocket::UdpSocket(UdpSocket&& other) noexcept
+    : _handle(std::exchange(other._handle, -1))
+{ }
+
+UdpSocket& UdpSocket::operator=(UdpSocket&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        _handle = std::exchange(other._handle, -1);
+    }
+    return *this;
+}
+
+uint16_t UdpSocket::port() const
+{
+    auto address = sockaddr_in{};
+    auto length = static_cast<socklen_t>(sizeof(address));
+#if defined(__linux__)
+    if (getsockname(
+            static_cast<int>(_handle),
+            reinterpret_cast<sockaddr*>(&address),
+            &length) == -1) {
+        checkErrno();
+    }
+#elif defined(_WIN32)
+    if (getsockname(
+            static_cast<SOCKET>(_handle),
+            reinterpret_cast<sockaddr*>(&address),
+            &length) == SOCKET_ERROR) {
+        throwSocketError();
+    }
+#endif
+    return ntohs(address.sin_port);
+}
+
+void UdpSocket::send(const Endpoint& to, std::span<const std::byte> packet)
+{
+    auto address = toSockaddr(to);
+#if defined(__linux__)
+    sendto(
+        static_cast<int>(_handle),
+        packet.data(),
+        packet.size(),
+        0,
+        reinterpret_cast<const sockaddr*>(&address),
+        sizeof(address));
+#elif defined(_WIN32)
+    sendto(
+        static_cast<SOCKET>(_handle),
+        reinterpret_cast<const char*>(packet.data()),
+        static_cast<int>(packet.size()),
+        0,
+        reinterpret_cast<const sockaddr*>(&address),
+        sizeof(address));
+#endif
+}
+
+std::optional<size_t> UdpSocket::receive(
+    std::span<std::byte> buffer, Endpoint& from)
+{
+    auto address = sockaddr_in{};
+    auto length = static_cast<socklen_t>(sizeof(address));
+#if defined(__linux__)
+    auto received = recvfrom(
+        static_cast<int>(_handle),
+        buffer.data(),
+        buffer.size(),
+        MSG_TRUNC,
+        reinterpret_cast<sockaddr*>(&address),
+        &length);
+    if (received == -1) {
+        // Errors reported by the network for earlier sends (like ICMP port
+        // unreachable while the peer is not up yet) are not fatal either
+        if (wouldBlock() || errno == ECONNREFUSED || errno == EINTR) {
+            return std::nullopt;
+        }
+        checkErrno();
+    }
+#elif defined(_WIN32)
+    int received = recvfrom(
+        static_cast<SOCKET>(_handle),
+        reinterpret_cast<char*>(buffer.data()),
+        static_cast<int>(buffer.size()),
+        0,
+        reinterpret_cast<sockaddr*>(&address),
+        &length);
+    if (received == SOCKET_ERROR) {
+        int error = WSAGetLastError();
+        if (error == WSAEMSGSIZE) {
+            received = static_cast<int>(buffer.size());
+        } else if (wouldBlock() || error == WSAECONNRESET) {
+            return std::nullopt;
+        } else {
+            throwSocketError();
+        }
+    }
+#endif
+    from = Endpoint{
+        .address = ntohl(address.sin_addr.s_addr),
+        .port = ntohs(address.sin_port),
+    };
+    return std::min(static_cast<size_t>(received), buffer.size());
+}
+
+void UdpSocket::close()
+{
+    if (_handle != -1) {
+        closeSocket(_handle);
+        _handle = -1;
+    }
+}
+
+Link::Link(UdpSocket socket, Endpoint peer, const LinkConditions& conditions)
+    : _socket(std::move(socket))
+    , _peer(peer)
+    , _conditions(conditions)
+    , _random(conditions.seed)
+{ }
+
+void Link::send(std::span<const std::byte> packet)
+{
+    if (packet.size() > UdpSocket::maxPacketSize) {
+        throw std::runtime_error{std::format(
+            "packet of {} bytes is over the limit of {}",
+            packet.size(), UdpSocket::maxPacketSize)};
+    }
+
+    if (_conditions.loss > 0 && uniform(_random) < _conditions.loss) {
+        _stats.dropped++;
+        return;
+    }
+
+    uint64_t delay = _conditions.latencyTicks;
+    if (_conditions.jitterTicks > 0) {
+        delay += _random() % (_conditions.jitterTicks + 1);
+    }
+    if (delay == 0) {
+        _socket.send(_peer, packet);
+        _stats.sent++;
+        return;
+    }
+
+    auto& held = _held.emplace_back();
+    held.dueTick = _tick + delay;
+    held.size = packet.size();
+    std::ranges::copy(packet, held.data.begin());
+}
+
+std::optional<size_t> Link::receive(std::span<std::byte> buffer)
+{
+    auto from = Endpoint{};
+    while (auto size = _socket.receive(buffer, from)) {
+        if (from == _peer) {
+            _stats.received++;
+            return size;
+        }
+    }
+    return std::nullopt;
+}
+
+void Link::tick()
+{
+    _tick++;
+    // Jitter can reorder packets, as it would on a real network
+    std::erase_if(_held, [this] (const HeldPacket& held) {
+        if (held.dueTick > _tick) {
+            return false;
+        }
+        _socket.send(_peer, std::span{held.data}.first(held.size));
+        _stats.sent++;
+        return true;
+    });
+}
+
+const LinkStats& Link::stats() const
+{
+    return _stats;
+}
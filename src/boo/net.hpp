@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <vector>
+
+// IPv4 address and port, both in host byte order
+struct Endpoint {
+    uint32_t address = 0;
+    uint16_t port = 0;
+
+    static Endpoint loopback(uint16_t port);
+
+    friend bool operator==(const Endpoint&, const Endpoint&) = default;
+};
+
+// Non-blocking UDP socket
+class UdpSocket {
+public:
+    static constexpr size_t maxPacketSize = 512;
+
+    UdpSocket() = default;
+    // Binds to the port on all interfaces; port 0 picks a free one
+    explicit UdpSocket(uint16_t port);
+    ~UdpSocket();
+
+    UdpSocket(UdpSocket&& other) noexcept;
+    UdpSocket& operator=(UdpSocket&& other) noexcept;
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    uint16_t port() const;
+
+    // Datagrams are fire and forget, so a failed send is not an error
+    void send(const Endpoint& to, std::span<const std::byte> packet);
+    // Returns the size of the packet, or nothing if no packet is waiting.
+    // Longer packets are truncated to the buffer.
+    std::optional<size_t> receive(std::span<std::byte> buffer, Endpoint& from);
+
+    void close();
+
+private:
+    // SOCKET on Windows, file descriptor elsewhere
+    intptr_t _handle = -1;
+};
+
+// Simulated network conditions, in ticks. Loss is the probability of
+// dropping a packet.
+struct LinkConditions {
+    uint32_t latencyTicks = 0;
+    uint32_t jitterTicks = 0;
+    float loss = 0;
+    uint64_t seed = 1;
+};
+
+struct LinkStats {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t dropped = 0;
+};
+
+// A socket talking to a single peer. Packets from other endpoints are
+// ignored. Sent packets go through the link conditions: they are dropped,
+// or held back until tick() has been called enough times, which lets the
+// loopback harness emulate a real network deterministically.
+class Link {
+public:
+    Link(UdpSocket socket, Endpoint peer, const LinkConditions& conditions = {});
+
+    void send(std::span<const std::byte> packet);
+    std::optional<size_t> receive(std::span<std::byte> buffer);
+
+    // Sends the held packets that are due
+    void tick();
+
+    const LinkStats& stats() const;
+
+private:
+    struct HeldPacket {
+        uint64_t dueTick = 0;
+        size_t size = 0;
+        std::array<std::byte, UdpSocket::maxPacketSize> data;
+    };
+
+    UdpSocket _socket;
+    Endpoint _peer;
+    LinkConditions _conditions;
+    std::mt19937_64 _random;
+    uint64_t _tick = 0;
+    std::vector<HeldPacket> _held;
+    LinkStats _stats;
+};
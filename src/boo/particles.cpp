@@ -0,0 +1,279 @@
+#include "particles.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define BOO_PARTICLES_SSE2
+#endif
+
+namespace {
+
+constexpr size_t lanes = 4;
+
+// Batch of sprites that are not drawn
+constexpr size_t noBatch = SIZE_MAX;
+
+size_t roundUpToLanes(size_t size)
+{
+    return (size + lanes - 1) / lanes * lanes;
+}
+
+} // namespace
+
+// Arrays are padded to a whole number of SIMD lanes. Padding slots are never
+// handed out, and stay dead.
+Particles::Particles(size_t capacity)
+    : _capacity(capacity)
+    , _x(roundUpToLanes(capacity))
+    , _y(roundUpToLanes(capacity))
+    , _vx(roundUpToLanes(capacity))
+    , _vy(roundUpToLanes(capacity))
+    , _life(roundUpToLanes(capacity))
+    , _lifetime(roundUpToLanes(capacity), 1.f)
+    , _size(roundUpToLanes(capacity))
+    , _sprite(roundUpToLanes(capacity))
+{
+    _free.reserve(capacity);
+}
+
+// A particle that does not die would keep the pool from ever packing again
+bool Particles::emit(const Particle& particle)
+{
+    if (!std::isfinite(particle.lifetime) || particle.lifetime <= 0) {
+        return false;
+    }
+
+    size_t slot = 0;
+    if (!_free.empty()) {
+        slot = _free.back();
+        _free.pop_back();
+    } else if (_used < _capacity) {
+        slot = _used++;
+    } else {
+        return false;
+    }
+
+    _x[slot] = particle.position.x;
+    _y[slot] = particle.position.y;
+    _vx[slot] = particle.velocity.x;
+    _vy[slot] = particle.velocity.y;
+    _life[slot] = particle.lifetime;
+    _lifetime[slot] = particle.lifetime;
+    _size[slot] = particle.size;
+    _sprite[slot] = particle.sprite;
+    _live++;
+    return true;
+}
+
+void Particles::clear()
+{
+    std::fill(_life.begin(), _life.end(), 0.f);
+    std::fill(_vx.begin(), _vx.end(), 0.f);
+    std::fill(_vy.begin(), _vy.end(), 0.f);
+    _free.clear();
+    _used = 0;
+    _live = 0;
+}
+
+// Dead slots are integrated along with the rest, which keeps the loop free of
+// branches; their velocity is zeroed when they die, so they stay put. Each
+// group of four reports which lanes have just died, and those slots go to the
+// free list.
+void Particles::update(float delta, const Vector& acceleration)
+{
+    size_t end = roundUpToLanes(_used);
+    float* x = _x.data();
+    float* y = _y.data();
+    float* vx = _vx.data();
+    float* vy = _vy.data();
+    float* life = _life.data();
+
+    auto died = [this, vx, vy] (size_t first, unsigned mask) {
+        while (mask != 0) {
+            size_t slot = first + std::countr_zero(mask);
+            mask &= mask - 1;
+            vx[slot] = 0;
+            vy[slot] = 0;
+            _free.push_back(static_cast<uint32_t>(slot));
+            _live--;
+        }
+    };
+
+#if defined(BOO_PARTICLES_SSE2)
+    const __m128 dt = _mm_set1_ps(delta);
+    const __m128 ax = _mm_set1_ps(acceleration.x * delta);
+    const __m128 ay = _mm_set1_ps(acceleration.y * delta);
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = 0; i < end; i += lanes) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pvx = _mm_loadu_ps(vx + i);
+        __m128 pvy = _mm_loadu_ps(vy + i);
+        __m128 oldLife = _mm_loadu_ps(life + i);
+        __m128 alive = _mm_cmpgt_ps(oldLife, zero);
+
+        // Dead lanes get no acceleration
+        pvx = _mm_add_ps(pvx, _mm_and_ps(ax, alive));
+        pvy = _mm_add_ps(pvy, _mm_and_ps(ay, alive));
+        px = _mm_add_ps(px, _mm_mul_ps(pvx, dt));
+        py = _mm_add_ps(py, _mm_mul_ps(pvy, dt));
+        __m128 newLife = _mm_sub_ps(oldLife, _mm_and_ps(dt, alive));
+
+        _mm_storeu_ps(x + i, px);
+        _mm_storeu_ps(y + i, py);
+        _mm_storeu_ps(vx + i, pvx);
+        _mm_storeu_ps(vy + i, pvy);
+        _mm_storeu_ps(life + i, newLife);
+
+        auto mask = static_cast<unsigned>(_mm_movemask_ps(
+            _mm_and_ps(alive, _mm_cmple_ps(newLife, zero))));
+        if (mask != 0) {
+            died(i, mask);
+        }
+    }
+#else
+    for (size_t i = 0; i < end; i += lanes) {
+        unsigned mask = 0;
+        for (size_t lane = 0; lane < lanes; lane++) {
+            size_t j = i + lane;
+            bool alive = life[j] > 0;
+            float step = alive ? delta : 0.f;
+            vx[j] += acceleration.x * step;
+            vy[j] += acceleration.y * step;
+            x[j] += vx[j] * delta;
+            y[j] += vy[j] * delta;
+            life[j] -= step;
+            if (alive && life[j] <= 0) {
+                mask |= 1u << lane;
+            }
+        }
+        if (mask != 0) {
+            died(i, mask);
+        }
+    }
+#endif
+
+    // Once everything is dead, new particles are packed from the start again
+    if (_live == 0) {
+        _free.clear();
+        _used = 0;
+    }
+}
+
+size_t Particles::size() const
+{
+    return _live;
+}
+
+size_t Particles::capacity() const
+{
+    return _capacity;
+}
+
+void Particles::prepare(
+    std::span<const ParticleSprite> sprites, SDL_FPoint origin, float scale)
+{
+    for (auto& batch : _batches) {
+        batch.vertices.clear();
+    }
+    _batchCount = 0;
+
+    // Particles of sprites that share a texture go to the same batch, and
+    // sprites without a texture are left out
+    _spriteBatches.resize(sprites.size());
+    for (size_t i = 0; i < sprites.size(); i++) {
+        if (!sprites[i].texture) {
+            _spriteBatches[i] = noBatch;
+            continue;
+        }
+        size_t batch = 0;
+        while (batch < _batchCount &&
+                _batches[batch].texture != sprites[i].texture) {
+            batch++;
+        }
+        if (batch == _batchCount) {
+            if (_batches.size() == _batchCount) {
+                _batches.emplace_back();
+            }
+            _batches[batch].texture = sprites[i].texture;
+            _batchCount++;
+        }
+        _spriteBatches[i] = batch;
+    }
+
+    // Batches are sized in a first pass, so that the second one writes
+    // vertices through plain pointers
+    auto drawn = [&] (size_t i) {
+        return _life[i] > 0 && _sprite[i] < sprites.size() &&
+            _spriteBatches[_sprite[i]] != noBatch;
+    };
+    _batchSizes.assign(_batchCount, 0);
+    for (size_t i = 0; i < _used; i++) {
+        if (drawn(i)) {
+            _batchSizes[_spriteBatches[_sprite[i]]] += 4;
+        }
+    }
+    _batchEnds.resize(_batchCount);
+    for (size_t i = 0; i < _batchCount; i++) {
+        _batches[i].vertices.resize(_batchSizes[i]);
+        _batchEnds[i] = _batches[i].vertices.data();
+    }
+
+    for (size_t i = 0; i < _used; i++) {
+        if (!drawn(i)) {
+            continue;
+        }
+
+        float half = _size[i] * scale / 2;
+        float cx = origin.x + _x[i] * scale;
+        float cy = origin.y - _y[i] * scale;
+        auto alpha = static_cast<uint8_t>(
+            std::clamp(_life[i] / _lifetime[i], 0.f, 1.f) * 255);
+        auto color = SDL_Color{255, 255, 255, alpha};
+        const auto& uv = sprites[_sprite[i]].uv;
+
+        SDL_Vertex*& vertex = _batchEnds[_spriteBatches[_sprite[i]]];
+        vertex[0] = {{cx - half, cy - half}, color, {uv.x, uv.y}};
+        vertex[1] = {{cx + half, cy - half}, color, {uv.x + uv.w, uv.y}};
+        vertex[2] = {{cx + half, cy + half}, color, {uv.x + uv.w, uv.y + uv.h}};
+        vertex[3] = {{cx - half, cy + half}, color, {uv.x, uv.y + uv.h}};
+        vertex += 4;
+    }
+
+    size_t maxQuads = 0;
+    for (size_t i = 0; i < _batchCount; i++) {
+        maxQuads = std::max(maxQuads, _batches[i].vertices.size() / 4);
+    }
+    for (size_t quad = _indices.size() / 6; quad < maxQuads; quad++) {
+        int base = static_cast<int>(quad * 4);
+        for (int i : {0, 1, 2, 0, 2, 3}) {
+            _indices.push_back(base + i);
+        }
+    }
+}
+
+void Particles::submit(sdl::Renderer& renderer)
+{
+    for (size_t i = 0; i < _batchCount; i++) {
+        const auto& batch = _batches[i];
+        if (batch.vertices.empty()) {
+            continue;
+        }
+        renderer.geometry(
+            *batch.texture,
+            batch.vertices,
+            std::span{_indices}.first(batch.vertices.size() / 4 * 6));
+    }
+}
+
+size_t Particles::batches() const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < _batchCount; i++) {
+        count += _batches[i].vertices.empty() ? 0 : 1;
+    }
+    return count;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include "sdl.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct Particle {
+    Vector position;
+    Vector velocity;
+    float lifetime = 1;
+    // Width and height, in world units
+    float size = 0.1f;
+    // Index into the sprites given to prepare()
+    uint16_t sprite = 0;
+};
+
+// Texture and the part of it that particles are drawn with, in texture
+// coordinates from 0 to 1
+struct ParticleSprite {
+    sdl::Texture* texture = nullptr;
+    SDL_FRect uv;
+};
+
+// Fixed-capacity particle pool. State is kept in parallel arrays, and slots of
+// dead particles are recycled through a free list, so emitting and updating
+// never allocate. Particles fade out over their lifetime.
+class Particles {
+public:
+    explicit Particles(size_t capacity);
+
+    // Returns false, and drops the particle, if the pool is full, or if its
+    // lifetime is not a positive, finite number
+    bool emit(const Particle& particle);
+    void clear();
+
+    // Moves all particles with SIMD, four at a time
+    void update(float delta, const Vector& acceleration = {});
+
+    size_t size() const;
+    size_t capacity() const;
+
+    // Builds the vertices of live particles, one batch per texture. A world
+    // point (x, y) is drawn at origin + (x, -y) * scale. Particles of
+    // sprites without a texture are not drawn.
+    void prepare(
+        std::span<const ParticleSprite> sprites, SDL_FPoint origin, float scale);
+    // Draws what prepare() built, with one draw call per batch
+    void submit(sdl::Renderer& renderer);
+    size_t batches() const;
+
+private:
+    struct Batch {
+        sdl::Texture* texture = nullptr;
+        std::vector<SDL_Vertex> vertices;
+    };
+
+    size_t _capacity = 0;
+    // Slots below this have been used; slots above are all free
+    size_t _used = 0;
+    size_t _live = 0;
+
+    std::vector<float> _x;
+    std::vector<float> _y;
+    std::vector<float> _vx;
+    std::vector<float> _vy;
+    // Time left; the particle is dead when it is not positive
+    std::vector<float> _life;
+    std::vector<float> _lifetime;
+    std::vector<float> _size;
+    std::vector<uint16_t> _sprite;
+    std::vector<uint32_t> _free;
+
+    std::vector<Batch> _batches;
+    size_t _batchCount = 0;
+    std::vector<size_t> _spriteBatches;
+    std::vector<size_t> _batchSizes;
+    std::vector<SDL_Vertex*> _batchEnds;
+    // Two triangles per quad; shared by all batches, and only grows
+    std::vector<int> _indices;
+};
@@ -0,0 +1,235 @@
+#include "perf.hpp"
+
+#include <algorithm>
+
+namespace {
+
+PerfCounters counters;
+
+// Layout in screen pixels, below the debug HUD
+constexpr float left = 8;
+constexpr float top = 96;
+constexpr float graphX = 112;
+constexpr float graphHeight = 40;
+constexpr float graphGap = 8;
+constexpr float valueX = graphX + PerfOverlay::historySize + 8;
+
+// Graphs go up to two frame budgets, the histogram up to six
+constexpr int graphBudgets = 2;
+constexpr size_t histogramBuckets = 24;
+constexpr int bucketsPerBudget = 4;
+
+constexpr SDL_Color background {0, 0, 0, 160};
+constexpr SDL_Color budgetLine {255, 255, 255, 96};
+constexpr SDL_Color frameColor {96, 224, 96, 255};
+constexpr SDL_Color updateColor {96, 160, 255, 255};
+constexpr SDL_Color renderColor {255, 176, 64, 255};
+constexpr SDL_Color lateColor {255, 64, 64, 255};
+
+float graphY(int index)
+{
+    return top + index * (graphHeight + graphGap);
+}
+
+int64_t micros(PerfSample::Duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+} // namespace
+
+PerfCounters& perfCounters()
+{
+    return counters;
+}
+
+PerfOverlay::PerfOverlay(const Resources& resources, int fps)
+    : _resources(resources)
+    , _budget(std::chrono::duration_cast<PerfSample::Duration>(
+        std::chrono::duration<double>{1.0 / fps}))
+{ }
+
+void PerfOverlay::toggle()
+{
+    _visible = !_visible;
+}
+
+bool PerfOverlay::visible() const
+{
+    return _visible;
+}
+
+void PerfOverlay::record(const PerfSample& sample)
+{
+    _samples[_next] = sample;
+    _next = (_next + 1) % historySize;
+    _count = std::min(_count + 1, historySize);
+}
+
+void PerfOverlay::queueText(View& view) const
+{
+    if (!_visible) {
+        return;
+    }
+
+    auto worst = PerfSample{};
+    size_t bursts = 0;
+    uint64_t allocations = 0;
+    for (size_t i = 0; i < _count; i++) {
+        const auto& s = sample(i);
+        worst.frame = std::max(worst.frame, s.frame);
+        worst.update = std::max(worst.update, s.update);
+        worst.render = std::max(worst.render, s.render);
+        worst.ticks = std::max(worst.ticks, s.ticks);
+        worst.input = std::max(worst.input, s.input);
+        bursts += s.ticks > 1 ? 1 : 0;
+        allocations += s.allocations;
+    }
+    const auto& last = _count > 0 ? sample(_count - 1) : PerfSample{};
+
+    // Values are in microseconds: the last one, then the worst in the history
+    auto line = static_cast<float>(_resources.font(r::Font::Mono).lineHeight);
+    auto font = r::Font::Mono;
+    view.text(font, "frame us", {left, graphY(0)});
+    view.text(font, micros(last.frame), {valueX, graphY(0)});
+    view.text(font, micros(worst.frame), {valueX, graphY(0) + line});
+    view.text(font, "update us", {left, graphY(1)});
+    view.text(font, micros(last.update), {valueX, graphY(1)});
+    view.text(font, micros(worst.update), {valueX, graphY(1) + line});
+    view.text(font, "render us", {left, graphY(2)});
+    view.text(font, micros(last.render), {valueX, graphY(2)});
+    view.text(font, micros(worst.render), {valueX, graphY(2) + line});
+    view.text(font, "frames", {left, graphY(3)});
+
+    float y = graphY(4);
+    view.text(
+        font, "bursts\nmax ticks\ndraw calls\nallocs\ninput us", {left, y});
+    view.text(font, static_cast<int64_t>(bursts), {graphX, y});
+    view.text(font, worst.ticks, {graphX, y + line});
+    view.text(font, static_cast<int64_t>(last.drawCalls), {graphX, y + 2 * line});
+    view.text(font, static_cast<int64_t>(allocations), {graphX, y + 3 * line});
+    view.text(font, micros(worst.input), {graphX, y + 4 * line});
+}
+
+// All bars are untextured quads in one geometry call
+void PerfOverlay::draw(sdl::Renderer& renderer)
+{
+    if (!_visible) {
+        return;
+    }
+
+    _vertices.clear();
+    _indices.clear();
+
+    auto width = static_cast<float>(historySize);
+    for (int i = 0; i < 4; i++) {
+        addBar(graphX, graphY(i), width, graphHeight, background);
+    }
+
+    addGraph(graphY(0), &PerfSample::frame, frameColor);
+    addGraph(graphY(1), &PerfSample::update, updateColor);
+    addGraph(graphY(2), &PerfSample::render, renderColor);
+
+    // Ticks of each sample, so bursts line up with the frame graph above
+    for (size_t i = 0; i < _count; i++) {
+        if (int ticks = sample(i).ticks; ticks > 1) {
+            float h = std::min(graphHeight, 4.f * ticks);
+            addBar(
+                graphX + static_cast<float>(historySize - _count + i),
+                graphY(0) + graphHeight - h,
+                1,
+                h,
+                lateColor);
+        }
+    }
+
+    auto histogram = std::array<size_t, histogramBuckets>{};
+    for (size_t i = 0; i < _count; i++) {
+        auto bucket = static_cast<size_t>(
+            sample(i).frame * bucketsPerBudget / _budget);
+        histogram[std::min(bucket, histogramBuckets - 1)]++;
+    }
+    auto tallest = std::max<size_t>(*std::ranges::max_element(histogram), 1);
+    float bucketWidth = width / histogramBuckets;
+    for (size_t i = 0; i < histogramBuckets; i++) {
+        float h = graphHeight * histogram[i] / tallest;
+        bool late = i >= bucketsPerBudget;
+        addBar(
+            graphX + bucketWidth * i,
+            graphY(3) + graphHeight - h,
+            bucketWidth - 1,
+            h,
+            late ? lateColor : frameColor);
+    }
+    addBar(
+        graphX + bucketWidth * bucketsPerBudget, graphY(3), 1, graphHeight,
+        budgetLine);
+
+    renderer.drawBlendMode(SDL_BLENDMODE_BLEND);
+    renderer.geometry(_vertices, _indices);
+}
+
+LatencyMeter::LatencyMeter(std::ostream& out)
+    : _out(out)
+{ }
+
+void LatencyMeter::record(Clock::duration latency)
+{
+    _latencies.push_back(latency);
+}
+
+void LatencyMeter::report(Clock::time_point now)
+{
+    if (now - _lastReport < std::chrono::seconds{1}) {
+        return;
+    }
+    _lastReport = now;
+    if (_latencies.empty()) {
+        return;
+    }
+
+    std::ranges::sort(_latencies);
+    auto at = [&] (size_t percent) {
+        return micros(_latencies[(_latencies.size() - 1) * percent / 100]);
+    };
+    _out << "inputs " << _latencies.size() << ", input to present us: " <<
+        "median " << at(50) << ", p99 " << at(99) << ", max " << at(100) <<
+        "\n";
+    _latencies.clear();
+}
+
+const PerfSample& PerfOverlay::sample(size_t index) const
+{
+    return _samples[(_next + historySize - _count + index) % historySize];
+}
+
+void PerfOverlay::addBar(float x, float y, float w, float h, SDL_Color color)
+{
+    int base = static_cast<int>(_vertices.size());
+    _vertices.push_back({{x, y}, color, {}});
+    _vertices.push_back({{x + w, y}, color, {}});
+    _vertices.push_back({{x + w, y + h}, color, {}});
+    _vertices.push_back({{x, y + h}, color, {}});
+    for (int i : {0, 1, 2, 0, 2, 3}) {
+        _indices.push_back(base + i);
+    }
+}
+
+// One bar per sample, newest on the right; samples over budget are red
+void PerfOverlay::addGraph(
+    float y, PerfSample::Duration PerfSample::*member, SDL_Color color)
+{
+    auto range = _budget * graphBudgets;
+    for (size_t i = 0; i < _count; i++) {
+        auto value = std::min(sample(i).*member, range);
+        float h = graphHeight * static_cast<float>(value.count()) /
+            static_cast<float>(range.count());
+        addBar(
+            graphX + static_cast<float>(historySize - _count + i),
+            y + graphHeight - h,
+            1,
+            h,
+            sample(i).*member > _budget ? lateColor : color);
+    }
+    addBar(graphX, y + graphHeight / graphBudgets, historySize, 1, budgetLine);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "resources.hpp"
+#include "view.hpp"
+
+#include "sdl.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Process-wide counters. They are relaxed atomics, so that any thread can
+// bump them for the cost of an uncontended increment; readers may see values
+// that are slightly stale.
+struct PerfCounters {
+    // Calls of the global operator new and operator delete. The game counts
+    // them with replacements of its own, in allocations.cpp; in other
+    // programs that link the core, these stay at zero.
+    std::atomic<uint64_t> allocations = 0;
+    std::atomic<uint64_t> deallocations = 0;
+};
+
+PerfCounters& perfCounters();
+
+// One iteration of the main loop that ran the simulation
+struct PerfSample {
+    using Duration = std::chrono::steady_clock::duration;
+
+    // Since the previous sample
+    Duration frame {};
+    Duration update {};
+    Duration render {};
+    // Simulation ticks run in this iteration. More than one is a burst: the
+    // previous iteration ran late, and the simulation is catching up.
+    int ticks = 0;
+    size_t drawCalls = 0;
+    uint64_t allocations = 0;
+    // Longest time from an input to the present of this frame, which is the
+    // first to show it, or zero without input
+    Duration input {};
+};
+
+// Rolling graphs of the last samples, with a histogram of frame times.
+// Recording only copies the sample into a ring, so it is done whether the
+// overlay is visible or not, and the history is complete when it is shown.
+class PerfOverlay {
+public:
+    static constexpr size_t historySize = 240;
+
+    PerfOverlay(const Resources& resources, int fps);
+
+    void toggle();
+    bool visible() const;
+
+    void record(const PerfSample& sample);
+
+    // Both do nothing while the overlay is hidden. Text goes through the
+    // view's HUD, so it is queued before the view draws; graphs are drawn
+    // over the finished frame, before it is presented.
+    void queueText(View& view) const;
+    void draw(sdl::Renderer& renderer);
+
+private:
+    // Oldest first
+    const PerfSample& sample(size_t index) const;
+    void addBar(float x, float y, float w, float h, SDL_Color color);
+    void addGraph(
+        float y, PerfSample::Duration PerfSample::*member, SDL_Color color);
+
+    const Resources& _resources;
+    PerfSample::Duration _budget;
+    bool _visible = false;
+
+    std::array<PerfSample, historySize> _samples {};
+    size_t _next = 0;
+    size_t _count = 0;
+
+    std::vector<SDL_Vertex> _vertices;
+    std::vector<int> _indices;
+};
+
+// Input-to-present latencies, summed up once per second on a stream: how
+// many inputs reached the screen, and the median, 99th percentile and
+// largest of their latencies. Present returns when the frame is handed to
+// the driver, so a display with vsync shows it up to a refresh later.
+class LatencyMeter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit LatencyMeter(std::ostream& out);
+
+    void record(Clock::duration latency);
+    // Reports when a second has passed since the last report
+    void report(Clock::time_point now);
+
+private:
+    std::ostream& _out;
+    std::vector<Clock::duration> _latencies;
+    Clock::time_point _lastReport = Clock::now();
+};
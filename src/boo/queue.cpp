@@ -0,0 +1,200 @@
+#include "queue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Quads per geometry call. Bounds the vertex buffer, which would otherwise
+// grow to 80 bytes per quad for the whole frame.
+constexpr size_t maxBatchQuads = 16384;
+
+constexpr SDL_Color white {255, 255, 255, 255};
+
+} // namespace
+
+RenderQueueStats& RenderQueueStats::operator+=(const RenderQueueStats& other)
+{
+    commands += other.commands;
+    batches += other.batches;
+    textureSwitches += other.textureSwitches;
+    sortPasses += other.sortPasses;
+    sort += other.sort;
+    submit += other.submit;
+    return *this;
+}
+
+void RenderQueue::push(
+    uint8_t layer,
+    uint64_t depth,
+    sdl::Texture& texture,
+    const SDL_Rect& srcrect,
+    const SDL_FRect& dstrect)
+{
+    auto id = textureId(texture);
+    _entries.push_back(Entry{
+        .key = key(layer, id, depth),
+        .command = static_cast<uint32_t>(_commands.size()),
+    });
+    _commands.push_back(Command{.src = srcrect, .dst = dstrect});
+}
+
+void RenderQueue::submit(sdl::Renderer& renderer)
+{
+    using Clock = std::chrono::steady_clock;
+
+    _stats = RenderQueueStats{};
+    _stats.commands = _entries.size();
+
+    auto start = Clock::now();
+    sort();
+    auto sorted = Clock::now();
+
+    // Vertices are written through a pointer into a buffer sized for the
+    // largest batch; indices are the same for every batch, and only grow
+    _vertices.resize(std::min(_entries.size(), maxBatchQuads) * 4);
+    growIndices(_vertices.size() / 4);
+    _vertexCount = 0;
+    size_t current = _textures.size();
+    float inverseW = 0;
+    float inverseH = 0;
+    for (const auto& entry : _entries) {
+        auto texture = static_cast<uint16_t>((entry.key >> 40) & 0xffff);
+        if (texture != current) {
+            if (current != _textures.size()) {
+                flush(renderer, static_cast<uint16_t>(current));
+            }
+            current = texture;
+            inverseW = 1 / _textures[texture].w;
+            inverseH = 1 / _textures[texture].h;
+            _stats.textureSwitches++;
+        } else if (_vertexCount == maxBatchQuads * 4) {
+            flush(renderer, texture);
+        }
+
+        const auto& [src, dst] = _commands[entry.command];
+        float u0 = static_cast<float>(src.x) * inverseW;
+        float v0 = static_cast<float>(src.y) * inverseH;
+        float u1 = static_cast<float>(src.x + src.w) * inverseW;
+        float v1 = static_cast<float>(src.y + src.h) * inverseH;
+
+        auto* vertex = _vertices.data() + _vertexCount;
+        vertex[0] = {{dst.x, dst.y}, white, {u0, v0}};
+        vertex[1] = {{dst.x + dst.w, dst.y}, white, {u1, v0}};
+        vertex[2] = {{dst.x + dst.w, dst.y + dst.h}, white, {u1, v1}};
+        vertex[3] = {{dst.x, dst.y + dst.h}, white, {u0, v1}};
+        _vertexCount += 4;
+    }
+    if (current != _textures.size()) {
+        flush(renderer, static_cast<uint16_t>(current));
+    }
+    auto finish = Clock::now();
+
+    _stats.sort = sorted - start;
+    _stats.submit = finish - sorted;
+
+    _textures.clear();
+    _commands.clear();
+    _entries.clear();
+}
+
+size_t RenderQueue::size() const
+{
+    return _entries.size();
+}
+
+const RenderQueueStats& RenderQueue::stats() const
+{
+    return _stats;
+}
+
+// A frame uses a handful of textures, and consecutive pushes mostly use the
+// same one, so a linear search from the back is enough
+uint16_t RenderQueue::textureId(sdl::Texture& texture)
+{
+    for (size_t i = _textures.size(); i-- > 0; ) {
+        if (_textures[i].texture == &texture) {
+            return static_cast<uint16_t>(i);
+        }
+    }
+
+    if (_textures.size() == maxTextures) {
+        throw std::runtime_error{"RenderQueue: too many textures in a frame"};
+    }
+    auto size = texture.size();
+    _textures.push_back(TextureInfo{
+        .texture = &texture,
+        .w = static_cast<float>(size.w),
+        .h = static_cast<float>(size.h),
+    });
+    return static_cast<uint16_t>(_textures.size() - 1);
+}
+
+// Least significant digit radix sort on bytes of the key. It is stable, and
+// passes over bytes that are the same for every entry are skipped, which is
+// most of them: layers and textures are few, and depth is often zero. The
+// counts of all bytes are taken in one pass, since the order of entries does
+// not change how many there are of each digit.
+void RenderQueue::sort()
+{
+    static constexpr int digitBits = 8;
+    static constexpr int digits = 64 / digitBits;
+    static constexpr size_t buckets = size_t{1} << digitBits;
+
+    if (_entries.size() < 2) {
+        return;
+    }
+
+    auto counts = std::array<std::array<uint32_t, buckets>, digits>{};
+    for (const auto& entry : _entries) {
+        for (int digit = 0; digit < digits; digit++) {
+            counts[digit][(entry.key >> (digit * digitBits)) & (buckets - 1)]++;
+        }
+    }
+
+    _sortBuffer.resize(_entries.size());
+    for (int digit = 0; digit < digits; digit++) {
+        int shift = digit * digitBits;
+        auto& digitCounts = counts[digit];
+        auto firstDigit = (_entries.front().key >> shift) & (buckets - 1);
+        if (digitCounts[firstDigit] == _entries.size()) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (auto& count : digitCounts) {
+            offset += std::exchange(count, offset);
+        }
+        for (const auto& entry : _entries) {
+            _sortBuffer[digitCounts[(entry.key >> shift) & (buckets - 1)]++] = entry;
+        }
+        std::swap(_entries, _sortBuffer);
+        _stats.sortPasses++;
+    }
+}
+
+void RenderQueue::growIndices(size_t quads)
+{
+    for (size_t quad = _indices.size() / 6; quad < quads; quad++) {
+        int base = static_cast<int>(quad * 4);
+        for (int i : {0, 1, 2, 0, 2, 3}) {
+            _indices.push_back(base + i);
+        }
+    }
+}
+
+void RenderQueue::flush(sdl::Renderer& renderer, uint16_t texture)
+{
+    if (_vertexCount == 0) {
+        return;
+    }
+    renderer.geometry(
+        *_textures[texture].texture,
+        std::span{_vertices}.first(_vertexCount),
+        std::span{_indices}.first(_vertexCount / 4 * 6));
+    _stats.batches++;
+    _vertexCount = 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "sdl.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct RenderQueueStats {
+    using Duration = std::chrono::steady_clock::duration;
+
+    RenderQueueStats& operator+=(const RenderQueueStats& other);
+
+    size_t commands = 0;
+    // Draw calls issued to the renderer
+    size_t batches = 0;
+    size_t textureSwitches = 0;
+    // Radix sort passes that were not skipped
+    size_t sortPasses = 0;
+    Duration sort {};
+    Duration submit {};
+};
+
+// Collects textured quads for a frame, sorts them by a 64-bit key and submits
+// runs with the same texture as single geometry draw calls.
+//
+// The key is, from the most significant bits: layer (8 bits), texture (16
+// bits), depth (40 bits). Textures get their ids in order of first use in the
+// frame, so the sort groups all quads of a texture within a layer. Commands
+// with equal keys keep the order in which they were pushed.
+class RenderQueue {
+public:
+    static constexpr size_t maxTextures = size_t{1} << 16;
+    static constexpr uint64_t maxDepth = (uint64_t{1} << 40) - 1;
+
+    static constexpr uint64_t key(uint8_t layer, uint16_t texture, uint64_t depth)
+    {
+        return uint64_t{layer} << 56 | uint64_t{texture} << 40 |
+            (depth & maxDepth);
+    }
+
+    void push(
+        uint8_t layer,
+        uint64_t depth,
+        sdl::Texture& texture,
+        const SDL_Rect& srcrect,
+        const SDL_FRect& dstrect);
+
+    // Sorts and draws everything pushed since the last submit, and empties
+    // the queue
+    void submit(sdl::Renderer& renderer);
+
+    size_t size() const;
+    const RenderQueueStats& stats() const;
+
+private:
+    struct Command {
+        SDL_Rect src;
+        SDL_FRect dst;
+    };
+
+    struct Entry {
+        uint64_t key;
+        uint32_t command;
+    };
+
+    struct TextureInfo {
+        sdl::Texture* texture;
+        float w;
+        float h;
+    };
+
+    uint16_t textureId(sdl::Texture& texture);
+    void sort();
+    void growIndices(size_t quads);
+    void flush(sdl::Renderer& renderer, uint16_t texture);
+
+    std::vector<TextureInfo> _textures;
+    std::vector<Command> _commands;
+    std::vector<Entry> _entries;
+    std::vector<Entry> _sortBuffer;
+    std::vector<SDL_Vertex> _vertices;
+    size_t _vertexCount = 0;
+    std::vector<int> _indices;
+    RenderQueueStats _stats;
+};
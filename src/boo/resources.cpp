@@ -1,40 +1,475 @@
 #include "resources.hpp"
 
-Resources::Resources(sdl::Renderer& renderer)
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+size_t totalFrames(const fb::Resources* resources)
+{
+    size_t count = 0;
+    for (const auto* sprite : *resources->sprites()) {
+        count += sprite->frames()->size();
+    }
+    return count;
+}
+
+// Level textures are uploaded straight from the data file, so their sizes are
+// checked before anything is read
+void checkLevel(
+    const std::filesystem::path& path,
+    const fb::Resources* resources,
+    size_t levelIndex)
+{
+    const auto* level = resources->levels()->Get(levelIndex);
+    auto fail = [&path, levelIndex] (std::string_view what) {
+        throw std::runtime_error{std::format(
+            "{}: atlas level {}: {}", path.string(), levelIndex + 1, what)};
+    };
+
+    if (level->width() <= 0 || level->height() <= 0) {
+        fail("invalid size");
+    }
+    if (!level->pixels() || level->pixels()->size() !=
+            static_cast<size_t>(level->width()) * level->height() * 4) {
+        fail("pixel data does not match size");
+    }
+    if (!level->frames() || level->frames()->size() != totalFrames(resources)) {
+        fail("frame count does not match sprites");
+    }
+    for (const auto* frame : *level->frames()) {
+        if (frame->x() < 0 || frame->y() < 0 ||
+                frame->x() + frame->w() > level->width() ||
+                frame->y() + frame->h() > level->height()) {
+            fail("frame outside of atlas");
+        }
+    }
+}
+
+void checkFont(const std::filesystem::path& path, const fb::Font* font)
+{
+    auto name = std::string_view{font->name()->c_str(), font->name()->size()};
+    auto fail = [&path, name] (std::string_view what) {
+        throw std::runtime_error{std::format(
+            "{}: font '{}': {}", path.string(), name, what)};
+    };
+
+    if (font->width() <= 0 || font->height() <= 0) {
+        fail("invalid size");
+    }
+    if (!font->pixels() || font->pixels()->size() !=
+            static_cast<size_t>(font->width()) * font->height() * 4) {
+        fail("pixel data does not match size");
+    }
+    if (!font->glyphs()) {
+        fail("no glyphs");
+    }
+    for (const auto* glyph : *font->glyphs()) {
+        if (glyph->codepoint() >= Font::glyphCount) {
+            fail("glyph outside of ASCII");
+        }
+        if (glyph->x() < 0 || glyph->y() < 0 ||
+                glyph->x() + glyph->w() > font->width() ||
+                glyph->y() + glyph->h() > font->height()) {
+            fail("glyph outside of atlas");
+        }
+    }
+}
+
+const fb::Resources* parseResources(
+    const std::filesystem::path& path, const MemoryMap& mmap)
+{
+    auto verifier = flatbuffers::Verifier{
+        static_cast<const uint8_t*>(mmap.addr()), mmap.size()};
+    if (!fb::VerifyResourcesBuffer(verifier)) {
+        throw std::runtime_error{std::format(
+            "{}: invalid data file", path.string())};
+    }
+    const auto* resources = fb::GetResources(mmap.addr());
+
+    // Sprite ids in r.hpp are generated together with the data file. Check
+    // once at load that they agree, so that lookups by id need no checks.
+    if (resources->sprites()->size() != r::spriteCount) {
+        throw std::runtime_error{std::format(
+            "{}: expected {} sprites, found {}",
+            path.string(), r::spriteCount, resources->sprites()->size())};
+    }
+    for (size_t i = 0; i < r::spriteCount; i++) {
+        auto name = std::string_view{
+            resources->sprites()->Get(i)->name()->c_str(),
+            resources->sprites()->Get(i)->name()->size()};
+        if (name != r::spriteNames[i]) {
+            throw std::runtime_error{std::format(
+                "{}: sprite {} is '{}', expected '{}'",
+                path.string(), i, name, r::spriteNames[i])};
+        }
+    }
+
+    // A pack without sounds has no sounds vector at all
+    size_t soundCount = resources->sounds() ? resources->sounds()->size() : 0;
+    if (soundCount != r::soundCount) {
+        throw std::runtime_error{std::format(
+            "{}: expected {} sounds, found {}",
+            path.string(), r::soundCount, soundCount)};
+    }
+    for (size_t i = 0; i < r::soundCount; i++) {
+        const auto* sound = resources->sounds()->Get(i);
+        auto name = std::string_view{sound->name()->c_str(), sound->name()->size()};
+        if (name != r::soundNames[i]) {
+            throw std::runtime_error{std::format(
+                "{}: sound {} is '{}', expected '{}'",
+                path.string(), i, name, r::soundNames[i])};
+        }
+        if (!sound->samples() || sound->samples()->size() % 2 != 0) {
+            throw std::runtime_error{std::format(
+                "{}: sound '{}' is not stereo", path.string(), name)};
+        }
+    }
+
+    size_t fontCount = resources->fonts() ? resources->fonts()->size() : 0;
+    if (fontCount != r::fontCount) {
+        throw std::runtime_error{std::format(
+            "{}: expected {} fonts, found {}",
+            path.string(), r::fontCount, fontCount)};
+    }
+    for (size_t i = 0; i < r::fontCount; i++) {
+        const auto* font = resources->fonts()->Get(i);
+        auto name = std::string_view{font->name()->c_str(), font->name()->size()};
+        if (name != r::fontNames[i]) {
+            throw std::runtime_error{std::format(
+                "{}: font {} is '{}', expected '{}'",
+                path.string(), i, name, r::fontNames[i])};
+        }
+        checkFont(path, font);
+    }
+
+    if (resources->levels()) {
+        for (size_t i = 0; i < resources->levels()->size(); i++) {
+            checkLevel(path, resources, i);
+        }
+    }
+
+    return resources;
+}
+
+sdl::Surface decodeSheet(const fb::Resources* resources)
+{
+    auto surface = img::load({
+        reinterpret_cast<const std::byte*>(resources->spritesheet()->data()),
+        resources->spritesheet()->size()});
+    return surface.convert(SDL_PIXELFORMAT_ARGB8888);
+}
+
+bool regionsEqual(
+    const sdl::Surface& lhs, const sdl::Surface& rhs, const SDL_Rect& rect)
+{
+    auto rowBytes = static_cast<size_t>(rect.w) * 4;
+    for (int y = rect.y; y < rect.y + rect.h; y++) {
+        if (std::memcmp(
+                lhs.pixels(rect.x, y), rhs.pixels(rect.x, y), rowBytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool insideSheet(const sdl::Surface& sheet, const SDL_Rect& rect)
+{
+    return rect.x >= 0 && rect.y >= 0 && rect.w >= 0 && rect.h >= 0 &&
+        rect.x + rect.w <= sheet.w() && rect.y + rect.h <= sheet.h();
+}
+
+} // namespace
+
+Resources::Resources(sdl::Renderer& renderer, JobSystem* jobs)
     : _renderer(&renderer)
+    , _jobs(jobs)
 { }
 
 void Resources::load(const std::filesystem::path& path)
 {
-    _mmap.map(path);
-    _resources = fb::GetResources(_mmap.addr());
+    auto mmap = MemoryMap{path};
+    const auto* resources = parseResources(path, mmap);
 
-    _texture = _renderer->loadTexture(
-        _resources->spritesheet()->data(),
-        _resources->spritesheet()->size());
+    auto sheet = sdl::Surface{};
+    auto sprites = std::vector<Sprite>{};
+    auto levels = std::vector<AtlasLevel>{};
+    auto fonts = std::vector<FontAtlas>{};
+    decodeAlongside(
+        [&] {
+            sheet = decodeSheet(resources);
+        },
+        [&] {
+            sprites = createSprites(resources);
+            levels = createLevels(resources);
+            fonts = createFonts(resources);
+        });
+    auto texture = createTexture(sheet);
 
-    _sprites.reserve(_resources->sprites()->size());
-    for (const auto* fbSprite : *_resources->sprites()) {
-        _sprites.push_back(Sprite{
+    _mmap = std::move(mmap);
+    _resources = resources;
+    _sheet = std::move(sheet);
+    _texture = std::move(texture);
+    _sprites = std::move(sprites);
+    _levels = std::move(levels);
+    _fonts = std::move(fonts);
+    _version++;
+}
+
+void Resources::reload(const std::filesystem::path& path)
+{
+    if (!_texture.ptr()) {
+        load(path);
+        return;
+    }
+
+    // The new file is mapped separately, and everything is prepared before
+    // the current state is touched
+    auto mmap = MemoryMap{path};
+    const auto* resources = parseResources(path, mmap);
+
+    // Downscaled levels and fonts are small, and are uploaded whole
+    auto sheet = sdl::Surface{};
+    auto sprites = std::vector<Sprite>{};
+    auto levels = std::vector<AtlasLevel>{};
+    auto fonts = std::vector<FontAtlas>{};
+    decodeAlongside(
+        [&] {
+            sheet = decodeSheet(resources);
+        },
+        [&] {
+            sprites = createSprites(resources);
+            levels = createLevels(resources);
+            fonts = createFonts(resources);
+        });
+
+    for (const auto& sprite : sprites) {
+        for (const auto& frame : sprite.frames) {
+            if (!insideSheet(sheet, frame.rect)) {
+                throw std::runtime_error{std::format(
+                    "{}: sprite frame {}x{} at ({}, {}) is outside of the sheet",
+                    path.string(), frame.rect.w, frame.rect.h,
+                    frame.rect.x, frame.rect.y)};
+            }
+        }
+    }
+
+    if (sheet.w() != _sheet.w() || sheet.h() != _sheet.h()) {
+        _texture = createTexture(sheet);
+    } else {
+        auto changed = std::vector<SDL_Rect>{};
+        for (const auto& sprite : sprites) {
+            for (const auto& frame : sprite.frames) {
+                const auto& rect = frame.rect;
+                bool seen = std::ranges::any_of(
+                    changed, [&rect] (const SDL_Rect& other) {
+                        return rect.x == other.x && rect.y == other.y &&
+                            rect.w == other.w && rect.h == other.h;
+                    });
+                if (!seen && !regionsEqual(sheet, _sheet, rect)) {
+                    changed.push_back(rect);
+                }
+            }
+        }
+
+        // An upload that fails puts back the regions already replaced, so
+        // the texture never mixes the two sheets. If even that fails, the
+        // old sheet is uploaded into a new texture.
+        size_t uploaded = 0;
+        try {
+            for (; uploaded < changed.size(); uploaded++) {
+                const auto& rect = changed[uploaded];
+                _texture.update(
+                    &rect, sheet.pixels(rect.x, rect.y), sheet.pitch());
+            }
+        } catch (...) {
+            try {
+                for (size_t i = 0; i < uploaded; i++) {
+                    const auto& rect = changed[i];
+                    _texture.update(
+                        &rect, _sheet.pixels(rect.x, rect.y), _sheet.pitch());
+                }
+            } catch (...) {
+                _texture = createTexture(_sheet);
+            }
+            throw;
+        }
+    }
+
+    _mmap = std::move(mmap);
+    _resources = resources;
+    _sheet = std::move(sheet);
+    _sprites = std::move(sprites);
+    _levels = std::move(levels);
+    _fonts = std::move(fonts);
+    _version++;
+}
+
+void Resources::clear()
+{
+}
+
+const Sprite& Resources::operator[](r::Sprite spriteId) const
+{
+    return _sprites[static_cast<size_t>(spriteId)];
+}
+
+const std::vector<Sprite>& Resources::sprites() const
+{
+    return _sprites;
+}
+
+size_t Resources::levelCount() const
+{
+    return _levels.size() + 1;
+}
+
+const Sprite& Resources::sprite(r::Sprite spriteId, size_t level) const
+{
+    if (level == 0) {
+        return (*this)[spriteId];
+    }
+    return _levels[level - 1].sprites[static_cast<size_t>(spriteId)];
+}
+
+std::span<const float> Resources::sound(r::Sound soundId) const
+{
+    const auto* samples =
+        _resources->sounds()->Get(static_cast<size_t>(soundId))->samples();
+    return {samples->data(), samples->size()};
+}
+
+const Font& Resources::font(r::Font fontId) const
+{
+    return _fonts[static_cast<size_t>(fontId)].font;
+}
+
+uint64_t Resources::version() const
+{
+    return _version;
+}
+
+template <class F, class G>
+void Resources::decodeAlongside(F&& decode, G&& create)
+{
+    if (_jobs) {
+        _jobs->invokeBoth(decode, create);
+    } else {
+        decode();
+        create();
+    }
+}
+
+std::vector<Sprite> Resources::createSprites(const fb::Resources* resources)
+{
+    auto sprites = std::vector<Sprite>{};
+    sprites.reserve(resources->sprites()->size());
+    for (const auto* fbSprite : *resources->sprites()) {
+        sprites.push_back(Sprite{
             .texture = &_texture,
             .frames = {},
         });
 
         for (const auto* fbFrame : *fbSprite->frames()) {
-            _sprites.back().frames.push_back(Frame{
+            sprites.back().frames.push_back(Frame{
                 .rect = SDL_Rect{fbFrame->x(), fbFrame->y(), fbFrame->w(), fbFrame->h()},
                 .duration = fbFrame->duration(),
             });
         }
     }
+    return sprites;
 }
 
-void Resources::clear()
+sdl::Texture Resources::createTexture(const sdl::Surface& sheet)
 {
+    auto texture = _renderer->createTexture(
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STATIC,
+        sheet.w(),
+        sheet.h());
+    texture.update(nullptr, sheet.pixels(), sheet.pitch());
+    texture.blendMode(SDL_BLENDMODE_BLEND);
+    return texture;
 }
 
-const Sprite& Resources::operator[](r::Sprite spriteId) const
+// Sprites point at the textures inside the returned vector. The vector is
+// filled without reallocation, and moving it keeps the elements in place.
+std::vector<Resources::AtlasLevel> Resources::createLevels(
+    const fb::Resources* resources)
 {
-    auto spriteIndex = (flatbuffers::uoffset_t)spriteId;
-    return _sprites.at(spriteIndex);
+    auto levels = std::vector<AtlasLevel>{};
+    if (!resources->levels()) {
+        return levels;
+    }
+
+    levels.reserve(resources->levels()->size());
+    for (const auto* fbLevel : *resources->levels()) {
+        auto& level = levels.emplace_back();
+        level.texture = _renderer->createTexture(
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STATIC,
+            fbLevel->width(),
+            fbLevel->height());
+        level.texture.update(
+            nullptr, fbLevel->pixels()->data(), fbLevel->width() * 4);
+        level.texture.blendMode(SDL_BLENDMODE_BLEND);
+
+        size_t frameIndex = 0;
+        for (const auto* fbSprite : *resources->sprites()) {
+            auto& sprite = level.sprites.emplace_back(Sprite{
+                .texture = &level.texture,
+                .frames = {},
+            });
+            for (size_t i = 0; i < fbSprite->frames()->size(); i++) {
+                const auto* fbFrame = fbLevel->frames()->Get(frameIndex++);
+                sprite.frames.push_back(Frame{
+                    .rect = SDL_Rect{
+                        fbFrame->x(), fbFrame->y(), fbFrame->w(), fbFrame->h()},
+                    .duration = fbFrame->duration(),
+                });
+            }
+        }
+    }
+    return levels;
 }
+
+// Like levels, fonts point at textures inside the returned vector
+std::vector<Resources::FontAtlas> Resources::createFonts(
+    const fb::Resources* resources)
+{
+    auto fonts = std::vector<FontAtlas>{};
+    if (!resources->fonts()) {
+        return fonts;
+    }
+
+    fonts.reserve(resources->fonts()->size());
+    for (const auto* fbFont : *resources->fonts()) {
+        auto& atlas = fonts.emplace_back();
+        atlas.texture = _renderer->createTexture(
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STATIC,
+            fbFont->width(),
+            fbFont->height());
+        atlas.texture.update(
+            nullptr, fbFont->pixels()->data(), fbFont->width() * 4);
+        atlas.texture.blendMode(SDL_BLENDMODE_BLEND);
+
+        atlas.font.texture = &atlas.texture;
+        atlas.font.lineHeight = fbFont->line_height();
+        for (const auto* fbGlyph : *fbFont->glyphs()) {
+            atlas.font.glyphs[fbGlyph->codepoint()] = Glyph{
+                .rect = SDL_Rect{
+                    fbGlyph->x(), fbGlyph->y(), fbGlyph->w(), fbGlyph->h()},
+                .left = fbGlyph->left(),
+                .top = fbGlyph->top(),
+                .advance = fbGlyph->advance(),
+            };
+        }
+    }
+    return fonts;
+}
\ No newline at end of file
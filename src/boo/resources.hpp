@@ -6,9 +6,14 @@
 #include "r.hpp"
 #include "schema_generated.h"
 
+#include <array>
+#include <cstdint>
 #include <filesystem>
+#include <span>
 #include <vector>
 
+class JobSystem;
+
 // Ideally, one should use the flatbuffers directly. However, for rendering it
 // is required to convert the data to SDL structures anyway (such as SDL_Rect),
 // so everything is converted at load, and just stored in memory.
@@ -23,19 +28,92 @@ struct Sprite {
     std::vector<Frame> frames;
 };
 
+struct Glyph {
+    // Zero size for glyphs that only advance the pen
+    SDL_Rect rect {};
+    // Position of the rectangle relative to the pen at the top of the line
+    int left = 0;
+    int top = 0;
+    int advance = 0;
+};
+
+// Pre-rendered glyphs of printable ASCII, indexed by character. Characters
+// that the font does not have are left empty.
+struct Font {
+    static constexpr size_t glyphCount = 128;
+
+    sdl::Texture* texture = nullptr;
+    int lineHeight = 0;
+    std::array<Glyph, glyphCount> glyphs {};
+};
+
 class Resources {
 public:
-    explicit Resources(sdl::Renderer& renderer);
+    // With jobs, the spritesheet is decoded on a worker while the other
+    // textures are created. Textures are always created on the calling
+    // thread, since the renderer is not thread-safe.
+    explicit Resources(sdl::Renderer& renderer, JobSystem* jobs = nullptr);
+
+    Resources(const Resources&) = delete;
+    Resources& operator=(const Resources&) = delete;
 
     void load(const std::filesystem::path& path);
+
+    // Loads a new version of the data file, for use between frames while the
+    // game is running. Only the spritesheet regions that changed are uploaded
+    // to the texture. If the new file cannot be loaded, an exception is thrown
+    // and the resources stay as they were.
+    void reload(const std::filesystem::path& path);
+
     void clear();
 
     const Sprite& operator[](r::Sprite spriteId) const;
+    // All sprites, indexed by r::Sprite
+    const std::vector<Sprite>& sprites() const;
+
+    // Atlas levels, including the full-size one. Level n is downscaled by
+    // 1/2^n, and holds the same sprites with the same frame durations.
+    size_t levelCount() const;
+    const Sprite& sprite(r::Sprite spriteId, size_t level) const;
+
+    // Interleaved stereo samples at Mixer::frequency. The samples point into
+    // the data file, and are only valid until the next load or reload.
+    std::span<const float> sound(r::Sound soundId) const;
+
+    const Font& font(r::Font fontId) const;
+
+    // Incremented whenever textures or sprites change, so that anything
+    // rendered from them can be invalidated
+    uint64_t version() const;
 
 private:
+    struct AtlasLevel {
+        sdl::Texture texture;
+        std::vector<Sprite> sprites;
+    };
+
+    struct FontAtlas {
+        sdl::Texture texture;
+        Font font;
+    };
+
+    // Runs decode on a worker if there are jobs, and create on this thread
+    template <class F, class G>
+    void decodeAlongside(F&& decode, G&& create);
+
+    std::vector<Sprite> createSprites(const fb::Resources* resources);
+    sdl::Texture createTexture(const sdl::Surface& sheet);
+    std::vector<AtlasLevel> createLevels(const fb::Resources* resources);
+    std::vector<FontAtlas> createFonts(const fb::Resources* resources);
+
     sdl::Renderer* _renderer = nullptr;
+    JobSystem* _jobs = nullptr;
     MemoryMap _mmap;
     const fb::Resources* _resources = nullptr;
+    sdl::Surface _sheet;
     sdl::Texture _texture;
     std::vector<Sprite> _sprites;
+    std::vector<AtlasLevel> _levels;
+    std::vector<FontAtlas> _fonts;
+    uint64_t _version = 0;
 };
\ No newline at end of file
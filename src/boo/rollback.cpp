@@ -0,0 +1,248 @@
+#include "rollback.hpp"
+
+#include <algorithm>
+#include <concepts>
+#include <format>
+#include <stdexcept>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Packet layout, little-endian:
+//   uint16 magic, uint8 player, uint8 input count,
+//   uint32 first tick, uint32 acknowledged tick, uint16 inputs[count]
+constexpr uint16_t packetMagic = 0xb007;
+constexpr size_t headerSize = 12;
+
+// The input that both pads start with, in the middle of their ranges
+constexpr uint16_t centerInput = 0x8000;
+
+template <std::unsigned_integral U>
+void put(std::byte*& data, U value)
+{
+    for (size_t i = 0; i < sizeof(U); i++) {
+        *data++ = static_cast<std::byte>(value >> (8 * i));
+    }
+}
+
+template <std::unsigned_integral U>
+U get(const std::byte*& data)
+{
+    U value = 0;
+    for (size_t i = 0; i < sizeof(U); i++) {
+        value |= static_cast<U>(std::to_integer<U>(*data++) << (8 * i));
+    }
+    return value;
+}
+
+} // namespace
+
+template <Scalar T>
+BasicRollbackSession<T>::BasicRollbackSession(
+        BasicWorld<T>& world, size_t localPlayer, Link& link, T tickDelta)
+    : _world(world)
+    , _localPlayer(localPlayer)
+    , _remotePlayer(1 - localPlayer)
+    , _link(link)
+    , _tickDelta(tickDelta)
+{
+    if (world.players() != maxPlayers || localPlayer >= maxPlayers) {
+        throw std::runtime_error{std::format(
+            "rollback needs a {}-player world, got {} players and local "
+            "player {}",
+            maxPlayers, world.players(), localPlayer)};
+    }
+
+    for (auto& inputs : _inputs) {
+        inputs.pads.fill(centerInput);
+    }
+}
+
+template <Scalar T>
+void BasicRollbackSession<T>::poll()
+{
+    auto buffer = std::array<std::byte, UdpSocket::maxPacketSize>{};
+    uint32_t mispredictedTick = _tick;
+    while (auto size = _link.receive(buffer)) {
+        mispredictedTick = std::min(
+            mispredictedTick, receive(std::span{buffer}.first(*size)));
+    }
+
+    if (mispredictedTick < _tick) {
+        rollback(mispredictedTick);
+    }
+}
+
+template <Scalar T>
+bool BasicRollbackSession<T>::advance(uint16_t localInput)
+{
+    if (_tick - std::min(_tick, _confirmedTick) >= maxRollback ||
+            _tick - _acknowledgedTick >= maxInputsPerPacket) {
+        _stats.stalls++;
+        sendInputs();
+        return false;
+    }
+
+    auto& inputs = _inputs[slot(_tick)];
+    inputs.pads[_localPlayer] = localInput;
+    if (_tick >= _confirmedTick && _confirmedTick > 0) {
+        inputs.pads[_remotePlayer] =
+            _inputs[slot(_confirmedTick - 1)].pads[_remotePlayer];
+    }
+
+    _snapshots[slot(_tick)] = _world.snapshot();
+    simulate(_tick);
+    _tick++;
+    _stats.ticks++;
+
+    sendInputs();
+    return true;
+}
+
+// An input converted to Fixed as a whole number would not fit in Q16.16
+template <Scalar T>
+T BasicRollbackSession<T>::padPosition(uint16_t input)
+{
+    if constexpr (std::same_as<T, Fixed>) {
+        return Fixed::fromRaw(input);
+    } else {
+        return static_cast<T>(input) / 65536;
+    }
+}
+
+template <Scalar T>
+uint32_t BasicRollbackSession<T>::tick() const
+{
+    return _tick;
+}
+
+template <Scalar T>
+uint32_t BasicRollbackSession<T>::confirmedTick() const
+{
+    return _confirmedTick;
+}
+
+template <Scalar T>
+uint32_t BasicRollbackSession<T>::acknowledgedTick() const
+{
+    return _acknowledgedTick;
+}
+
+template <Scalar T>
+const RollbackStats& BasicRollbackSession<T>::stats() const
+{
+    return _stats;
+}
+
+template <Scalar T>
+void BasicRollbackSession<T>::sendInputs()
+{
+    auto buffer = std::array<std::byte, UdpSocket::maxPacketSize>{};
+    uint32_t count = _tick - _acknowledgedTick;
+
+    auto* data = buffer.data();
+    put(data, packetMagic);
+    put(data, static_cast<uint8_t>(_localPlayer));
+    put(data, static_cast<uint8_t>(count));
+    put(data, _acknowledgedTick);
+    put(data, _confirmedTick);
+    for (uint32_t tick = _acknowledgedTick; tick < _tick; tick++) {
+        put(data, _inputs[slot(tick)].pads[_localPlayer]);
+    }
+
+    _link.send(std::span{buffer}.first(data - buffer.data()));
+    _stats.packetsSent++;
+}
+
+template <Scalar T>
+uint32_t BasicRollbackSession<T>::receive(std::span<const std::byte> packet)
+{
+    const auto* data = packet.data();
+    if (packet.size() < headerSize || get<uint16_t>(data) != packetMagic) {
+        _stats.packetsRejected++;
+        return _tick;
+    }
+
+    auto player = get<uint8_t>(data);
+    auto count = get<uint8_t>(data);
+    auto firstTick = get<uint32_t>(data);
+    auto acknowledgedTick = get<uint32_t>(data);
+    if (player != _remotePlayer || count > maxInputsPerPacket ||
+            packet.size() != headerSize + count * sizeof(uint16_t)) {
+        _stats.packetsRejected++;
+        return _tick;
+    }
+    _stats.packetsReceived++;
+
+    // Packets can arrive out of order, so older acknowledgements are ignored
+    _acknowledgedTick = std::clamp(acknowledgedTick, _acknowledgedTick, _tick);
+
+    uint32_t mispredictedTick = _tick;
+    for (uint32_t tick = firstTick; tick < firstTick + count; tick++) {
+        auto input = get<uint16_t>(data);
+        // Inputs are sent from the last acknowledged one, so a packet never
+        // skips over inputs that have not been received yet
+        if (tick != _confirmedTick) {
+            continue;
+        }
+
+        auto& pad = _inputs[slot(tick)].pads[_remotePlayer];
+        if (tick < _tick && pad != input) {
+            mispredictedTick = std::min(mispredictedTick, tick);
+        }
+        pad = input;
+        _confirmedTick++;
+    }
+    return mispredictedTick;
+}
+
+template <Scalar T>
+void BasicRollbackSession<T>::rollback(uint32_t fromTick)
+{
+    auto start = Clock::now();
+
+    _world.restore(_snapshots[slot(fromTick)]);
+    auto prediction = _inputs[slot(_confirmedTick - 1)].pads[_remotePlayer];
+    for (uint32_t tick = fromTick; tick < _tick; tick++) {
+        if (tick >= _confirmedTick) {
+            _inputs[slot(tick)].pads[_remotePlayer] = prediction;
+        }
+        if (tick > fromTick) {
+            _snapshots[slot(tick)] = _world.snapshot();
+        }
+        simulate(tick);
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start);
+    size_t depth = std::min<size_t>(_tick - fromTick, maxRollback);
+    _stats.rollbacks++;
+    _stats.resimulatedTicks += _tick - fromTick;
+    _stats.rollbacksByDepth[depth]++;
+    _stats.resimulationByDepth[depth] += elapsed;
+    _stats.maxResimulation = std::max(_stats.maxResimulation, elapsed);
+    if (elapsed > tickBudget) {
+        _stats.budgetOverruns++;
+        _stats.overrunsByDepth[depth]++;
+    }
+}
+
+template <Scalar T>
+void BasicRollbackSession<T>::simulate(uint32_t tick)
+{
+    const auto& inputs = _inputs[slot(tick)];
+    for (size_t player = 0; player < maxPlayers; player++) {
+        _world.setPadPosition(player, padPosition(inputs.pads[player]));
+    }
+    _world.update(_tickDelta);
+}
+
+template <Scalar T>
+size_t BasicRollbackSession<T>::slot(uint32_t tick)
+{
+    return tick & (historySize - 1);
+}
+
+template class BasicRollbackSession<float>;
+template class BasicRollbackSession<Fixed>;
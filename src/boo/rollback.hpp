@@ -0,0 +1,121 @@
+#pragma once
+
+#include "net.hpp"
+#include "world.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+struct RollbackStats {
+    static constexpr size_t maxDepth = 16;
+
+    uint64_t ticks = 0;
+    // Ticks that could not run because the remote player was too far behind
+    uint64_t stalls = 0;
+    uint64_t rollbacks = 0;
+    uint64_t resimulatedTicks = 0;
+    // Rollbacks that took longer than the tick budget
+    uint64_t budgetOverruns = 0;
+    std::chrono::nanoseconds maxResimulation{};
+    // Indexed by the number of resimulated ticks
+    std::array<uint64_t, maxDepth + 1> rollbacksByDepth{};
+    std::array<std::chrono::nanoseconds, maxDepth + 1> resimulationByDepth{};
+    std::array<uint64_t, maxDepth + 1> overrunsByDepth{};
+    uint64_t packetsSent = 0;
+    uint64_t packetsReceived = 0;
+    uint64_t packetsRejected = 0;
+};
+
+// Two-player rollback over a Link. Every tick runs at once with the local
+// input and a prediction of the remote one: the last remote input received.
+// When the real remote input for a past tick turns out to be different, the
+// world is restored to the snapshot of that tick, and the ticks since are
+// simulated again.
+//
+// Each packet carries all local inputs that the peer has not acknowledged
+// yet, so a lost packet is covered by the next one without retransmission.
+// Inputs are pad positions, quantized to 16 bits.
+//
+// Both peers must start from the same level, and the world must be a
+// FixedWorld for the simulations to agree on different builds.
+template <Scalar T>
+class BasicRollbackSession {
+public:
+    static constexpr size_t maxRollback = RollbackStats::maxDepth;
+    static constexpr size_t maxInputsPerPacket = 64;
+    static constexpr auto tickBudget = std::chrono::microseconds{4000};
+
+    BasicRollbackSession(
+        BasicWorld<T>& world, size_t localPlayer, Link& link, T tickDelta);
+
+    // Pad position of an input, input / 65536, which Fixed holds exactly
+    static T padPosition(uint16_t input);
+
+    // Receives inputs from the peer, and rolls back if any prediction was
+    // wrong
+    void poll();
+
+    // Runs one tick with the local input, and sends the unacknowledged
+    // inputs. Returns false without running the tick when it would go more
+    // than maxRollback ticks ahead of the remote inputs, or when the peer
+    // has not acknowledged enough inputs to fit the rest in a packet.
+    bool advance(uint16_t localInput);
+
+    // Sends the inputs that the peer has not acknowledged. advance() does it
+    // every tick; this is for keeping the peer up to date when not advancing.
+    void sendInputs();
+
+    // Number of ticks simulated
+    uint32_t tick() const;
+    // Number of ticks for which the remote input is known
+    uint32_t confirmedTick() const;
+    // Number of local inputs the peer acknowledged
+    uint32_t acknowledgedTick() const;
+
+    const RollbackStats& stats() const;
+
+private:
+    // Power of two above the longest span of inputs that is kept
+    static constexpr size_t historySize = 128;
+
+    static_assert(historySize > maxInputsPerPacket + maxRollback);
+
+    struct TickInputs {
+        std::array<uint16_t, maxPlayers> pads{};
+    };
+
+    // Returns the first tick that ran with a wrong prediction, or the
+    // current tick if there was none
+    uint32_t receive(std::span<const std::byte> packet);
+    void rollback(uint32_t fromTick);
+    void simulate(uint32_t tick);
+
+    static size_t slot(uint32_t tick);
+
+    BasicWorld<T>& _world;
+    size_t _localPlayer = 0;
+    size_t _remotePlayer = 1;
+    Link& _link;
+    T _tickDelta;
+
+    uint32_t _tick = 0;
+    uint32_t _confirmedTick = 0;
+    uint32_t _acknowledgedTick = 0;
+
+    // Inputs used for each tick; remote inputs past _confirmedTick are
+    // predictions
+    std::array<TickInputs, historySize> _inputs;
+    // State at the start of each tick
+    std::array<BasicWorldSnapshot<T>, historySize> _snapshots;
+
+    RollbackStats _stats;
+};
+
+extern template class BasicRollbackSession<float>;
+extern template class BasicRollbackSession<Fixed>;
+
+using RollbackSession = BasicRollbackSession<float>;
+using FixedRollbackSession = BasicRollbackSession<Fixed>;
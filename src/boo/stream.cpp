@@ -0,0 +1,493 @@
+#include "stream.hpp"
+
+#include "chunks_generated.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace {
+
+// Distance between two rectangles, zero when they overlap
+float distance(const Rectangle& a, const Rectangle& b)
+{
+    float dx = std::max({a.xmin() - b.xmax(), b.xmin() - a.xmax(), 0.f});
+    float dy = std::max({a.ymin() - b.ymax(), b.ymin() - a.ymax(), 0.f});
+    return std::max(dx, dy);
+}
+
+// Chunks from the one that holds from up to the one that holds to, clamped
+// to the level
+std::pair<uint32_t, uint32_t> chunkRange(
+    float from, float to, float origin, float size, uint32_t chunks)
+{
+    auto chunk = [&] (float value) {
+        float position = std::clamp<float>(
+            (value - origin) / size, 0, static_cast<float>(chunks - 1));
+        return static_cast<uint32_t>(position);
+    };
+    return {chunk(from), chunk(to)};
+}
+
+} // namespace
+
+LevelStream::LevelStream(
+        const std::filesystem::path& path, const StreamOptions& options)
+    : _mmap(path, MapOptions{.random = true})
+    , _prefetchDistance(options.prefetchDistance)
+{
+    // Verifying only checks the sizes of the arrays, so nothing is read
+    // from the bricks, and chunk bounds are checked when chunks are loaded
+    const auto* data = static_cast<const uint8_t*>(_mmap.addr());
+    auto verifier = flatbuffers::Verifier{data, _mmap.size()};
+    if (!flatbuffers::BufferHasIdentifier(
+                data, fb::ChunkedLevelIdentifier()) ||
+            !fb::VerifyChunkedLevelBuffer(verifier)) {
+        throw std::runtime_error{std::format(
+            "{}: invalid chunked level file", path.string())};
+    }
+    const auto* level = fb::GetChunkedLevel(data);
+    auto fail = [&path] (std::string_view what) {
+        throw std::runtime_error{std::format(
+            "{}: {}", path.string(), what)};
+    };
+
+    if (!level->field() || !level->bricks() || !level->chunk_starts() ||
+            !level->cell_starts()) {
+        fail("missing field or bricks");
+    }
+    _layout = ChunkLayout{
+        .origin = {level->chunk_x(), level->chunk_y()},
+        .size = level->chunk_size(),
+        .columns = level->columns(),
+        .rows = level->rows(),
+        .margin = level->margin(),
+    };
+    _chunkCells = level->chunk_cells();
+    size_t chunks = size_t{_layout.columns} * _layout.rows;
+    if (!(_layout.size > 0) || chunks == 0 || _chunkCells == 0 ||
+            _chunkCells > 256) {
+        fail("invalid chunk layout");
+    }
+
+    _fileBricks = std::span{
+        reinterpret_cast<const Rectangle*>(level->bricks()->Data()),
+        level->bricks()->size()};
+    _chunkStarts = std::span{
+        level->chunk_starts()->data(), level->chunk_starts()->size()};
+    _cellStarts = std::span{
+        level->cell_starts()->data(), level->cell_starts()->size()};
+    if (_chunkStarts.size() != chunks + 1 ||
+            _chunkStarts.back() != _fileBricks.size() ||
+            _cellStarts.size() != chunks * cellStartsPerChunk()) {
+        fail("chunks do not match bricks");
+    }
+
+    const auto* field = level->field();
+    _field = Rectangle{
+        {field->xmin() + (field->xmax() - field->xmin()) / 2,
+            field->ymin() + (field->ymax() - field->ymin()) / 2},
+        field->xmax() - field->xmin(),
+        field->ymax() - field->ymin()};
+    if (level->name()) {
+        _name = level->name()->string_view();
+    }
+
+    // Slots and load buffers are all allocated here, as large as the
+    // largest chunk, so the cap holds whatever chunks are loaded. Slots
+    // beyond one per chunk with bricks would never be used.
+    size_t filledChunks = 0;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        if (_chunkStarts[chunk + 1] != _chunkStarts[chunk]) {
+            filledChunks++;
+        }
+    }
+    _slotBricks = std::max<size_t>(level->max_chunk_bricks(), 1);
+    size_t slotBytes = _slotBricks * sizeof(Rectangle) +
+        cellStartsPerChunk() * sizeof(uint32_t) + sizeof(Slot);
+    size_t neededSlots = std::min(minSlots, std::max<size_t>(filledChunks, 1));
+    size_t slotCount = options.memoryCap / slotBytes;
+    if (slotCount < neededSlots + stagingBuffers) {
+        throw std::runtime_error{std::format(
+            "{}: chunks of up to {} bricks need at least {} bytes",
+            path.string(), _slotBricks,
+            (neededSlots + stagingBuffers) * slotBytes)};
+    }
+    slotCount = std::min(
+        slotCount - stagingBuffers, std::max<size_t>(filledChunks, 1));
+
+    _bricks.resize(slotCount * _slotBricks);
+    _slotCellStarts.resize(slotCount * cellStartsPerChunk());
+    _slots.resize(slotCount);
+    _chunkSlots.assign(chunks, noChunk);
+    _chunkWanted.assign(chunks, neverWanted);
+    for (size_t slot = slotCount; slot > 0; slot--) {
+        _freeSlots.push_back(static_cast<uint32_t>(slot - 1));
+    }
+    _candidates.reserve(slotCount * 4);
+    _wanted.reserve(slotCount);
+    _staging.resize(stagingBuffers);
+    for (size_t i = 0; i < stagingBuffers; i++) {
+        _staging[i].bricks.resize(_slotBricks);
+        _staging[i].cellStarts.resize(cellStartsPerChunk());
+        _freeStaging.push_back(i);
+    }
+
+    _thread = std::thread{[this] {
+        backgroundLoop();
+    }};
+}
+
+LevelStream::~LevelStream()
+{
+    _stopping.store(true, std::memory_order_release);
+    _pendingRequests.fetch_add(1, std::memory_order_release);
+    _pendingRequests.notify_one();
+    _thread.join();
+}
+
+std::string_view LevelStream::name() const
+{
+    return _name;
+}
+
+const Rectangle& LevelStream::field() const
+{
+    return _field;
+}
+
+const ChunkLayout& LevelStream::layout() const
+{
+    return _layout;
+}
+
+uint32_t LevelStream::chunkBricks(uint32_t chunk) const
+{
+    auto begin = _chunkStarts[chunk];
+    auto end = _chunkStarts[chunk + 1];
+    if (end < begin || end > _fileBricks.size() ||
+            end - begin > _slotBricks) {
+        throw std::runtime_error{std::format(
+            "level {}: chunk {} has invalid bounds", _name, chunk)};
+    }
+    return static_cast<uint32_t>(end - begin);
+}
+
+std::span<const Rectangle> LevelStream::bricks() const
+{
+    return _bricks;
+}
+
+size_t LevelStream::slots() const
+{
+    return _slots.size();
+}
+
+size_t LevelStream::slotBricks() const
+{
+    return _slotBricks;
+}
+
+const BrickGrid& LevelStream::slotGrid(size_t slot) const
+{
+    return _slots[slot].grid;
+}
+
+float LevelStream::cellSize() const
+{
+    return _layout.size / static_cast<float>(_chunkCells);
+}
+
+size_t LevelStream::memoryBytes() const
+{
+    return (_slots.size() + _staging.size()) *
+        (_slotBricks * sizeof(Rectangle) +
+            cellStartsPerChunk() * sizeof(uint32_t) + sizeof(Slot));
+}
+
+void LevelStream::focus(std::span<const Rectangle> areas)
+{
+    _focusRound++;
+
+    // Every area asks for the chunks within reach of it, and a chunk is as
+    // near as its nearest area
+    _candidates.clear();
+    for (const auto& area : areas) {
+        float reach = _prefetchDistance + _layout.margin;
+        auto [firstColumn, lastColumn] = chunkRange(
+            area.xmin() - reach, area.xmax() + reach,
+            _layout.origin.x, _layout.size, _layout.columns);
+        auto [firstRow, lastRow] = chunkRange(
+            area.ymin() - reach, area.ymax() + reach,
+            _layout.origin.y, _layout.size, _layout.rows);
+        for (uint32_t row = firstRow; row <= lastRow; row++) {
+            for (uint32_t column = firstColumn; column <= lastColumn; column++) {
+                uint32_t chunk = row * _layout.columns + column;
+                if (chunkBricks(chunk) == 0) {
+                    continue;
+                }
+                float x = _layout.origin.x +
+                    _layout.size * static_cast<float>(column);
+                float y = _layout.origin.y +
+                    _layout.size * static_cast<float>(row);
+                auto bounds = Rectangle{
+                    {x + _layout.size / 2, y + _layout.size / 2},
+                    _layout.size + 2 * _layout.margin,
+                    _layout.size + 2 * _layout.margin};
+                _candidates.push_back(Candidate{
+                    .chunk = chunk,
+                    .distance = distance(bounds, area),
+                });
+            }
+        }
+    }
+
+    std::ranges::sort(_candidates, [] (const auto& a, const auto& b) {
+        return a.distance != b.distance ?
+            a.distance < b.distance : a.chunk < b.chunk;
+    });
+    _wanted.clear();
+    for (const auto& candidate : _candidates) {
+        if (_wanted.size() == _slots.size()) {
+            break;
+        }
+        if (!wanted(candidate.chunk)) {
+            _chunkWanted[candidate.chunk] = _focusRound;
+            _wanted.push_back(candidate.chunk);
+        }
+    }
+
+    for (uint32_t chunk : _wanted) {
+        if (auto slot = slotOf(chunk); slot != noSlot) {
+            _slots[slot].wanted = _focusRound;
+            continue;
+        }
+        if (_freeStaging.empty() || loading(chunk)) {
+            continue;
+        }
+        size_t staging = _freeStaging.back();
+        _freeStaging.pop_back();
+        _staging[staging].chunk = chunk;
+        _pendingRequests.fetch_add(1, std::memory_order_release);
+        _requests.push(staging);
+        _pendingRequests.notify_one();
+    }
+}
+
+void LevelStream::poll(std::vector<ChunkSwap>& swaps)
+{
+    _pollRound++;
+
+    size_t staging = 0;
+    while (_loaded.pop(staging)) {
+        auto& buffer = _staging[staging];
+        if (!buffer.valid) {
+            throw std::runtime_error{std::format(
+                "level {}: chunk {} has invalid cells", _name, buffer.chunk)};
+        }
+
+        size_t slot = noSlot;
+        if (slotOf(buffer.chunk) == noSlot && wanted(buffer.chunk)) {
+            slot = evictableSlot(false);
+        }
+        if (slot != noSlot) {
+            place(
+                slot,
+                buffer.chunk,
+                std::span{buffer.bricks}.first(chunkBricks(buffer.chunk)),
+                buffer.cellStarts,
+                swaps);
+            _slots[slot].wanted = _focusRound;
+            _stats.loads++;
+        } else {
+            _stats.dropped++;
+        }
+
+        buffer.chunk = noChunk;
+        _freeStaging.push_back(staging);
+    }
+}
+
+size_t LevelStream::require(uint32_t chunk, std::vector<ChunkSwap>& swaps)
+{
+    size_t slot = slotOf(chunk);
+    if (slot == noSlot) {
+        slot = evictableSlot(true);
+        if (slot == noSlot) {
+            throw std::runtime_error{std::format(
+                "level {}: the memory cap is too small for the chunks that "
+                "the ball touches", _name)};
+        }
+
+        // Loaded straight into the slot; the evicted chunk's bricks are not
+        // needed anymore
+        auto bricks = std::span{_bricks}.subspan(
+            slot * _slotBricks, chunkBricks(chunk));
+        auto cellStarts = std::span{_slotCellStarts}.subspan(
+            slot * cellStartsPerChunk(), cellStartsPerChunk());
+        if (!load(chunk, bricks, cellStarts)) {
+            throw std::runtime_error{std::format(
+                "level {}: chunk {} has invalid cells", _name, chunk)};
+        }
+        place(slot, chunk, {}, {}, swaps);
+        _stats.syncLoads++;
+    }
+    _slots[slot].required = _pollRound;
+    return slot;
+}
+
+const StreamStats& LevelStream::stats() const
+{
+    return _stats;
+}
+
+size_t LevelStream::cellStartsPerChunk() const
+{
+    return size_t{_chunkCells} * _chunkCells + 1;
+}
+
+// Runs on both threads: it only reads the mapping, and writes to buffers
+// that the other thread does not touch. Returns false if the cell starts of
+// the chunk do not fit its bricks.
+bool LevelStream::load(
+    uint32_t chunk,
+    std::span<Rectangle> bricks,
+    std::span<uint32_t> cellStarts) const
+{
+    auto first = _chunkStarts[chunk];
+    auto source = _fileBricks.subspan(first, bricks.size());
+    auto sourceCells = _cellStarts.subspan(
+        chunk * cellStartsPerChunk(), cellStartsPerChunk());
+    std::ranges::copy(source, bricks.begin());
+    std::ranges::copy(sourceCells, cellStarts.begin());
+
+    auto base = static_cast<const std::byte*>(_mmap.addr());
+    _mmap.release(
+        reinterpret_cast<const std::byte*>(source.data()) - base,
+        source.size_bytes());
+    _mmap.release(
+        reinterpret_cast<const std::byte*>(sourceCells.data()) - base,
+        sourceCells.size_bytes());
+
+    return cellStarts.front() == 0 && cellStarts.back() == bricks.size() &&
+        std::ranges::is_sorted(cellStarts);
+}
+
+size_t LevelStream::slotOf(uint32_t chunk) const
+{
+    uint32_t slot = _chunkSlots[chunk];
+    return slot == noChunk ? noSlot : slot;
+}
+
+bool LevelStream::wanted(uint32_t chunk) const
+{
+    return _chunkWanted[chunk] == _focusRound;
+}
+
+bool LevelStream::loading(uint32_t chunk) const
+{
+    return std::ranges::any_of(_staging, [chunk] (const Staging& staging) {
+        return staging.chunk == chunk;
+    });
+}
+
+// A free slot if there is one, or else the slot whose chunk was wanted
+// longest ago. Chunks that are wanted now are only evicted for a require.
+// Slots only run out once every chunk that fits is resident, so the scan
+// is for loads that evict.
+size_t LevelStream::evictableSlot(bool evenWanted) const
+{
+    if (!_freeSlots.empty()) {
+        return _freeSlots.back();
+    }
+
+    size_t best = noSlot;
+    for (size_t slot = 0; slot < _slots.size(); slot++) {
+        const auto& candidate = _slots[slot];
+        if (candidate.required == _pollRound ||
+                (!evenWanted && candidate.wanted == _focusRound)) {
+            continue;
+        }
+        if (best == noSlot || candidate.wanted < _slots[best].wanted) {
+            best = slot;
+        }
+    }
+    return best;
+}
+
+// Empty spans mean the chunk was loaded into the slot's storage already
+void LevelStream::place(
+    size_t slot,
+    uint32_t chunk,
+    std::span<const Rectangle> bricks,
+    std::span<const uint32_t> cellStarts,
+    std::vector<ChunkSwap>& swaps)
+{
+    auto& target = _slots[slot];
+    uint32_t count = chunkBricks(chunk);
+    swaps.push_back(ChunkSwap{
+        .slot = slot,
+        .evicted = target.chunk,
+        .evictedBricks = target.bricks,
+        .loaded = chunk,
+        .loadedBricks = count,
+    });
+    if (target.chunk != noChunk) {
+        _chunkSlots[target.chunk] = noChunk;
+        _stats.evictions++;
+    } else {
+        // evictableSlot() hands out free slots from the back
+        _freeSlots.pop_back();
+        _stats.residentChunks++;
+    }
+    _chunkSlots[chunk] = static_cast<uint32_t>(slot);
+
+    auto slotCells = std::span{_slotCellStarts}.subspan(
+        slot * cellStartsPerChunk(), cellStartsPerChunk());
+    if (!bricks.empty() || !cellStarts.empty()) {
+        std::ranges::copy(bricks, _bricks.begin() + slot * _slotBricks);
+        std::ranges::copy(cellStarts, slotCells.begin());
+    }
+
+    // The same expressions as where the level compiler placed the cells
+    uint32_t column = chunk % _layout.columns;
+    uint32_t row = chunk / _layout.columns;
+    target = Slot{
+        .chunk = chunk,
+        .bricks = count,
+        .wanted = target.wanted,
+        .grid = BrickGrid{
+            .origin = {
+                _layout.origin.x + _layout.size * static_cast<float>(column),
+                _layout.origin.y + _layout.size * static_cast<float>(row)},
+            .cellSize = _layout.size / static_cast<float>(_chunkCells),
+            .columns = _chunkCells,
+            .rows = _chunkCells,
+            .margin = _layout.margin,
+            .cellStarts = slotCells,
+        },
+    };
+}
+
+void LevelStream::backgroundLoop()
+{
+    while (!_stopping.load(std::memory_order_acquire)) {
+        size_t staging = 0;
+        if (!_requests.pop(staging)) {
+            _pendingRequests.wait(0, std::memory_order_acquire);
+            continue;
+        }
+        _pendingRequests.fetch_sub(1, std::memory_order_relaxed);
+
+        // Chunk bounds were checked when the chunk was requested
+        auto& buffer = _staging[staging];
+        auto count = _chunkStarts[buffer.chunk + 1] -
+            _chunkStarts[buffer.chunk];
+        buffer.valid = load(
+            buffer.chunk,
+            std::span{buffer.bricks}.first(count),
+            buffer.cellStarts);
+        _loaded.push(staging);
+    }
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "geometry.hpp"
+#include "grid.hpp"
+#include "mmap.hpp"
+#include "spsc.hpp"
+#include "world.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct StreamOptions {
+    // Hard cap on the memory for resident chunks, and for the buffers that
+    // chunks are loaded into
+    size_t memoryCap = size_t{16} << 20;
+    // Chunks within this distance of a focus area are loaded ahead of time
+    float prefetchDistance = 8;
+};
+
+struct StreamStats {
+    // Chunks loaded by the background thread, and by the main thread because
+    // the simulation needed them before they arrived
+    uint64_t loads = 0;
+    uint64_t syncLoads = 0;
+    uint64_t evictions = 0;
+    // Loaded chunks thrown away, because nothing wanted them anymore, or
+    // because every slot held a chunk that was wanted more
+    uint64_t dropped = 0;
+    size_t residentChunks = 0;
+};
+
+// Square chunks of world space, numbered row by row from the bottom left
+struct ChunkLayout {
+    Vector origin;
+    float size = 0;
+    uint32_t columns = 0;
+    uint32_t rows = 0;
+    // Largest distance from the center of a brick to its edge, along x or y
+    float margin = 0;
+};
+
+// A chunked level file, mapped into memory, with a fixed number of chunks in
+// memory at a time. Resident chunks live in the slots of one brick array,
+// with as many slots as the cap holds, or one per chunk of a smaller level,
+// so memory use depends on the cap and not on the size of the level, apart
+// from a few bytes per chunk for finding its slot. A
+// background thread copies chunks out of the mapping ahead of time, and
+// drops the pages it read, so that the mapping does not stay in memory
+// either.
+//
+// Everything except the background thread runs on the thread that created
+// the stream.
+class LevelStream {
+public:
+    static constexpr uint32_t noChunk = ChunkSwap::noChunk;
+    static constexpr size_t noSlot = SIZE_MAX;
+
+    explicit LevelStream(
+        const std::filesystem::path& path, const StreamOptions& options = {});
+    ~LevelStream();
+
+    LevelStream(const LevelStream&) = delete;
+    LevelStream& operator=(const LevelStream&) = delete;
+
+    std::string_view name() const;
+    const Rectangle& field() const;
+    const ChunkLayout& layout() const;
+    uint32_t chunkBricks(uint32_t chunk) const;
+
+    // Bricks of all slots; slot s starts at s * slotBricks(), and holds as
+    // many bricks as its chunk has
+    std::span<const Rectangle> bricks() const;
+    size_t slots() const;
+    size_t slotBricks() const;
+    // Grid of the chunk in a slot, with cell starts relative to the slot
+    const BrickGrid& slotGrid(size_t slot) const;
+    // Size of the cells of every chunk's grid
+    float cellSize() const;
+    // Calls f(index) for every brick in memory in the cells of the chunk
+    // grids that the area touches, widened by the margin, as an index into
+    // bricks(). Every brick is in one cell, so none is found twice, but some
+    // may lie outside the area. Nothing is loaded.
+    template <class F>
+    void forEachNear(float xmin, float xmax, float ymin, float ymax, F&& f) const;
+    // Memory taken by slots and load buffers, which stays under the cap
+    size_t memoryBytes() const;
+
+    // Chunks near the areas are wanted, nearest first: the ones that are not
+    // resident are queued for the background thread, and the others are
+    // kept over chunks that are not wanted
+    void focus(std::span<const Rectangle> areas);
+    // Moves chunks that the background thread has loaded into slots, and
+    // appends the slots that changed
+    void poll(std::vector<ChunkSwap>& swaps);
+    // Slot of a chunk, which is loaded right away if it is not resident.
+    // Chunks required since the last poll are not evicted by another
+    // require.
+    size_t require(uint32_t chunk, std::vector<ChunkSwap>& swaps);
+
+    const StreamStats& stats() const;
+
+private:
+    static constexpr size_t stagingBuffers = 4;
+    static constexpr size_t minSlots = 9;
+    static constexpr uint64_t neverWanted = UINT64_MAX;
+
+    struct Slot {
+        uint32_t chunk = noChunk;
+        uint32_t bricks = 0;
+        // Focus round in which the chunk was last wanted, and poll round in
+        // which it was last required
+        uint64_t wanted = 0;
+        uint64_t required = 0;
+        BrickGrid grid;
+    };
+
+    // Buffer that the background thread loads a chunk into
+    struct Staging {
+        uint32_t chunk = noChunk;
+        bool valid = false;
+        std::vector<Rectangle> bricks;
+        std::vector<uint32_t> cellStarts;
+    };
+
+    struct Candidate {
+        uint32_t chunk = 0;
+        float distance = 0;
+    };
+
+    size_t cellStartsPerChunk() const;
+    bool load(
+        uint32_t chunk,
+        std::span<Rectangle> bricks,
+        std::span<uint32_t> cellStarts) const;
+    size_t slotOf(uint32_t chunk) const;
+    bool wanted(uint32_t chunk) const;
+    bool loading(uint32_t chunk) const;
+    size_t evictableSlot(bool evenWanted) const;
+    void place(
+        size_t slot,
+        uint32_t chunk,
+        std::span<const Rectangle> bricks,
+        std::span<const uint32_t> cellStarts,
+        std::vector<ChunkSwap>& swaps);
+    void backgroundLoop();
+
+    MemoryMap _mmap;
+    std::string_view _name;
+    Rectangle _field;
+    ChunkLayout _layout;
+    uint32_t _chunkCells = 0;
+    std::span<const Rectangle> _fileBricks;
+    std::span<const uint64_t> _chunkStarts;
+    std::span<const uint32_t> _cellStarts;
+
+    float _prefetchDistance = 0;
+    size_t _slotBricks = 0;
+    std::vector<Rectangle> _bricks;
+    std::vector<uint32_t> _slotCellStarts;
+    std::vector<Slot> _slots;
+    // Free slots, the lowest last, and the slot of every chunk, or noChunk
+    std::vector<uint32_t> _freeSlots;
+    std::vector<uint32_t> _chunkSlots;
+    // Focus round in which each chunk was last wanted
+    std::vector<uint64_t> _chunkWanted;
+    uint64_t _focusRound = 0;
+    uint64_t _pollRound = 1;
+    std::vector<Candidate> _candidates;
+    std::vector<uint32_t> _wanted;
+
+    std::vector<Staging> _staging;
+    std::vector<size_t> _freeStaging;
+    SpscQueue<size_t, stagingBuffers> _requests;
+    SpscQueue<size_t, stagingBuffers> _loaded;
+    std::atomic<uint32_t> _pendingRequests = 0;
+    std::atomic<bool> _stopping = false;
+    std::thread _thread;
+
+    StreamStats _stats;
+};
+
+// Chunks hold the bricks whose centers are in them, and cells likewise, so
+// the area is widened by the margin, and a little for rounding, on both
+// levels
+template <class F>
+void LevelStream::forEachNear(
+    float xmin, float xmax, float ymin, float ymax, F&& f) const
+{
+    float reach = _layout.margin + _layout.size / 64;
+    xmin -= reach;
+    xmax += reach;
+    ymin -= reach;
+    ymax += reach;
+    auto [firstColumn, lastColumn] = cellRange(
+        xmin, xmax, _layout.origin.x, _layout.size, _layout.columns);
+    auto [firstRow, lastRow] = cellRange(
+        ymin, ymax, _layout.origin.y, _layout.size, _layout.rows);
+
+    for (uint32_t row = firstRow; row <= lastRow; row++) {
+        for (uint32_t column = firstColumn; column <= lastColumn; column++) {
+            size_t slot = slotOf(row * _layout.columns + column);
+            if (slot == noSlot) {
+                continue;
+            }
+            const auto& grid = _slots[slot].grid;
+            auto [firstCell, lastCell] = cellRange(
+                xmin, xmax, grid.origin.x, grid.cellSize, grid.columns);
+            auto [firstCellRow, lastCellRow] = cellRange(
+                ymin, ymax, grid.origin.y, grid.cellSize, grid.rows);
+            size_t base = slot * _slotBricks;
+            for (size_t cellRow = firstCellRow; cellRow <= lastCellRow;
+                    cellRow++) {
+                size_t cell = cellRow * grid.columns;
+                uint32_t begin = grid.cellStarts[cell + firstCell];
+                uint32_t end = grid.cellStarts[cell + lastCell + 1];
+                for (uint32_t i = begin; i < end; i++) {
+                    f(base + i);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include "text.hpp"
+
+#include <charconv>
+#include <iterator>
+
+namespace {
+
+const Glyph& glyph(const Font& font, char c)
+{
+    auto index = static_cast<unsigned char>(c);
+    return font.glyphs[index < Font::glyphCount ? index : '?'];
+}
+
+// Calls f(glyph, x, y) for every visible glyph, with the pen position
+// relative to the top left of the text
+template <class F>
+void layOut(const Font& font, std::string_view string, F&& f)
+{
+    float x = 0;
+    float y = 0;
+    for (char c : string) {
+        if (c == '\n') {
+            x = 0;
+            y += static_cast<float>(font.lineHeight);
+            continue;
+        }
+        const auto& g = glyph(font, c);
+        if (g.rect.w > 0) {
+            f(g, x, y);
+        }
+        x += static_cast<float>(g.advance);
+    }
+}
+
+SDL_FRect glyphRect(const Glyph& glyph, float x, float y)
+{
+    return SDL_FRect{
+        x + static_cast<float>(glyph.left),
+        y + static_cast<float>(glyph.top),
+        static_cast<float>(glyph.rect.w),
+        static_cast<float>(glyph.rect.h)};
+}
+
+} // namespace
+
+void Text::draw(const Font& font, std::string_view string, SDL_FPoint position)
+{
+    auto& map = layouts(font);
+    auto it = map.find(string);
+    if (it == map.end()) {
+        auto layout = Layout{};
+        layOut(font, string, [&layout] (const Glyph& g, float x, float y) {
+            layout.quads.push_back(Quad{g.rect, glyphRect(g, x, y)});
+        });
+        it = map.emplace(std::string{string}, std::move(layout)).first;
+        _counting.cacheMisses++;
+    } else {
+        _counting.cacheHits++;
+    }
+
+    it->second.lastUsed = _frame;
+    for (const auto& quad : it->second.quads) {
+        _pending.push_back(Pending{
+            .texture = font.texture,
+            .quad = Quad{
+                quad.src,
+                SDL_FRect{
+                    quad.dst.x + position.x,
+                    quad.dst.y + position.y,
+                    quad.dst.w,
+                    quad.dst.h}},
+        });
+    }
+    _counting.glyphs += it->second.quads.size();
+}
+
+void Text::draw(const Font& font, int64_t number, SDL_FPoint position)
+{
+    char buffer[24];
+    auto [end, error] = std::to_chars(std::begin(buffer), std::end(buffer), number);
+    auto string = std::string_view{buffer, end};
+
+    layOut(font, string, [this, &font, position] (const Glyph& g, float x, float y) {
+        _pending.push_back(Pending{
+            .texture = font.texture,
+            .quad = Quad{g.rect, glyphRect(g, position.x + x, position.y + y)},
+        });
+        _counting.glyphs++;
+    });
+}
+
+void Text::submit(RenderQueue& queue, uint8_t layer)
+{
+    for (size_t i = 0; i < _pending.size(); i++) {
+        const auto& [texture, quad] = _pending[i];
+        queue.push(layer, i, *texture, quad.src, quad.dst);
+    }
+    _pending.clear();
+
+    // Scanning the cache every frame would cost more than the layouts save
+    if (++_frame % maxIdleFrames == 0) {
+        evict();
+    }
+
+    _counting.cachedLayouts = 0;
+    for (const auto& [font, map] : _layouts) {
+        _counting.cachedLayouts += map.size();
+    }
+    _stats = _counting;
+    _counting = TextStats{};
+}
+
+void Text::clear()
+{
+    _layouts.clear();
+    _pending.clear();
+}
+
+const TextStats& Text::stats() const
+{
+    return _stats;
+}
+
+Text::LayoutMap& Text::layouts(const Font& font)
+{
+    for (auto& [cachedFont, map] : _layouts) {
+        if (cachedFont == &font) {
+            return map;
+        }
+    }
+    return _layouts.emplace_back(&font, LayoutMap{}).second;
+}
+
+void Text::evict()
+{
+    for (auto& [font, map] : _layouts) {
+        std::erase_if(map, [this] (const auto& entry) {
+            return entry.second.lastUsed + maxIdleFrames < _frame;
+        });
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "queue.hpp"
+#include "resources.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Counted between two calls of Text::submit()
+struct TextStats {
+    size_t glyphs = 0;
+    size_t cacheHits = 0;
+    size_t cacheMisses = 0;
+    size_t cachedLayouts = 0;
+};
+
+// Lays out text with the fonts that the packer rendered, and queues one quad
+// per glyph, so all text of a font is drawn with a single draw call.
+//
+// Layouts of strings are cached, since labels rarely change. Numbers that
+// change every frame have their own path, which formats and lays them out
+// straight into the queue without hashing or touching the cache. Once the
+// buffers have grown, neither path allocates.
+class Text {
+public:
+    // Layouts not used for this many submits are dropped
+    static constexpr uint64_t maxIdleFrames = 120;
+
+    // Positions are screen pixels at the top left of the first line. '\n'
+    // starts a new line.
+    void draw(const Font& font, std::string_view string, SDL_FPoint position);
+    void draw(const Font& font, int64_t number, SDL_FPoint position);
+
+    // Queues everything drawn since the last submit, in the order in which
+    // it was drawn
+    void submit(RenderQueue& queue, uint8_t layer);
+
+    // Drops cached layouts and pending text. Fonts are identified by address,
+    // so this is needed whenever fonts are reloaded.
+    void clear();
+
+    const TextStats& stats() const;
+
+private:
+    struct Quad {
+        SDL_Rect src;
+        SDL_FRect dst;
+    };
+
+    struct Layout {
+        std::vector<Quad> quads;
+        uint64_t lastUsed = 0;
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view string) const
+        {
+            return std::hash<std::string_view>{}(string);
+        }
+    };
+
+    using LayoutMap =
+        std::unordered_map<std::string, Layout, StringHash, std::equal_to<>>;
+
+    struct Pending {
+        sdl::Texture* texture;
+        Quad quad;
+    };
+
+    LayoutMap& layouts(const Font& font);
+    void evict();
+
+    std::vector<std::pair<const Font*, LayoutMap>> _layouts;
+    std::vector<Pending> _pending;
+    uint64_t _frame = 0;
+    TextStats _counting;
+    TextStats _stats;
+};
@@ -1,5 +1,6 @@
 #include "timer.hpp"
 
+#include <algorithm>
 #include <thread>
 
 FrameTimer::FrameTimer(int fps)
@@ -14,6 +15,11 @@ float FrameTimer::delta() const
     return _delta;
 }
 
+auto FrameTimer::frameDuration() const -> Clock::duration
+{
+    return _frameDuration;
+}
+
 int FrameTimer::operator()()
 {
     auto frameIndex = (Clock::now() - _start) / _frameDuration;
@@ -22,11 +28,23 @@ int FrameTimer::operator()()
     return framesPassed;
 }
 
+auto FrameTimer::frameTime() const -> Clock::time_point
+{
+    return _start + _frameDuration * _currentFrame;
+}
+
 void FrameTimer::relax()
 {
     std::this_thread::sleep_until(_start + _frameDuration * (_currentFrame + 1));
 }
 
+std::chrono::nanoseconds FrameTimer::untilNext() const
+{
+    auto next = _start + _frameDuration * (_currentFrame + 1);
+    return std::max<std::chrono::nanoseconds>(
+        next - Clock::now(), std::chrono::nanoseconds{0});
+}
+
 void FrameTimer::reset()
 {
     _start = Clock::now();
@@ -4,17 +4,23 @@
 
 class FrameTimer {
 public:
+    using Clock = std::chrono::steady_clock;
+
     FrameTimer(int fps);
 
     float delta() const;
+    Clock::duration frameDuration() const;
     int operator()();
+    // When the last frame counted by operator()() was due. The frames that
+    // it returned cover the time up to here.
+    Clock::time_point frameTime() const;
     void relax();
+    // Time left until the next frame is due, or zero if it is due already
+    std::chrono::nanoseconds untilNext() const;
 
     void reset();
 
 private:
-    using Clock = std::chrono::high_resolution_clock;
-
     Clock::duration _frameDuration;
     float _delta = 0.f;
 
@@ -0,0 +1,338 @@
+#include "trajectory.hpp"
+
+#include "grid.hpp"
+#include "stream.hpp"
+
+#include <algorithm>
+#include <concepts>
+#include <functional>
+#include <iterator>
+
+namespace {
+
+template <Scalar T>
+bool sameRectangle(const BasicRectangle<T>& lhs, const BasicRectangle<T>& rhs)
+{
+    return lhs.xmin() == rhs.xmin() && lhs.xmax() == rhs.xmax() &&
+        lhs.ymin() == rhs.ymin() && lhs.ymax() == rhs.ymax();
+}
+
+} // namespace
+
+template <Scalar T>
+bool BasicTrajectoryPredictor<T>::Key::operator==(const Key& other) const
+{
+    return ball.center.x == other.ball.center.x &&
+        ball.center.y == other.ball.center.y &&
+        ball.radius == other.ball.radius &&
+        velocity.x == other.velocity.x &&
+        velocity.y == other.velocity.y &&
+        horizon == other.horizon &&
+        maxBounces == other.maxBounces &&
+        ignore == other.ignore &&
+        pads == other.pads;
+}
+
+// Values are hashed as doubles, which hold floats and Fixed exactly, and
+// which hash zero and negative zero the same, as they compare equal
+template <Scalar T>
+size_t BasicTrajectoryPredictor<T>::KeyHash::operator()(const Key& key) const
+{
+    size_t hash = std::hash<size_t>{}(key.maxBounces) ^
+        std::hash<size_t>{}(key.ignore) * 3 ^ (key.pads ? 5 : 0);
+    for (T value : {
+            key.ball.center.x, key.ball.center.y, key.ball.radius,
+            key.velocity.x, key.velocity.y, key.horizon}) {
+        hash = hash * 0x100000001b3 ^
+            std::hash<double>{}(static_cast<double>(value));
+    }
+    return hash;
+}
+
+template <Scalar T>
+BasicTrajectoryPredictor<T>::BasicTrajectoryPredictor(
+        const BasicWorld<T>& world)
+    : _world(world)
+{ }
+
+template <Scalar T>
+auto BasicTrajectoryPredictor<T>::predict(T horizon, size_t maxBounces)
+    -> const BasicTrajectory<T>&
+{
+    return predict(BasicTrajectoryQuery<T>{
+        .ball = _world.ball(),
+        .velocity = _world.ballVelocity(),
+        .horizon = horizon,
+        .maxBounces = maxBounces,
+        .ignore = _world.lastObstacle(),
+    });
+}
+
+template <Scalar T>
+auto BasicTrajectoryPredictor<T>::predict(
+    const BasicTrajectoryQuery<T>& query) -> const BasicTrajectory<T>&
+{
+    refresh();
+    _stats.queries++;
+
+    auto key = Key{
+        .ball = query.ball,
+        .velocity = query.velocity,
+        .horizon = query.horizon,
+        .maxBounces = query.maxBounces,
+        .ignore = query.ignore,
+        .pads = query.pads,
+    };
+    if (auto it = _cache.find(key); it != _cache.end()) {
+        _stats.cacheHits++;
+        return it->second;
+    }
+
+    if (_cache.size() >= maxCached) {
+        _cache.clear();
+    }
+    auto& trajectory = _cache[key];
+    trace(query, trajectory);
+    return trajectory;
+}
+
+template <Scalar T>
+const TrajectoryStats& BasicTrajectoryPredictor<T>::stats() const
+{
+    return _stats;
+}
+
+template <Scalar T>
+void BasicTrajectoryPredictor<T>::refresh()
+{
+    auto field = _world.field();
+    bool padsMoved = false;
+    for (size_t player = 0; player < maxPlayers; player++) {
+        padsMoved |= !sameRectangle(_world.pad(player), _pads[player]);
+    }
+
+    if (!_built || _world.bricksGeneration() != _generation) {
+        buildGrid();
+        _cache.clear();
+    } else if (_world.brickChanges() != _brickChanges ||
+            !sameRectangle(field, _field)) {
+        _cache.clear();
+    } else if (padsMoved) {
+        std::erase_if(_cache, [] (const auto& entry) {
+            return entry.first.pads;
+        });
+    }
+
+    _brickChanges = _world.brickChanges();
+    _field = field;
+    for (size_t player = 0; player < maxPlayers; player++) {
+        _pads[player] = _world.pad(player);
+    }
+}
+
+// Bricks that are not alive go into the grid too if they were destroyed in
+// the current history, since restoring a snapshot brings them back. A
+// stream has grids of its own, which follow the chunks it loads.
+template <Scalar T>
+void BasicTrajectoryPredictor<T>::buildGrid()
+{
+    _built = true;
+    _generation = _world.bricksGeneration();
+    auto bricks = _world.bricks();
+    _checked.assign(bricks.size(), 0);
+    _step = 0;
+    if (streamed()) {
+        _grid = BasicRectangleGrid<T>{};
+        return;
+    }
+
+    _stats.gridBuilds++;
+    auto used = std::vector<bool>(bricks.size());
+    for (size_t i = 0; i < bricks.size(); i++) {
+        used[i] = _world.brickAlive(i);
+    }
+    for (size_t i = 0; i < _world.destroyedBrickCount(); i++) {
+        used[_world.destroyedBrick(i)] = true;
+    }
+
+    _grid.build(bricks, used);
+}
+
+template <Scalar T>
+bool BasicTrajectoryPredictor<T>::streamed() const
+{
+    return _world.stream() != nullptr;
+}
+
+template <Scalar T>
+T BasicTrajectoryPredictor<T>::cellSize() const
+{
+    if constexpr (std::same_as<T, float>) {
+        if (streamed()) {
+            return _world.stream()->cellSize();
+        }
+    }
+    return _grid.cellSize();
+}
+
+// Follows the same rules as BasicWorld::update(): bricks win ties against
+// pads and walls, and the ball is lost once it is wholly below the field
+template <Scalar T>
+void BasicTrajectoryPredictor<T>::trace(
+    const BasicTrajectoryQuery<T>& query, BasicTrajectory<T>& trajectory)
+{
+    size_t bricks = _world.bricks().size();
+    size_t players = _world.players();
+    auto walls = _world.walls();
+    T miny = _world.field().ymin();
+
+    auto ball = query.ball;
+    auto velocity = query.velocity;
+    size_t ignore = query.ignore;
+    T time = 0;
+    trajectory.bounces.clear();
+    trajectory.lost = false;
+    _hitBricks.clear();
+
+    while (trajectory.bounces.size() < query.maxBounces &&
+            time < query.horizon &&
+            (velocity.x != T{0} || velocity.y != T{0})) {
+        T remaining = query.horizon - time;
+        auto hit = nearestBrick(ball, velocity, remaining, ignore);
+        auto check = [&] (size_t obstacle, const BasicRectangle<T>& rectangle) {
+            if (obstacle == ignore) {
+                return;
+            }
+            auto c = collision(ball, velocity, rectangle);
+            if (c < hit.collision) {
+                hit = Hit{.collision = c, .obstacle = obstacle};
+            }
+        };
+        if (query.pads) {
+            for (size_t player = 0; player < players; player++) {
+                check(bricks + player, _world.pad(player));
+            }
+        }
+        for (size_t i = 0; i < walls.size(); i++) {
+            check(bricks + players + i, walls[i]);
+        }
+
+        if (velocity.y < T{0}) {
+            T drop = std::max(
+                (miny - ball.radius - ball.center.y) / velocity.y, T{0});
+            if (drop <= remaining && !(hit.collision.time < drop)) {
+                ball.center += velocity * drop;
+                time += drop;
+                trajectory.lost = true;
+                break;
+            }
+        }
+
+        if (!hit.collision || hit.collision.time > remaining) {
+            ball.center += velocity * remaining;
+            time = query.horizon;
+            break;
+        }
+
+        ball.center += velocity * hit.collision.time;
+        velocity = reflect(velocity, hit.collision.norm);
+        time += hit.collision.time;
+        ignore = hit.obstacle;
+        if (hit.obstacle < bricks) {
+            _hitBricks.push_back(hit.obstacle);
+        }
+        trajectory.bounces.push_back(BasicBounce<T>{
+            .time = time,
+            .position = ball.center,
+            .velocity = velocity,
+            .obstacle = hit.obstacle,
+        });
+    }
+
+    trajectory.time = time;
+    trajectory.position = ball.center;
+    trajectory.velocity = velocity;
+}
+
+// Walks the path a cell at a time. A hit found in a step can still be beaten
+// by a brick of a later step if it is later than the step, so the walk goes
+// on until the best hit is within the steps checked so far.
+template <Scalar T>
+auto BasicTrajectoryPredictor<T>::nearestBrick(
+    const BasicCircle<T>& ball,
+    const BasicVector<T>& velocity,
+    T within,
+    size_t ignore) -> Hit
+{
+    auto hit = Hit{};
+    if (_grid.empty() && !streamed()) {
+        return hit;
+    }
+
+    if (++_step == 0) {
+        std::ranges::fill(_checked, 0);
+        _step = 1;
+    }
+
+    T step = cellSize() / velocity.len();
+    for (T begin = 0; ; ) {
+        T end = step >= within - begin ? within : begin + step;
+        checkCells(
+            ball,
+            velocity,
+            ball.center + velocity * begin,
+            ball.center + velocity * end,
+            ignore,
+            hit);
+        if (hit.collision.time <= end || end == within) {
+            return hit;
+        }
+        begin = end;
+    }
+}
+
+// Ties go to the lowest index, as in the world
+template <Scalar T>
+void BasicTrajectoryPredictor<T>::checkCells(
+    const BasicCircle<T>& ball,
+    const BasicVector<T>& velocity,
+    const BasicVector<T>& from,
+    const BasicVector<T>& to,
+    size_t ignore,
+    Hit& hit)
+{
+    T reach = ball.radius + cellSize() / 64;
+    auto bricks = _world.bricks();
+    auto check = [&] (size_t brick) {
+        if (_checked[brick] == _step) {
+            return;
+        }
+        _checked[brick] = _step;
+        if (brick == ignore || !_world.brickAlive(brick) ||
+                std::ranges::find(_hitBricks, brick) != _hitBricks.end()) {
+            return;
+        }
+
+        _stats.bricksChecked++;
+        auto c = collision(ball, velocity, bricks[brick]);
+        if (c < hit.collision ||
+                (c && c.time == hit.collision.time && brick < hit.obstacle)) {
+            hit = Hit{.collision = c, .obstacle = brick};
+        }
+    };
+
+    T xmin = std::min(from.x, to.x) - reach;
+    T xmax = std::max(from.x, to.x) + reach;
+    T ymin = std::min(from.y, to.y) - reach;
+    T ymax = std::max(from.y, to.y) + reach;
+    if constexpr (std::same_as<T, float>) {
+        if (streamed()) {
+            _world.stream()->forEachNear(xmin, xmax, ymin, ymax, check);
+            return;
+        }
+    }
+    _grid.forEach(xmin, xmax, ymin, ymax, check);
+}
+
+template class BasicTrajectoryPredictor<float>;
+template class BasicTrajectoryPredictor<Fixed>;
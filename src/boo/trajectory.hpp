@@ -0,0 +1,155 @@
+#pragma once
+
+#include "collision.hpp"
+#include "geometry.hpp"
+#include "grid.hpp"
+#include "world.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+template <Scalar T>
+struct BasicBounce {
+    // Since the start of the prediction
+    T time = 0;
+    // Center of the ball when it touches the obstacle
+    BasicVector<T> position;
+    // Velocity after the bounce
+    BasicVector<T> velocity;
+    // Numbered as in BasicWorld::lastObstacle()
+    size_t obstacle = 0;
+};
+
+template <Scalar T>
+struct BasicTrajectory {
+    std::vector<BasicBounce<T>> bounces;
+    // Where the prediction stops: at the horizon, at the last bounce asked
+    // for, or where the ball drops out at the bottom of the field
+    T time = 0;
+    BasicVector<T> position;
+    BasicVector<T> velocity;
+    bool lost = false;
+};
+
+template <Scalar T>
+struct BasicTrajectoryQuery {
+    BasicCircle<T> ball;
+    BasicVector<T> velocity;
+    // Time to look ahead
+    T horizon = 2;
+    size_t maxBounces = 8;
+    // Obstacle the ball cannot hit first, as the one it bounced off last
+    size_t ignore = SIZE_MAX;
+    // Whether the pads, where they are now, are obstacles. Without them the
+    // path goes through the pads, e.g. to find where the ball comes down.
+    bool pads = true;
+};
+
+struct TrajectoryStats {
+    uint64_t queries = 0;
+    uint64_t cacheHits = 0;
+    uint64_t gridBuilds = 0;
+    uint64_t bricksChecked = 0;
+};
+
+// Predicts how a ball moves through a world, bounce by bounce, as the world
+// would move it if nothing changed on the way, up to rounding. Bricks that
+// the ball hits are gone for the rest of the path.
+//
+// Bricks are sorted into a uniform grid of the predictor's own, which is
+// built again when the bricks generation of the world changes. A streamed
+// level is looked up in the grids of the stream's chunks instead, so chunks
+// coming and going cost nothing here, and only chunks in memory are seen.
+// The ball checks the cells along its path a step at a time, and stops at
+// the first step with a hit. Results are cached by query until bricks change
+// or the field changes, and until the pads move for queries that include
+// the pads.
+//
+// A predictor keeps scratch state, so every thread needs its own.
+template <Scalar T>
+class BasicTrajectoryPredictor {
+public:
+    explicit BasicTrajectoryPredictor(const BasicWorld<T>& world);
+
+    // Path of the world's ball. The result stays valid until the next call.
+    const BasicTrajectory<T>& predict(T horizon, size_t maxBounces = 8);
+    const BasicTrajectory<T>& predict(const BasicTrajectoryQuery<T>& query);
+
+    const TrajectoryStats& stats() const;
+
+private:
+    static constexpr size_t maxCached = 4096;
+
+    struct Key {
+        BasicCircle<T> ball;
+        BasicVector<T> velocity;
+        T horizon = 0;
+        size_t maxBounces = 0;
+        size_t ignore = 0;
+        bool pads = false;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Hit {
+        BasicCollision<T> collision;
+        size_t obstacle = SIZE_MAX;
+    };
+
+    void refresh();
+    void buildGrid();
+    bool streamed() const;
+    T cellSize() const;
+    void trace(
+        const BasicTrajectoryQuery<T>& query,
+        BasicTrajectory<T>& trajectory);
+    Hit nearestBrick(
+        const BasicCircle<T>& ball,
+        const BasicVector<T>& velocity,
+        T within,
+        size_t ignore);
+    void checkCells(
+        const BasicCircle<T>& ball,
+        const BasicVector<T>& velocity,
+        const BasicVector<T>& from,
+        const BasicVector<T>& to,
+        size_t ignore,
+        Hit& hit);
+
+    const BasicWorld<T>& _world;
+
+    // State of the world that the grid and the cache are for
+    bool _built = false;
+    uint64_t _generation = 0;
+    uint64_t _brickChanges = 0;
+    std::array<BasicRectangle<T>, maxPlayers> _pads;
+    BasicRectangle<T> _field;
+
+    BasicRectangleGrid<T> _grid;
+
+    // Step in which each brick was last checked, so that a brick in several
+    // cells is checked once per straight stretch of the path
+    std::vector<uint32_t> _checked;
+    uint32_t _step = 0;
+    // Bricks the path has destroyed so far
+    std::vector<size_t> _hitBricks;
+
+    std::unordered_map<Key, BasicTrajectory<T>, KeyHash> _cache;
+    TrajectoryStats _stats;
+};
+
+extern template class BasicTrajectoryPredictor<float>;
+extern template class BasicTrajectoryPredictor<Fixed>;
+
+using Bounce = BasicBounce<float>;
+using Trajectory = BasicTrajectory<float>;
+using TrajectoryQuery = BasicTrajectoryQuery<float>;
+using TrajectoryPredictor = BasicTrajectoryPredictor<float>;
+using FixedTrajectoryPredictor = BasicTrajectoryPredictor<Fixed>;
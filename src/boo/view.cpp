@@ -1,5 +1,100 @@
 #include "view.hpp"
 
+#include "jobs.hpp"
+#include "stream.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// Render queue layers, from the bottom
+constexpr uint8_t layerStatic = 0;
+constexpr uint8_t layerDynamic = 1;
+constexpr uint8_t layerHud = 2;
+
+// The view follows the ball when it is this fraction of the screen height
+// away from the center
+constexpr float followSlack = 0.25f;
+
+// Bricks per projection job; smaller levels are projected on one thread
+constexpr size_t projectionGrain = 16384;
+
+constexpr size_t maxParticles = 16384;
+constexpr int debrisPerBrick = 24;
+constexpr float debrisSize = 0.15f;
+constexpr Vector debrisGravity {0, -30};
+
+// Smallest pixel rectangle covering the given one
+SDL_Rect coveringRect(const SDL_FRect& rect)
+{
+    int x = static_cast<int>(std::floor(rect.x));
+    int y = static_cast<int>(std::floor(rect.y));
+    return SDL_Rect{
+        .x = x,
+        .y = y,
+        .w = static_cast<int>(std::ceil(rect.x + rect.w)) - x,
+        .h = static_cast<int>(std::ceil(rect.y + rect.h)) - y,
+    };
+}
+
+// Smallest rectangle covering all of the given ones, which must not be none
+SDL_FRect boundingRect(std::span<const SDL_FRect> rects)
+{
+    float xmin = rects.front().x;
+    float xmax = rects.front().x + rects.front().w;
+    float ymin = rects.front().y;
+    float ymax = rects.front().y + rects.front().h;
+    for (const auto& rect : rects) {
+        xmin = std::min(xmin, rect.x);
+        xmax = std::max(xmax, rect.x + rect.w);
+        ymin = std::min(ymin, rect.y);
+        ymax = std::max(ymax, rect.y + rect.h);
+    }
+    return SDL_FRect{xmin, ymin, xmax - xmin, ymax - ymin};
+}
+
+SDL_FRect translated(SDL_FRect rect, const SDL_FPoint& offset)
+{
+    rect.x += offset.x;
+    rect.y += offset.y;
+    return rect;
+}
+
+SDL_Point rounded(const SDL_FPoint& point)
+{
+    return SDL_Point{
+        static_cast<int>(std::lround(point.x)),
+        static_cast<int>(std::lround(point.y)),
+    };
+}
+
+bool intersect(const SDL_FRect& frect, const SDL_Rect& rect)
+{
+    return frect.x < rect.x + rect.w && frect.x + frect.w > rect.x &&
+        frect.y < rect.y + rect.h && frect.y + frect.h > rect.y;
+}
+
+// Cuts the rectangle down to the bounds; false if nothing is left
+bool clip(SDL_Rect& rect, const SDL_Rect& bounds)
+{
+    int x = std::max(rect.x, bounds.x);
+    int y = std::max(rect.y, bounds.y);
+    int right = std::min(rect.x + rect.w, bounds.x + bounds.w);
+    int bottom = std::min(rect.y + rect.h, bounds.y + bounds.h);
+    rect = SDL_Rect{x, y, right - x, bottom - y};
+    return rect.w > 0 && rect.h > 0;
+}
+
+bool intersect(const Rectangle& lhs, const Rectangle& rhs)
+{
+    return lhs.xmin() <= rhs.xmax() && lhs.xmax() >= rhs.xmin() &&
+        lhs.ymin() <= rhs.ymax() && lhs.ymax() >= rhs.ymin();
+}
+
+} // namespace
+
 void Camera::screenSize(int width, int height)
 {
     _screenWidth = width;
@@ -7,14 +102,52 @@ void Camera::screenSize(int width, int height)
     recalculateCorner();
 }
 
+void Camera::zoom(float zoom)
+{
+    _zoom = zoom;
+    recalculateCorner();
+}
+
+void Camera::pan(const Vector& offset)
+{
+    _pan = offset;
+    _version++;
+}
+
+float Camera::scale() const
+{
+    return _pixelsPerUnit * _zoom;
+}
+
+const Vector& Camera::panOffset() const
+{
+    return _pan;
+}
+
+Rectangle Camera::visibleArea() const
+{
+    float width = static_cast<float>(_screenWidth) / scale();
+    float height = static_cast<float>(_screenHeight) / scale();
+    return Rectangle{
+        {_worldCorner.x + _pan.x + width / 2,
+            _worldCorner.y + _pan.y - height / 2},
+        width,
+        height};
+}
+
+SDL_FPoint Camera::translation() const
+{
+    return SDL_FPoint{-_pan.x * scale(), _pan.y * scale()};
+}
+
 float Camera::projectX(float worldX) const
 {
-    return (worldX - _worldCorner.x) * _pixelsPerUnit * _zoom;
+    return (worldX - _worldCorner.x - _pan.x) * scale();
 }
 
 float Camera::projectY(float worldY) const
 {
-    return (_worldCorner.y - worldY) * _pixelsPerUnit * _zoom;
+    return (_worldCorner.y + _pan.y - worldY) * scale();
 }
 
 Vector Camera::project(const Vector& worldPoint) const
@@ -27,8 +160,8 @@ SDL_FRect Camera::project(const Rectangle& worldRectangle) const
     return SDL_FRect{
         .x = projectX(worldRectangle.xmin()),
         .y = projectY(worldRectangle.ymax()),
-        .w = worldRectangle.w() * _pixelsPerUnit * _zoom,
-        .h = worldRectangle.h() * _pixelsPerUnit * _zoom,
+        .w = worldRectangle.w() * scale(),
+        .h = worldRectangle.h() * scale(),
     };
 }
 
@@ -37,53 +170,635 @@ SDL_FRect Camera::project(const Circle& worldCircle) const
     return SDL_FRect{
         .x = projectX(worldCircle.center.x - worldCircle.radius),
         .y = projectY(worldCircle.center.y + worldCircle.radius),
-        .w = worldCircle.radius * 2 * _pixelsPerUnit * _zoom,
-        .h = worldCircle.radius * 2 * _pixelsPerUnit * _zoom,
+        .w = worldCircle.radius * 2 * scale(),
+        .h = worldCircle.radius * 2 * scale(),
     };
 }
 
+Rectangle Camera::unproject(const SDL_Rect& screenRect) const
+{
+    float width = static_cast<float>(screenRect.w) / scale();
+    float height = static_cast<float>(screenRect.h) / scale();
+    return Rectangle{
+        {_worldCorner.x + _pan.x + screenRect.x / scale() + width / 2,
+            _worldCorner.y + _pan.y - screenRect.y / scale() - height / 2},
+        width,
+        height};
+}
+
+// Written as one branch-free loop over plain arrays, with the camera state in
+// locals, so that the compiler can vectorize it
+void Camera::projectUnpanned(
+    std::span<const Rectangle> worldRectangles,
+    std::span<SDL_FRect> screenRects) const
+{
+    const float s = scale();
+    const float cornerX = _worldCorner.x;
+    const float cornerY = _worldCorner.y;
+    const Rectangle* source = worldRectangles.data();
+    SDL_FRect* target = screenRects.data();
+    for (size_t i = 0, n = worldRectangles.size(); i < n; i++) {
+        float xmin = source[i].xmin();
+        float xmax = source[i].xmax();
+        float ymin = source[i].ymin();
+        float ymax = source[i].ymax();
+        target[i].x = (xmin - cornerX) * s;
+        target[i].y = (cornerY - ymax) * s;
+        target[i].w = (xmax - xmin) * s;
+        target[i].h = (ymax - ymin) * s;
+    }
+}
+
+uint64_t Camera::version() const
+{
+    return _version;
+}
+
+uint64_t Camera::scaleVersion() const
+{
+    return _scaleVersion;
+}
+
 void Camera::recalculateCorner()
 {
     _worldCorner = {
-        -1.f * _screenWidth / (2 * _pixelsPerUnit * _zoom),
-        1.f * _screenHeight / (_pixelsPerUnit * _zoom)
+        -1.f * _screenWidth / (2 * scale()),
+        1.f * _screenHeight / scale()
     };
+    _scaleVersion++;
+    _version++;
 }
 
-View::View(Window& window, Resources& resources)
+View::View(Window& window, Resources& resources, JobSystem* jobs)
     : _window(window)
     , _resources(resources)
+    , _jobs(jobs)
+    , _particles(maxParticles)
 {
     auto [w, h] = _window.size();
     _camera.screenSize(w, h);
 }
 
+void View::animate(const World& world, float deltaSeconds)
+{
+    syncAnimations(world);
+
+    _dynamicAnimations.update(deltaSeconds);
+    _brickAnimations.update(deltaSeconds);
+
+    emitDebris(world);
+    _particles.update(deltaSeconds, debrisGravity);
+}
+
+void View::draw(const World& world)
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto& renderer = _window.renderer();
+
+    _stats = RenderStats{};
+    auto start = Clock::now();
+
+    follow(world);
+    syncAnimations(world);
+
+    // The layer is updated first, since switching render targets in the
+    // middle of a frame may not preserve the back buffer on every backend
+    bool bricksAnimate = _resources[r::Sprite::Brick].frames.size() > 1;
+    if (bricksAnimate) {
+        queueBricks(world);
+    } else {
+        updateStaticLayer(world);
+    }
+    auto layerUpdated = Clock::now();
+
+    renderer.clear();
+    auto cleared = Clock::now();
+
+    auto ball = _camera.project(world.ball());
+    const auto& padSprite =
+        levelSprite(r::Sprite::Platform, _camera.project(world.pad()).w);
+    const auto& ballSprite = levelSprite(r::Sprite::Ball, ball.w);
+
+    // The rest of the translation, below a pixel, moves the whole layer
+    if (!bricksAnimate) {
+        auto translation = _camera.translation();
+        _queue.push(
+            layerStatic,
+            0,
+            _staticLayer,
+            SDL_Rect{0, 0, _layerSize.w, _layerSize.h},
+            SDL_FRect{
+                translation.x - static_cast<float>(_layerOffset.x),
+                translation.y - static_cast<float>(_layerOffset.y),
+                static_cast<float>(_layerSize.w),
+                static_cast<float>(_layerSize.h)});
+    }
+    for (size_t player = 0; player < world.players(); player++) {
+        _queue.push(
+            layerDynamic,
+            0,
+            *padSprite.texture,
+            padSprite.frames[_dynamicAnimations.frame(_padAnimation)].rect,
+            _camera.project(world.pad(player)));
+    }
+    _queue.push(
+        layerDynamic,
+        1,
+        *ballSprite.texture,
+        ballSprite.frames[_dynamicAnimations.frame(_ballAnimation)].rect,
+        ball);
+    submitQueue();
+    drawParticles();
+
+    // Text goes through the queue once more, to stay above the particles
+    hudText().submit(_queue, layerHud);
+    submitQueue();
+    _stats.text = _text.stats();
+    auto finish = Clock::now();
+
+    _stats.clear = cleared - layerUpdated;
+    _stats.bricks = layerUpdated - start;
+    _stats.dynamic = finish - cleared;
+}
+
+void View::present()
+{
+    auto start = std::chrono::steady_clock::now();
+    _window.renderer().present();
+    _stats.present = std::chrono::steady_clock::now() - start;
+}
+
 void View::render(const World& world)
+{
+    draw(world);
+    present();
+}
+
+void View::text(r::Font font, std::string_view string, SDL_FPoint position)
+{
+    hudText().draw(_resources.font(font), string, position);
+}
+
+void View::text(r::Font font, int64_t number, SDL_FPoint position)
+{
+    hudText().draw(_resources.font(font), number, position);
+}
+
+const RenderStats& View::stats() const
+{
+    return _stats;
+}
+
+const Camera& View::camera() const
+{
+    return _camera;
+}
+
+void View::invalidate()
+{
+    _layerValid = false;
+}
+
+void View::updateStaticLayer(const World& world)
 {
     auto& renderer = _window.renderer();
+    auto size = _window.size();
+    if (!_staticLayer.ptr() ||
+            size.w != _layerSize.w || size.h != _layerSize.h) {
+        _staticLayer = renderer.createTexture(
+            SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, size.w, size.h);
+        _staticLayer.blendMode(SDL_BLENDMODE_BLEND);
+        _scrollLayer = renderer.createTexture(
+            SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, size.w, size.h);
+        _scrollLayer.blendMode(SDL_BLENDMODE_BLEND);
+        _layerSize = size;
+        _layerValid = false;
+    }
 
-    const auto& brickSprite = _resources[r::Sprite::Brick];
-    const auto& padSprite = _resources[r::Sprite::Platform];
-    const auto& ballSprite = _resources[r::Sprite::Ball];
+    // A view that fell behind the world's log of changes cannot tell which
+    // bricks to repair, and a pan of a whole screen leaves nothing to keep
+    auto offset = rounded(_camera.translation());
+    if (!_layerValid ||
+            _layerBricksGeneration != world.bricksGeneration() ||
+            _layerChangesSeen < world.oldestBrickChange() ||
+            _layerScaleVersion != _camera.scaleVersion() ||
+            _layerResourcesVersion != _resources.version() ||
+            std::abs(offset.x - _layerOffset.x) >= _layerSize.w ||
+            std::abs(offset.y - _layerOffset.y) >= _layerSize.h) {
+        _layerOffset = offset;
+        redrawStaticLayer(world);
+        _layerValid = true;
+        _layerBricksGeneration = world.bricksGeneration();
+        _layerScaleVersion = _camera.scaleVersion();
+        _layerResourcesVersion = _resources.version();
+        _layerChangesSeen = world.brickChanges();
+        _replacedRects.clear();
+        _stats.layerRedrawn = true;
+        return;
+    }
 
+    _dirtyRects.clear();
+    if (offset.x != _layerOffset.x || offset.y != _layerOffset.y) {
+        scrollStaticLayer(offset);
+    }
+
+    const auto& rects = brickRects(world);
+    auto layerOffset = SDL_FPoint{
+        static_cast<float>(_layerOffset.x), static_cast<float>(_layerOffset.y)};
+    for (; _layerChangesSeen < world.brickChanges(); _layerChangesSeen++) {
+        auto change = world.brickChange(_layerChangesSeen);
+        if (change.kind == BrickChange::Kind::State) {
+            _dirtyRects.push_back(
+                coveringRect(translated(rects[change.first], layerOffset)));
+        }
+    }
+
+    // Ranges of a stream may cover much more than the screen, so they are
+    // clipped to it
+    auto layerRect = SDL_Rect{0, 0, _layerSize.w, _layerSize.h};
+    for (const auto& replaced : _replacedRects) {
+        auto dirty = coveringRect(translated(replaced, layerOffset));
+        if (clip(dirty, layerRect)) {
+            _dirtyRects.push_back(dirty);
+        }
+    }
+    _replacedRects.clear();
+    if (!_dirtyRects.empty()) {
+        repairStaticLayer(world);
+    }
+}
+
+// Moves the pixels of the layer by the change of the offset. A texture
+// cannot be copied onto itself, so the pixels go to the other one, which
+// then takes its place. The strips that come into view become dirty.
+void View::scrollStaticLayer(const SDL_Point& offset)
+{
+    auto& renderer = _window.renderer();
+    int dx = offset.x - _layerOffset.x;
+    int dy = offset.y - _layerOffset.y;
+    int w = _layerSize.w;
+    int h = _layerSize.h;
+
+    // Without blending, the copy replaces pixels, transparent ones included
+    renderer.target(&_scrollLayer);
+    _staticLayer.blendMode(SDL_BLENDMODE_NONE);
+    auto source = SDL_Rect{0, 0, w, h};
+    auto target = SDL_Rect{dx, dy, w, h};
+    renderer.copy(_staticLayer, &source, &target);
+    _staticLayer.blendMode(SDL_BLENDMODE_BLEND);
+    renderer.target(nullptr);
+    std::swap(_staticLayer, _scrollLayer);
+    _layerOffset = offset;
+    _stats.drawCalls++;
+
+    if (dx > 0) {
+        _dirtyRects.push_back(SDL_Rect{0, 0, dx, h});
+    } else if (dx < 0) {
+        _dirtyRects.push_back(SDL_Rect{w + dx, 0, -dx, h});
+    }
+    if (dy > 0) {
+        _dirtyRects.push_back(SDL_Rect{0, 0, w, dy});
+    } else if (dy < 0) {
+        _dirtyRects.push_back(SDL_Rect{0, h + dy, w, -dy});
+    }
+}
+
+// Only bricks on the screen are drawn; the others are drawn when a pan
+// brings them into view
+void View::redrawStaticLayer(const World& world)
+{
+    auto& renderer = _window.renderer();
+    const auto& rects = brickRects(world);
+    auto offset = SDL_FPoint{
+        static_cast<float>(_layerOffset.x), static_cast<float>(_layerOffset.y)};
+
+    auto visible = layerArea(SDL_Rect{0, 0, _layerSize.w, _layerSize.h});
+    findBricks(world, std::span{&visible, 1});
+
+    renderer.target(&_staticLayer);
+    renderer.drawColor(0, 0, 0, 0);
     renderer.clear();
+    for (size_t i : _foundBricks) {
+        const auto& sprite = levelSprite(r::Sprite::Brick, rects[i].w);
+        _queue.push(
+            layerStatic,
+            0,
+            *sprite.texture,
+            sprite.frames[_brickAnimations.frame(i)].rect,
+            translated(rects[i], offset));
+    }
+    submitQueue();
+    renderer.drawColor(0, 0, 0, 255);
+    renderer.target(nullptr);
+}
+
+// Clears every dirty rectangle, and draws the live bricks that overlap it
+// back, clipped to the rectangle. Neighbours of a destroyed brick stay
+// intact this way, even if their sprites overlap.
+void View::repairStaticLayer(const World& world)
+{
+    auto& renderer = _window.renderer();
+    const auto& rects = brickRects(world);
+    auto offset = SDL_FPoint{
+        static_cast<float>(_layerOffset.x), static_cast<float>(_layerOffset.y)};
 
-    for (const auto& brick : world.bricks()) {
-        renderer.copy(
-            *brickSprite.texture,
-            brickSprite.frames.front().rect,
-            _camera.project(brick));
+    _dirtyAreas.clear();
+    for (const auto& rect : _dirtyRects) {
+        _dirtyAreas.push_back(layerArea(rect));
     }
+    findBricks(world, _dirtyAreas);
 
-    renderer.copy(
-        *padSprite.texture,
-        padSprite.frames.front().rect,
-        _camera.project(world.pad()));
-    renderer.copy(
-        *ballSprite.texture,
-        ballSprite.frames.front().rect,
-        _camera.project(world.ball()));
+    renderer.target(&_staticLayer);
+
+    // Without blending, the fill replaces pixels with transparent ones
+    renderer.drawColor(0, 0, 0, 0);
+    for (const auto& rect : _dirtyRects) {
+        renderer.fillRect(rect);
+        _stats.drawCalls++;
+    }
+
+    for (size_t i : _foundBricks) {
+        auto projected = translated(rects[i], offset);
+        const auto& sprite = levelSprite(r::Sprite::Brick, projected.w);
+        const auto& frame = sprite.frames[_brickAnimations.frame(i)].rect;
+        for (const auto& rect : _dirtyRects) {
+            if (!intersect(projected, rect)) {
+                continue;
+            }
+            renderer.clipRect(&rect);
+            renderer.copy(*sprite.texture, frame, projected);
+            _stats.drawCalls++;
+        }
+    }
+
+    renderer.clipRect(nullptr);
+    renderer.drawColor(0, 0, 0, 255);
+    renderer.target(nullptr);
+    _stats.dirtyRects = _dirtyRects.size();
+}
+
+// Animated bricks change frames in step, so a cached layer of them would be
+// drawn again every few frames. They go through the queue with the other
+// moving things instead, only the ones on the screen.
+void View::queueBricks(const World& world)
+{
+    const auto& rects = brickRects(world);
+    _replacedRects.clear();
+    auto offset = _camera.translation();
+
+    auto visible = _camera.visibleArea();
+    findBricks(world, std::span{&visible, 1});
+    for (size_t i : _foundBricks) {
+        const auto& sprite = levelSprite(r::Sprite::Brick, rects[i].w);
+        _queue.push(
+            layerStatic,
+            0,
+            *sprite.texture,
+            sprite.frames[_brickAnimations.frame(i)].rect,
+            translated(rects[i], offset));
+    }
+}
 
-    renderer.present();
+// The layer is drawn up to half a pixel away from the screen pixels, so
+// the area takes a pixel more on every side
+Rectangle View::layerArea(const SDL_Rect& layerRect) const
+{
+    return _camera.unproject(SDL_Rect{
+        layerRect.x - 1, layerRect.y - 1, layerRect.w + 2, layerRect.h + 2});
 }
 
+// Looks the areas up in the grid, which holds a brick in every cell it
+// overlaps, so the bricks are sorted to drop repeats. Index order is also
+// the order in which a full redraw draws them. A stream has grids of its
+// own, which follow the chunks it loads.
+void View::findBricks(const World& world, std::span<const Rectangle> areas)
+{
+    auto bricks = world.bricks();
+    auto found = [&] (const Rectangle& area) {
+        return [&world, &bricks, &area, this] (size_t i) {
+            if (world.brickAlive(i) && intersect(bricks[i], area)) {
+                _foundBricks.push_back(i);
+            }
+        };
+    };
+
+    _foundBricks.clear();
+    if (const auto* stream = world.stream()) {
+        for (const auto& area : areas) {
+            stream->forEachNear(
+                area.xmin(), area.xmax(), area.ymin(), area.ymax(),
+                found(area));
+        }
+        std::ranges::sort(_foundBricks);
+        auto repeats = std::ranges::unique(_foundBricks);
+        _foundBricks.erase(repeats.begin(), repeats.end());
+        return;
+    }
+
+    if (!_brickGridValid ||
+            _brickGridGeneration != world.bricksGeneration()) {
+        auto used = std::vector<bool>(bricks.size());
+        for (size_t i = 0; i < bricks.size(); i++) {
+            used[i] = world.brickAlive(i);
+        }
+        for (size_t i = 0; i < world.destroyedBrickCount(); i++) {
+            used[world.destroyedBrick(i)] = true;
+        }
+        _brickGrid.build(bricks, used);
+        _brickGridValid = true;
+        _brickGridGeneration = world.bricksGeneration();
+    }
+
+    for (const auto& area : areas) {
+        _brickGrid.forEach(
+            area.xmin(), area.xmax(), area.ymin(), area.ymax(), found(area));
+    }
+    std::ranges::sort(_foundBricks);
+    auto repeats = std::ranges::unique(_foundBricks);
+    _foundBricks.erase(repeats.begin(), repeats.end());
+}
+
+// Every brick destroyed since the last call breaks into pieces
+void View::emitDebris(const World& world)
+{
+    if (_debrisGeneration != world.bricksGeneration()) {
+        _particles.clear();
+        _debrisGeneration = world.bricksGeneration();
+        _debrisChangesSeen = 0;
+    }
+
+    // Debris of changes that are no longer kept would be late anyway, and a
+    // brick whose chunk was unloaded since is not there to break anymore
+    _debrisChangesSeen = std::max(_debrisChangesSeen, world.oldestBrickChange());
+    for (; _debrisChangesSeen < world.brickChanges(); _debrisChangesSeen++) {
+        auto change = world.brickChange(_debrisChangesSeen);
+        if (change.kind != BrickChange::Kind::State || change.alive ||
+                world.brickUnloadedAfter(change.first, _debrisChangesSeen)) {
+            continue;
+        }
+        const auto& brick = world.bricks()[change.first];
+        auto x = std::uniform_real_distribution{brick.xmin(), brick.xmax()};
+        auto y = std::uniform_real_distribution{brick.ymin(), brick.ymax()};
+        auto speed = std::uniform_real_distribution{2.f, 8.f};
+        auto lifetime = std::uniform_real_distribution{0.4f, 1.2f};
+        for (int j = 0; j < debrisPerBrick; j++) {
+            auto position = Vector{x(_random), y(_random)};
+            auto direction = position - brick.center();
+            if (direction.sqLen() == 0) {
+                direction = {0, 1};
+            }
+            _particles.emit(Particle{
+                .position = position,
+                .velocity = direction.norm() * speed(_random),
+                .lifetime = lifetime(_random),
+                .size = debrisSize,
+                .sprite = 0,
+            });
+        }
+    }
+}
+
+void View::drawParticles()
+{
+    if (_particles.size() == 0) {
+        return;
+    }
+
+    float scale = _camera.scale();
+    const auto& sprite = levelSprite(r::Sprite::Brick, debrisSize * scale);
+    const auto& rect = sprite.frames.front().rect;
+    auto size = sprite.texture->size();
+    auto debris = ParticleSprite{
+        .texture = sprite.texture,
+        .uv = SDL_FRect{
+            static_cast<float>(rect.x) / size.w,
+            static_cast<float>(rect.y) / size.h,
+            static_cast<float>(rect.w) / size.w,
+            static_cast<float>(rect.h) / size.h,
+        },
+    };
+
+    _particles.prepare(
+        std::span{&debris, 1},
+        SDL_FPoint{_camera.projectX(0), _camera.projectY(0)},
+        scale);
+    _particles.submit(_window.renderer());
+    _stats.drawCalls += _particles.batches();
+}
+
+// Fields taller than the screen scroll with the ball. The view moves once
+// the ball is a quarter of the screen away from its center, rather than
+// every frame, so that the static layer scrolls in few, larger steps.
+void View::follow(const World& world)
+{
+    auto visible = _camera.visibleArea();
+    auto field = world.field();
+    float top = std::max(field.ymax() - visible.h(), 0.f);
+    float target = std::clamp(world.ball().center.y - visible.h() / 2, 0.f, top);
+    const auto& pan = _camera.panOffset();
+    if (std::abs(target - pan.y) > visible.h() * followSlack ||
+            (pan.y != target && (target == 0 || target == top))) {
+        _camera.pan({pan.x, target});
+    }
+}
+
+// Instances are rebuilt for a new level, and frame tables for new resources
+void View::syncAnimations(const World& world)
+{
+    if (_animationsResourcesVersion != _resources.version()) {
+        _brickAnimations.setup(_resources.sprites());
+        _dynamicAnimations.setup(_resources.sprites());
+        if (_dynamicAnimations.size() == 0) {
+            _padAnimation = _dynamicAnimations.add(r::Sprite::Platform);
+            _ballAnimation = _dynamicAnimations.add(r::Sprite::Ball);
+        }
+        _animationsResourcesVersion = _resources.version();
+    }
+
+    if (!_brickAnimationsValid ||
+            _brickAnimationsGeneration != world.bricksGeneration()) {
+        _brickAnimations.clear();
+        for (size_t i = 0; i < world.bricks().size(); i++) {
+            _brickAnimations.add(r::Sprite::Brick);
+        }
+        _brickAnimationsValid = true;
+        _brickAnimationsGeneration = world.bricksGeneration();
+    }
+}
+
+// Picks the smallest atlas level that still has at least one texel per screen
+// pixel, judged by the width of the sprite's first frame
+const Sprite& View::levelSprite(r::Sprite spriteId, float screenWidth) const
+{
+    float texelsPerPixel =
+        _resources[spriteId].frames.front().rect.w / screenWidth;
+    size_t level = 0;
+    while (texelsPerPixel >= 2 && level + 1 < _resources.levelCount()) {
+        texelsPerPixel /= 2;
+        level++;
+    }
+    return _resources.sprite(spriteId, level);
+}
+
+// Cached layouts refer to fonts of the current resources
+Text& View::hudText()
+{
+    if (_textResourcesVersion != _resources.version()) {
+        _text.clear();
+        _textResourcesVersion = _resources.version();
+    }
+    return _text;
+}
+
+void View::submitQueue()
+{
+    _queue.submit(_window.renderer());
+    _stats.queue += _queue.stats();
+    _stats.drawCalls += _queue.stats().batches;
+}
+
+// Reprojects all bricks only when the level or the camera scale changed, and
+// otherwise the ranges that a stream loaded; pans are applied by the callers
+// as a translation. The rectangles that unloaded and loaded ranges cover are
+// kept for the static layer to repair.
+const std::vector<SDL_FRect>& View::brickRects(const World& world)
+{
+    if (!_brickRectsValid ||
+            _brickRectsGeneration != world.bricksGeneration() ||
+            _brickRectsChangesSeen < world.oldestBrickChange() ||
+            _brickRectsScaleVersion != _camera.scaleVersion()) {
+        auto bricks = world.bricks();
+        _brickRects.resize(bricks.size());
+        if (_jobs) {
+            _jobs->parallelFor(bricks.size(), projectionGrain, [&] (
+                    size_t begin, size_t end) {
+                _camera.projectUnpanned(
+                    bricks.subspan(begin, end - begin),
+                    std::span{_brickRects}.subspan(begin, end - begin));
+            });
+        } else {
+            _camera.projectUnpanned(bricks, _brickRects);
+        }
+        _brickRectsValid = true;
+        _brickRectsGeneration = world.bricksGeneration();
+        _brickRectsChangesSeen = world.brickChanges();
+        _brickRectsScaleVersion = _camera.scaleVersion();
+        _replacedRects.clear();
+    }
+
+    for (; _brickRectsChangesSeen < world.brickChanges();
+            _brickRectsChangesSeen++) {
+        auto change = world.brickChange(_brickRectsChangesSeen);
+        if (change.kind == BrickChange::Kind::State || change.count == 0) {
+            continue;
+        }
+        auto rects = std::span{_brickRects}.subspan(change.first, change.count);
+        if (change.kind == BrickChange::Kind::Loaded) {
+            _camera.projectUnpanned(
+                world.bricks().subspan(change.first, change.count), rects);
+        }
+        _replacedRects.push_back(boundingRect(rects));
+    }
+    return _brickRects;
+}
\ No newline at end of file
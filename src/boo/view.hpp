@@ -1,12 +1,40 @@
 #pragma once
 
+#include "animation.hpp"
+#include "grid.hpp"
+#include "particles.hpp"
+#include "queue.hpp"
 #include "resources.hpp"
+#include "text.hpp"
 #include "window.hpp"
 #include "world.hpp"
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Maps world coordinates to screen pixels. The field is centered
+// horizontally with its bottom edge at the bottom of the screen; pan() moves
+// the view away from there.
 class Camera {
 public:
     void screenSize(int width, int height);
+    void zoom(float zoom);
+    void pan(const Vector& offset);
+
+    // Pixels per world unit
+    float scale() const;
+    const Vector& panOffset() const;
+    // Part of the world that is on the screen
+    Rectangle visibleArea() const;
+
+    // Screen offset caused by the pan. Projecting without the pan and adding
+    // this gives the same result as projecting directly.
+    SDL_FPoint translation() const;
 
     float projectX(float worldX) const;
     float projectY(float worldY) const;
@@ -14,25 +42,152 @@ public:
     Vector project(const Vector& worldPoint) const;
     SDL_FRect project(const Rectangle& worldRectangle) const;
     SDL_FRect project(const Circle& worldCircle) const;
+    // Part of the world that the screen rectangle shows
+    Rectangle unproject(const SDL_Rect& screenRect) const;
+
+    // Projects a batch of rectangles, leaving out the pan. Both spans must
+    // have the same size.
+    void projectUnpanned(
+        std::span<const Rectangle> worldRectangles,
+        std::span<SDL_FRect> screenRects) const;
+
+    // version() is incremented on every change of the projection,
+    // scaleVersion() only on changes that are not a pure pan
+    uint64_t version() const;
+    uint64_t scaleVersion() const;
 
 private:
     void recalculateCorner();
 
+    uint64_t _version = 0;
+    uint64_t _scaleVersion = 0;
     Vector _worldCorner;
+    Vector _pan;
     int _screenWidth = 0;
     int _screenHeight = 0;
     int _pixelsPerUnit = 32;
-    int _zoom = 1;
+    float _zoom = 1;
+};
+
+// Time spent in each stage of the last rendered frame. The bricks stage only
+// updates the static layer, so it is close to zero when no brick changed, or
+// queues animated bricks; the dynamic stage composes them with pad and ball.
+struct RenderStats {
+    using Duration = std::chrono::steady_clock::duration;
+
+    Duration clear {};
+    Duration bricks {};
+    Duration dynamic {};
+    Duration present {};
+    size_t drawCalls = 0;
+    bool layerRedrawn = false;
+    size_t dirtyRects = 0;
+    RenderQueueStats queue;
+    TextStats text;
 };
 
 class View {
 public:
-    View(Window& window, Resources& resources);
+    // With jobs, large levels are projected in parallel
+    View(Window& window, Resources& resources, JobSystem* jobs = nullptr);
+
+    // Advances sprite animations of the world's objects
+    void animate(const World& world, float deltaSeconds);
+
+    // Draws the world into the back buffer, without presenting it
+    void draw(const World& world);
+    void present();
 
     void render(const World& world);
 
+    // Queues HUD text for the next drawn frame, on top of everything else.
+    // Positions are in screen pixels.
+    void text(r::Font font, std::string_view string, SDL_FPoint position);
+    void text(r::Font font, int64_t number, SDL_FPoint position);
+
+    const RenderStats& stats() const;
+    const Camera& camera() const;
+
+    // Drops the static layer, e.g. after the renderer lost its target textures
+    void invalidate();
+
 private:
+    void follow(const World& world);
+    void syncAnimations(const World& world);
+    void emitDebris(const World& world);
+    void drawParticles();
+    void updateStaticLayer(const World& world);
+    void redrawStaticLayer(const World& world);
+    void scrollStaticLayer(const SDL_Point& offset);
+    void repairStaticLayer(const World& world);
+    void queueBricks(const World& world);
+    Rectangle layerArea(const SDL_Rect& layerRect) const;
+    void findBricks(const World& world, std::span<const Rectangle> areas);
+    const Sprite& levelSprite(r::Sprite spriteId, float screenWidth) const;
+    const std::vector<SDL_FRect>& brickRects(const World& world);
+    void submitQueue();
+    Text& hudText();
+
     Window& _window;
     Resources& _resources;
+    JobSystem* _jobs = nullptr;
     Camera _camera;
+    RenderStats _stats;
+    RenderQueue _queue;
+
+    // Bricks only change when they are destroyed, so they are drawn into a
+    // texture once, and only the rectangles of changed bricks are redrawn.
+    // Bricks with an animated sprite are drawn every frame instead.
+    // A pan moves the pixels by whole pixels, through the second texture,
+    // and only the strips that come into view are drawn.
+    sdl::Texture _staticLayer;
+    sdl::Texture _scrollLayer;
+    Size _layerSize;
+    bool _layerValid = false;
+    uint64_t _layerBricksGeneration = 0;
+    uint64_t _layerScaleVersion = 0;
+    // Translation of the bricks in the layer, the camera's rounded to whole
+    // pixels
+    SDL_Point _layerOffset {};
+    uint64_t _layerResourcesVersion = 0;
+    uint64_t _layerChangesSeen = 0;
+    std::vector<SDL_Rect> _dirtyRects;
+    std::vector<Rectangle> _dirtyAreas;
+
+    // Bricks by where they are, so that drawing the layer only looks at the
+    // ones on the screen. It holds the live bricks and the ones a rollback
+    // can bring back, and is built again for a new generation. Streamed
+    // levels use the grids of the stream instead.
+    RectangleGrid _brickGrid;
+    bool _brickGridValid = false;
+    uint64_t _brickGridGeneration = 0;
+    // Live bricks found by findBricks(), in index order
+    std::vector<size_t> _foundBricks;
+
+    // One instance per brick, and one each for pad and ball
+    Animations _brickAnimations;
+    Animations _dynamicAnimations;
+    size_t _padAnimation = 0;
+    size_t _ballAnimation = 0;
+    bool _brickAnimationsValid = false;
+    uint64_t _brickAnimationsGeneration = 0;
+    uint64_t _animationsResourcesVersion = 0;
+
+    // Debris of destroyed bricks
+    Particles _particles;
+    uint64_t _debrisGeneration = 0;
+    uint64_t _debrisChangesSeen = 0;
+    std::minstd_rand _random;
+
+    Text _text;
+    uint64_t _textResourcesVersion = 0;
+
+    // Unpanned screen rectangles of bricks, parallel to World::bricks(), and
+    // the ones that ranges of a stream covered before and after they changed
+    std::vector<SDL_FRect> _brickRects;
+    bool _brickRectsValid = false;
+    uint64_t _brickRectsGeneration = 0;
+    uint64_t _brickRectsChangesSeen = 0;
+    uint64_t _brickRectsScaleVersion = 0;
+    std::vector<SDL_FRect> _replacedRects;
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "watcher.hpp"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__linux__)
+
+FileWatcher::FileWatcher(std::filesystem::path path)
+    : _path(std::move(path))
+    , _fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+    if (_fd == -1) {
+        throw std::runtime_error{std::format(
+            "inotify_init1: {}", strerrordesc_np(errno))};
+    }
+
+    auto directory = _path.parent_path().empty() ?
+        std::filesystem::path{"."} : _path.parent_path();
+    if (inotify_add_watch(
+            _fd,
+            directory.string().c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1) {
+        int e = errno;
+        close(_fd);
+        throw std::runtime_error{std::format(
+            "cannot watch {}: {}", directory.string(), strerrordesc_np(e))};
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    close(_fd);
+}
+
+bool FileWatcher::changed()
+{
+    alignas(inotify_event) char buffer[4096];
+    auto fileName = _path.filename().string();
+
+    bool fileChanged = false;
+    for (;;) {
+        auto length = read(_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length; ) {
+            const auto* event =
+                reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && fileName == event->name) {
+                fileChanged = true;
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+    return fileChanged;
+}
+
+#else
+
+FileWatcher::FileWatcher(std::filesystem::path path)
+    : _path(std::move(path))
+{
+    auto error = std::error_code{};
+    _lastWriteTime = std::filesystem::last_write_time(_path, error);
+}
+
+FileWatcher::~FileWatcher() = default;
+
+bool FileWatcher::changed()
+{
+    static constexpr auto pollInterval = std::chrono::milliseconds{250};
+
+    auto now = std::chrono::steady_clock::now();
+    if (now < _nextPoll) {
+        return false;
+    }
+    _nextPoll = now + pollInterval;
+
+    auto error = std::error_code{};
+    auto writeTime = std::filesystem::last_write_time(_path, error);
+    if (error || writeTime == _lastWriteTime) {
+        return false;
+    }
+    _lastWriteTime = writeTime;
+    return true;
+}
+
+#endif
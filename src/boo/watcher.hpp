@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+
+// Reports when a file is rewritten. On Linux, the parent directory is watched
+// with inotify, so that files replaced by rename are noticed too. Elsewhere,
+// the modification time is polled a few times per second.
+class FileWatcher {
+public:
+    explicit FileWatcher(std::filesystem::path path);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Non-blocking. Returns true once for every batch of changes since the
+    // previous call.
+    bool changed();
+
+private:
+    std::filesystem::path _path;
+#if defined(__linux__)
+    int _fd = -1;
+#else
+    std::chrono::steady_clock::time_point _nextPoll;
+    std::filesystem::file_time_type _lastWriteTime;
+#endif
+};
\ No newline at end of file
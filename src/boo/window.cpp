@@ -3,15 +3,21 @@
 #include "config.hpp"
 
 Window::Window()
+    : Window(
+        0,
+        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC |
+            SDL_RENDERER_TARGETTEXTURE)
+{ }
+
+Window::Window(uint32_t windowFlags, uint32_t rendererFlags)
     : _window(
         config.windowTitle.c_str(),
         SDL_WINDOWPOS_UNDEFINED,
         SDL_WINDOWPOS_UNDEFINED,
         config.screenWidth,
         config.screenHeight,
-        0)
-    , _renderer(
-        _window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC)
+        windowFlags)
+    , _renderer(_window, -1, rendererFlags)
 { }
 
 Size Window::size()
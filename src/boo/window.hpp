@@ -10,6 +10,7 @@ struct Size {
 class Window {
 public:
     Window();
+    Window(uint32_t windowFlags, uint32_t rendererFlags);
 
     Size size();
 
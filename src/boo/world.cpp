@@ -1,50 +1,803 @@
 #include "world.hpp"
 
-#include "collision.hpp"
+#include "grid.hpp"
+#include "jobs.hpp"
+#include "stream.hpp"
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <format>
+#include <stdexcept>
+#include <utility>
 
-void World::setupTestLevel()
+namespace {
+
+constexpr int maxBouncesPerUpdate = 8;
+
+template <Scalar T>
+uint64_t bits(T value)
+{
+    if constexpr (std::same_as<T, Fixed>) {
+        return static_cast<uint32_t>(value.raw());
+    } else if constexpr (std::same_as<T, float>) {
+        return std::bit_cast<uint32_t>(value);
+    } else {
+        return std::bit_cast<uint64_t>(value);
+    }
+}
+
+uint64_t hashCombine(uint64_t hash, uint64_t value)
+{
+    hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+} // namespace
+
+template <Scalar T>
+BasicWorld<T>::BasicWorld()
+{
+    _ball = _bodies.create(BasicCircle<T>{}, Velocity<T>{});
+    for (size_t player = 0; player < maxPlayers; player++) {
+        _pads[player] = _bodies.create(
+            Pad{player}, BasicRectangle<T>{{0, 2}, 5, 1});
+    }
+}
+
+template <Scalar T>
+void BasicWorld<T>::setupLevel(
+    std::vector<BasicRectangle<T>> bricks, size_t players)
+{
+    _ownedBricks = std::make_shared<const std::vector<BasicRectangle<T>>>(
+        std::move(bricks));
+    _bricks = *_ownedBricks;
+    _grid = Grid{};
+    _stream = nullptr;
+    setField(-12, 12, 0, 20);
+    setupBricks(players);
+}
+
+template <Scalar T>
+void BasicWorld<T>::setupLevel(
+    std::span<const BasicRectangle<T>> bricks,
+    const BrickGrid& grid,
+    size_t players)
+{
+    if (!grid.cellStarts.empty() && (grid.cellSize <= 0 ||
+            grid.cellStarts.size() != size_t{grid.columns} * grid.rows + 1 ||
+            grid.cellStarts.back() != bricks.size())) {
+        throw std::runtime_error{"World: brick grid does not match the bricks"};
+    }
+
+    _ownedBricks.reset();
+    _bricks = bricks;
+    _grid = grid.cellStarts.empty() ? Grid{} : makeGrid(grid);
+    _stream = nullptr;
+    setField(-12, 12, 0, 20);
+    setupBricks(players);
+}
+
+template <Scalar T>
+void BasicWorld<T>::setupLevel(LevelStream& stream, size_t players)
+    requires std::same_as<T, float>
+{
+    _ownedBricks.reset();
+    _bricks = stream.bricks();
+    _grid = Grid{};
+    _stream = &stream;
+    for (auto& [chunk, destroyed] : _destroyedInChunks) {
+        _spareDestroyed.push_back(std::move(destroyed));
+    }
+    _destroyedInChunks.clear();
+    _swaps.clear();
+    const auto& field = stream.field();
+    setField(field.xmin(), field.xmax(), field.ymin(), field.ymax());
+    setupBricks(players);
+
+    // Slots may still hold chunks of an earlier level on the same stream
+    _bricksAlive.assign(_bricks.size(), false);
+    for (size_t slot = 0; slot < stream.slots(); slot++) {
+        auto cellStarts = stream.slotGrid(slot).cellStarts;
+        if (!cellStarts.empty()) {
+            std::fill_n(
+                _bricksAlive.begin() + slot * stream.slotBricks(),
+                cellStarts.back(),
+                true);
+        }
+    }
+    _liveBricks = static_cast<size_t>(std::ranges::count(_bricksAlive, true));
+}
+
+template <Scalar T>
+void BasicWorld<T>::focus(std::span<const BasicRectangle<T>> areas)
 {
-    _bricks = {
-        Rectangle{{-10, 15}, 2, 1},
-        Rectangle{{-8, 13}, 2, 1},
-        Rectangle{{0, 13}, 2, 1},
-        Rectangle{{5, 16}, 2, 1},
+    _focus.assign(areas.begin(), areas.end());
+}
+
+template <Scalar T>
+auto BasicWorld<T>::makeGrid(const BrickGrid& grid) -> Grid
+{
+    auto cellSize = static_cast<T>(grid.cellSize);
+    return Grid{
+        .origin = {
+            static_cast<T>(grid.origin.x), static_cast<T>(grid.origin.y)},
+        .cellSize = cellSize,
+        .columns = grid.columns,
+        .rows = grid.rows,
+        .reach = static_cast<T>(grid.margin) + cellSize / 64,
+        .cellStarts = grid.cellStarts,
     };
 }
 
-void World::update(float delta)
+template <Scalar T>
+void BasicWorld<T>::setupBricks(size_t players)
+{
+    // Pads keep their positions across levels, unless their ranges change
+    players = std::clamp<size_t>(players, 1, maxPlayers);
+    if (players != _players) {
+        _players = players;
+        for (size_t player = 0; player < _players; player++) {
+            setPadPosition(player, T{1} / 2);
+        }
+    }
+    _bricksAlive.assign(_bricks.size(), true);
+    _liveBricks = _bricks.size();
+    _bricksGeneration++;
+    clearBrickChanges();
+    size_t slots = _stream ? _stream->slots() : 0;
+    _slotHistory.assign(slots, 0);
+    _slotUnloaded.assign(slots, 0);
+    startHistory();
+    _destroyedBricks.reserve(_bricks.size());
+    resetBall();
+}
+
+template <Scalar T>
+void BasicWorld<T>::setField(T minx, T maxx, T miny, T maxy)
 {
-    auto bestCollision = Collision{};
+    bool changed = minx != _minx || maxx != _maxx;
+    _minx = minx;
+    _maxx = maxx;
+    _miny = miny;
+    _maxy = maxy;
+
+    // Pads stay at the same height above the bottom, within the new width
+    for (size_t player = 0; player < maxPlayers; player++) {
+        auto& pad = _bodies.get<BasicRectangle<T>>(_pads[player]);
+        pad.moveTo({pad.center().x, _miny + 2});
+    }
+    if (changed) {
+        for (size_t player = 0; player < _players; player++) {
+            setPadPosition(player, T{1} / 2);
+        }
+    }
+}
+
+template <Scalar T>
+void BasicWorld<T>::setupTestLevel(size_t players)
+{
+    setupLevel({
+        BasicRectangle<T>{{-10, 15}, 2, 1},
+        BasicRectangle<T>{{-8, 13}, 2, 1},
+        BasicRectangle<T>{{0, 13}, 2, 1},
+        BasicRectangle<T>{{5, 16}, 2, 1},
+    }, players);
+}
+
+template <Scalar T>
+void BasicWorld<T>::setJobs(JobSystem* jobs)
+{
+    _jobs = jobs;
+}
+
+template <Scalar T>
+void BasicWorld<T>::update(T delta)
+{
+    auto& ball = _bodies.get<BasicCircle<T>>(_ball);
+    auto& velocity = _bodies.get<Velocity<T>>(_ball).value;
+    if (velocity.x == T{0} && velocity.y == T{0}) {
+        return;
+    }
+    if (_stream) {
+        streamChunks(delta);
+    }
+
+    auto walls = this->walls();
+
+    // Obstacle ids: bricks by index, then the pads, then the walls
+    T remaining = delta;
+    for (int bounce = 0;
+            bounce < maxBouncesPerUpdate && remaining > T{0};
+            bounce++) {
+        auto nearest = nearestBrick(remaining);
+        auto bestCollision = nearest.collision;
+        size_t bestObstacle = nearest.brick;
+        auto check = [&] (size_t obstacle, const BasicRectangle<T>& rectangle) {
+            if (obstacle == _lastObstacle) {
+                return;
+            }
+            auto c = collision(ball, velocity, rectangle);
+            if (c < bestCollision) {
+                bestCollision = c;
+                bestObstacle = obstacle;
+            }
+        };
 
-    for (const auto& brick : _bricks) {
-        auto c = collision(_ball, _ballVelocity, brick);
-        if (c < bestCollision) {
-            bestCollision = c;
+        _padQuery.each(_bodies, [&] (
+                const Pad& pad, const BasicRectangle<T>& rectangle) {
+            if (pad.player < _players) {
+                check(padId(pad.player), rectangle);
+            }
+        });
+        for (size_t i = 0; i < walls.size(); i++) {
+            check(padId(_players) + i, walls[i]);
+        }
+
+        if (!bestCollision || bestCollision.time > remaining) {
+            ball.center += velocity * remaining;
+            break;
+        }
+
+        ball.center += velocity * bestCollision.time;
+        velocity = reflect(velocity, bestCollision.norm);
+        remaining -= bestCollision.time;
+        _lastObstacle = bestObstacle;
+        if (bestObstacle < _bricks.size()) {
+            destroyBrick(bestObstacle);
         }
     }
+
+    if (ball.center.y + ball.radius < _miny) {
+        resetBall();
+    }
+}
+
+template <Scalar T>
+void BasicWorld<T>::setPadPosition(T pos)
+{
+    setPadPosition(0, pos);
 }
 
-void World::setPadPosition(float pos)
+template <Scalar T>
+void BasicWorld<T>::setPadPosition(size_t player, T pos)
 {
-    pos = std::clamp(pos, 0.f, 1.f);
-    float padMinX = _minx + _pad.w() / 2;
-    float padMaxX = _maxx - _pad.w() / 2;
-    _pad.moveTo({padMinX * (1 - pos) + padMaxX * pos, _pad.center().y});
+    auto& pad = _bodies.get<BasicRectangle<T>>(_pads.at(player));
+    T rangeWidth = (_maxx - _minx) / static_cast<T>(static_cast<int>(_players));
+    T rangeMinX = _minx + rangeWidth * static_cast<T>(static_cast<int>(player));
+
+    pos = std::clamp(pos, T{0}, T{1});
+    T padMinX = rangeMinX + pad.w() / 2;
+    T padMaxX = rangeMinX + rangeWidth - pad.w() / 2;
+    pad.moveTo({padMinX * (T{1} - pos) + padMaxX * pos, pad.center().y});
 }
 
-const std::vector<Rectangle>& World::bricks() const
+template <Scalar T>
+BasicRectangle<T> BasicWorld<T>::field() const
+{
+    return BasicRectangle<T>{
+        {_minx + (_maxx - _minx) / 2, _miny + (_maxy - _miny) / 2},
+        _maxx - _minx,
+        _maxy - _miny};
+}
+
+template <Scalar T>
+auto BasicWorld<T>::walls() const -> std::array<BasicRectangle<T>, 3>
+{
+    T height = _maxy - _miny;
+    T width = _maxx - _minx;
+    return {
+        BasicRectangle<T>{{_minx - 1, _miny + height / 2}, 2, height + 4},
+        BasicRectangle<T>{{_maxx + 1, _miny + height / 2}, 2, height + 4},
+        BasicRectangle<T>{{_minx + width / 2, _maxy + 1}, width + 4, 2},
+    };
+}
+
+template <Scalar T>
+std::span<const BasicRectangle<T>> BasicWorld<T>::bricks() const
 {
     return _bricks;
 }
 
-const Rectangle& World::pad() const
+template <Scalar T>
+bool BasicWorld<T>::brickAlive(size_t brickIndex) const
+{
+    return _bricksAlive[brickIndex];
+}
+
+template <Scalar T>
+size_t BasicWorld<T>::liveBricks() const
+{
+    return _liveBricks;
+}
+
+template <Scalar T>
+const LevelStream* BasicWorld<T>::stream() const
+{
+    return _stream;
+}
+
+template <Scalar T>
+uint64_t BasicWorld<T>::bricksGeneration() const
+{
+    return _bricksGeneration;
+}
+
+template <Scalar T>
+uint64_t BasicWorld<T>::brickChanges() const
+{
+    return _brickChangeCount;
+}
+
+template <Scalar T>
+uint64_t BasicWorld<T>::oldestBrickChange() const
+{
+    return _brickChangeCount - _brickChanges.size();
+}
+
+template <Scalar T>
+BrickChange BasicWorld<T>::brickChange(uint64_t change) const
+{
+    if (change < oldestBrickChange() || change >= _brickChangeCount) {
+        throw std::runtime_error{std::format(
+            "World: brick change {} is not kept, only {} to {}",
+            change, oldestBrickChange(), _brickChangeCount)};
+    }
+    return _brickChanges[change % maxBrickChanges];
+}
+
+template <Scalar T>
+bool BasicWorld<T>::brickUnloadedAfter(size_t brickIndex, uint64_t change) const
+{
+    return _stream &&
+        _slotUnloaded[brickIndex / _stream->slotBricks()] > change + 1;
+}
+
+template <Scalar T>
+size_t BasicWorld<T>::destroyedBrickCount() const
+{
+    return _destroyedBricks.size();
+}
+
+template <Scalar T>
+size_t BasicWorld<T>::destroyedBrick(size_t order) const
+{
+    return _destroyedBricks.at(order).brick;
+}
+
+template <Scalar T>
+size_t BasicWorld<T>::players() const
+{
+    return _players;
+}
+
+template <Scalar T>
+Registry& BasicWorld<T>::bodies()
+{
+    return _bodies;
+}
+
+template <Scalar T>
+const Registry& BasicWorld<T>::bodies() const
 {
-    return _pad;
+    return _bodies;
 }
 
-const Circle& World::ball() const
+template <Scalar T>
+const BasicRectangle<T>& BasicWorld<T>::pad(size_t player) const
 {
-    return _ball;
+    return _bodies.get<BasicRectangle<T>>(_pads.at(player));
 }
+
+template <Scalar T>
+const BasicCircle<T>& BasicWorld<T>::ball() const
+{
+    return _bodies.get<BasicCircle<T>>(_ball);
+}
+
+template <Scalar T>
+const BasicVector<T>& BasicWorld<T>::ballVelocity() const
+{
+    return _bodies.get<Velocity<T>>(_ball).value;
+}
+
+template <Scalar T>
+size_t BasicWorld<T>::lastObstacle() const
+{
+    return _lastObstacle;
+}
+
+template <Scalar T>
+uint64_t BasicWorld<T>::stateHash() const
+{
+    const auto& ball = this->ball();
+    const auto& velocity = ballVelocity();
+    const auto& firstPad = pad(0);
+    uint64_t hash = 0;
+    for (T value : {
+            ball.center.x, ball.center.y, ball.radius,
+            velocity.x, velocity.y,
+            firstPad.xmin(), firstPad.xmax(), firstPad.ymin(), firstPad.ymax()}) {
+        hash = hashCombine(hash, bits(value));
+    }
+    for (size_t player = 1; player < _players; player++) {
+        const auto& pad = this->pad(player);
+        for (T value : {pad.xmin(), pad.xmax(), pad.ymin(), pad.ymax()}) {
+            hash = hashCombine(hash, bits(value));
+        }
+    }
+    for (size_t i = 0; i < _bricks.size(); i++) {
+        hash = hashCombine(hash, _bricksAlive[i]);
+    }
+    return hashCombine(hash, _lastObstacle);
+}
+
+template <Scalar T>
+BasicWorldSnapshot<T> BasicWorld<T>::snapshot() const
+{
+    auto result = BasicWorldSnapshot<T>{
+        .history = _history,
+        .destroyedBricks = _destroyedApplied,
+        .destroyedHash = destroyedHash(_destroyedApplied),
+        .lastObstacle = _lastObstacle,
+        .ball = ball(),
+        .ballVelocity = ballVelocity(),
+        .pads = {},
+    };
+    for (size_t player = 0; player < maxPlayers; player++) {
+        result.pads[player] = pad(player);
+    }
+    return result;
+}
+
+template <Scalar T>
+bool BasicWorld<T>::canRestore(const BasicWorldSnapshot<T>& snapshot) const
+{
+    return snapshot.history == _history &&
+        snapshot.destroyedBricks <= _destroyedBricks.size() &&
+        destroyedHash(snapshot.destroyedBricks) == snapshot.destroyedHash;
+}
+
+template <Scalar T>
+void BasicWorld<T>::restore(const BasicWorldSnapshot<T>& snapshot)
+{
+    if (!canRestore(snapshot)) {
+        throw std::runtime_error{
+            "World: snapshot is from another level or another history"};
+    }
+
+    while (_destroyedApplied > snapshot.destroyedBricks) {
+        auto brick = _destroyedBricks[--_destroyedApplied].brick;
+        _bricksAlive[brick] = true;
+        _liveBricks++;
+        changeBrick(brick);
+    }
+    while (_destroyedApplied < snapshot.destroyedBricks) {
+        auto brick = _destroyedBricks[_destroyedApplied++].brick;
+        _bricksAlive[brick] = false;
+        _liveBricks--;
+        changeBrick(brick);
+    }
+
+    _lastObstacle = static_cast<size_t>(snapshot.lastObstacle);
+    _bodies.get<BasicCircle<T>>(_ball) = snapshot.ball;
+    _bodies.get<Velocity<T>>(_ball).value = snapshot.ballVelocity;
+    for (size_t player = 0; player < maxPlayers; player++) {
+        _bodies.get<BasicRectangle<T>>(_pads[player]) = snapshot.pads[player];
+    }
+}
+
+template <Scalar T>
+auto BasicWorld<T>::nearestBrick(size_t begin, size_t end) const -> BrickHit
+{
+    const auto& ball = this->ball();
+    const auto& velocity = ballVelocity();
+    auto hit = BrickHit{};
+    for (size_t i = begin; i < end; i++) {
+        if (!_bricksAlive[i] || i == _lastObstacle) {
+            continue;
+        }
+        auto c = collision(ball, velocity, _bricks[i]);
+        if (c < hit.collision) {
+            hit = BrickHit{.collision = c, .brick = i};
+        }
+    }
+    return hit;
+}
+
+// Checks the cells that the ball's bounding box sweeps over within the given
+// time, widened by the reach. Cells are visited in the order of the bricks,
+// so ties go to the lowest index, as in a check of all bricks. Cell starts
+// are relative to base.
+template <Scalar T>
+auto BasicWorld<T>::nearestBrickInGrid(
+    const Grid& grid, size_t base, T within) const -> BrickHit
+{
+    const auto& ball = this->ball();
+    auto end = ball.center + ballVelocity() * within;
+    T reach = ball.radius + grid.reach;
+    auto [firstColumn, lastColumn] = cellRange(
+        std::min(ball.center.x, end.x) - reach,
+        std::max(ball.center.x, end.x) + reach,
+        grid.origin.x, grid.cellSize, grid.columns);
+    auto [firstRow, lastRow] = cellRange(
+        std::min(ball.center.y, end.y) - reach,
+        std::max(ball.center.y, end.y) + reach,
+        grid.origin.y, grid.cellSize, grid.rows);
+    if (firstColumn > lastColumn || firstRow > lastRow) {
+        return {};
+    }
+
+    auto hit = BrickHit{};
+    for (size_t row = firstRow; row <= lastRow; row++) {
+        size_t cell = row * grid.columns;
+        auto nearest = nearestBrick(
+            base + grid.cellStarts[cell + firstColumn],
+            base + grid.cellStarts[cell + lastColumn + 1]);
+        if (nearest.collision < hit.collision) {
+            hit = nearest;
+        }
+    }
+    return hit;
+}
+
+// Chunks that the ball can reach are loaded right away if the stream has
+// not loaded them yet. They are visited in the order of the level, not of
+// the slots, so ties do not depend on where chunks were loaded.
+template <Scalar T>
+auto BasicWorld<T>::nearestBrickInStream(T within) -> BrickHit
+{
+    auto hit = BrickHit{};
+    if constexpr (std::same_as<T, float>) {
+        const auto& layout = _stream->layout();
+        const auto& ball = this->ball();
+        auto end = ball.center + ballVelocity() * within;
+        T reach = ball.radius + layout.margin + layout.size / 64;
+        auto [firstColumn, lastColumn] = cellRange(
+            std::min(ball.center.x, end.x) - reach,
+            std::max(ball.center.x, end.x) + reach,
+            layout.origin.x, layout.size, layout.columns);
+        auto [firstRow, lastRow] = cellRange(
+            std::min(ball.center.y, end.y) - reach,
+            std::max(ball.center.y, end.y) + reach,
+            layout.origin.y, layout.size, layout.rows);
+
+        for (uint32_t row = firstRow; row <= lastRow; row++) {
+            for (uint32_t column = firstColumn; column <= lastColumn; column++) {
+                uint32_t chunk = row * layout.columns + column;
+                if (_stream->chunkBricks(chunk) == 0) {
+                    continue;
+                }
+                size_t slot = _stream->require(chunk, _swaps);
+                applySwaps();
+                auto nearest = nearestBrickInGrid(
+                    makeGrid(_stream->slotGrid(slot)),
+                    slot * _stream->slotBricks(),
+                    within);
+                if (nearest.collision < hit.collision) {
+                    hit = nearest;
+                }
+            }
+        }
+    }
+    return hit;
+}
+
+// Ranges are combined in index order, with the same comparison as within a
+// range, so ties go to the lowest index whatever the number of workers
+template <Scalar T>
+auto BasicWorld<T>::nearestBrick(T within) -> BrickHit
+{
+    if (_stream) {
+        return nearestBrickInStream(within);
+    }
+    if (!_grid.cellStarts.empty()) {
+        return nearestBrickInGrid(_grid, 0, within);
+    }
+
+    size_t count = _bricks.size();
+    if (!_jobs || count < parallelBricks) {
+        return nearestBrick(0, count);
+    }
+
+    _brickHits.resize((count + bricksPerJob - 1) / bricksPerJob);
+    _jobs->parallelFor(_brickHits.size(), 1, [this, count] (
+            size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            _brickHits[i] = nearestBrick(
+                i * bricksPerJob, std::min(count, (i + 1) * bricksPerJob));
+        }
+    });
+
+    auto hit = BrickHit{};
+    for (const auto& rangeHit : _brickHits) {
+        if (rangeHit.collision < hit.collision) {
+            hit = rangeHit;
+        }
+    }
+    return hit;
+}
+
+// The stream keeps the chunks that the ball can reach within the tick, and
+// prefetches around them and the focus areas
+template <Scalar T>
+void BasicWorld<T>::streamChunks(T delta)
+{
+    if constexpr (std::same_as<T, float>) {
+        const auto& ball = this->ball();
+        T travel = ballVelocity().len() * delta + ball.radius;
+        _streamAreas.assign(_focus.begin(), _focus.end());
+        _streamAreas.push_back(
+            BasicRectangle<T>{ball.center, 2 * travel, 2 * travel});
+        _stream->focus(_streamAreas);
+        _stream->poll(_swaps);
+        applySwaps();
+    }
+}
+
+// Destroyed bricks of an evicted chunk are kept by chunk-relative index, and
+// applied again when the chunk is loaded. Only the slot's range changes, and
+// the live count with it. The destroyed history refers to bricks by index,
+// so it starts over when a slot that has bricks in it is evicted; snapshots
+// taken before other swaps can still be restored.
+template <Scalar T>
+void BasicWorld<T>::applySwaps()
+{
+    if constexpr (std::same_as<T, float>) {
+        size_t slotBricks = _stream->slotBricks();
+        for (const auto& swap : _swaps) {
+            size_t base = swap.slot * slotBricks;
+            auto first = static_cast<uint32_t>(base);
+            if (swap.evicted != ChunkSwap::noChunk) {
+                std::vector<uint32_t>* destroyed = nullptr;
+                for (uint32_t i = 0; i < swap.evictedBricks; i++) {
+                    if (_bricksAlive[base + i]) {
+                        _liveBricks--;
+                        continue;
+                    }
+                    if (!destroyed) {
+                        destroyed = &_destroyedInChunks[swap.evicted];
+                        if (!_spareDestroyed.empty()) {
+                            *destroyed = std::move(_spareDestroyed.back());
+                            _spareDestroyed.pop_back();
+                            destroyed->clear();
+                        }
+                    }
+                    destroyed->push_back(i);
+                }
+                std::fill_n(_bricksAlive.begin() + base, swap.evictedBricks, false);
+                logBrickChange(BrickChange{
+                    .first = first,
+                    .count = swap.evictedBricks,
+                    .kind = BrickChange::Kind::Unloaded,
+                });
+                _slotUnloaded[swap.slot] = _brickChangeCount;
+                if (_slotHistory[swap.slot] > 0) {
+                    startHistory();
+                }
+            }
+
+            std::fill_n(_bricksAlive.begin() + base, swap.loadedBricks, true);
+            _liveBricks += swap.loadedBricks;
+            if (auto it = _destroyedInChunks.find(swap.loaded);
+                    it != _destroyedInChunks.end()) {
+                for (uint32_t i : it->second) {
+                    _bricksAlive[base + i] = false;
+                }
+                _liveBricks -= it->second.size();
+                _spareDestroyed.push_back(std::move(it->second));
+                _destroyedInChunks.erase(it);
+            }
+            logBrickChange(BrickChange{
+                .first = first,
+                .count = swap.loadedBricks,
+                .kind = BrickChange::Kind::Loaded,
+            });
+
+            if (_lastObstacle >= base && _lastObstacle < base + slotBricks) {
+                _lastObstacle = noObstacle;
+            }
+        }
+    }
+    _swaps.clear();
+}
+
+template <Scalar T>
+void BasicWorld<T>::resetBall()
+{
+    T radius = T{1} / 2;
+    _bodies.get<BasicCircle<T>>(_ball) = BasicCircle<T>{
+        .center = {pad().center().x, pad().ymax() + radius},
+        .radius = radius,
+    };
+    _bodies.get<Velocity<T>>(_ball).value = {4, 8};
+
+    // The ball starts touching the pad
+    _lastObstacle = padId();
+}
+
+template <Scalar T>
+size_t BasicWorld<T>::padId(size_t player) const
+{
+    return _bricks.size() + player;
+}
+
+// The ring fills up to its size, and after that the oldest change is
+// overwritten, so its slots keep the order of the changes modulo the size
+template <Scalar T>
+void BasicWorld<T>::changeBrick(size_t brickIndex)
+{
+    logBrickChange(BrickChange{
+        .first = static_cast<uint32_t>(brickIndex),
+        .alive = _bricksAlive[brickIndex],
+    });
+}
+
+template <Scalar T>
+void BasicWorld<T>::logBrickChange(const BrickChange& change)
+{
+    if (_brickChanges.size() < maxBrickChanges) {
+        _brickChanges.push_back(change);
+    } else {
+        _brickChanges[_brickChangeCount % maxBrickChanges] = change;
+    }
+    _brickChangeCount++;
+}
+
+template <Scalar T>
+void BasicWorld<T>::clearBrickChanges()
+{
+    _brickChanges.clear();
+    _brickChangeCount = 0;
+}
+
+template <Scalar T>
+void BasicWorld<T>::startHistory()
+{
+    _history++;
+    _destroyedBricks.clear();
+    _destroyedApplied = 0;
+    std::ranges::fill(_slotHistory, 0);
+}
+
+// When the simulation follows the recorded history, e.g. when resimulating
+// after a rollback with the same input, the history is kept. Otherwise the
+// rest of it is dropped, and snapshots taken on it can no longer be restored.
+template <Scalar T>
+void BasicWorld<T>::destroyBrick(size_t brickIndex)
+{
+    _bricksAlive[brickIndex] = false;
+    _liveBricks--;
+    changeBrick(brickIndex);
+
+    if (_destroyedApplied < _destroyedBricks.size() &&
+            _destroyedBricks[_destroyedApplied].brick == brickIndex) {
+        _destroyedApplied++;
+        return;
+    }
+
+    if (_stream) {
+        size_t slotBricks = _stream->slotBricks();
+        for (size_t i = _destroyedApplied; i < _destroyedBricks.size(); i++) {
+            _slotHistory[_destroyedBricks[i].brick / slotBricks]--;
+        }
+        _slotHistory[brickIndex / slotBricks]++;
+    }
+    _destroyedBricks.resize(_destroyedApplied);
+    _destroyedBricks.push_back(DestroyedBrick{
+        .brick = static_cast<uint32_t>(brickIndex),
+        .hash = hashCombine(destroyedHash(_destroyedApplied), brickIndex),
+    });
+    _destroyedApplied++;
+}
+
+template <Scalar T>
+uint64_t BasicWorld<T>::destroyedHash(size_t count) const
+{
+    return count == 0 ? 0 : _destroyedBricks[count - 1].hash;
+}
+
+template class BasicWorld<float>;
+template class BasicWorld<Fixed>;
@@ -1,28 +1,297 @@
 #pragma once
 
+#include "collision.hpp"
+#include "ecs.hpp"
+#include "fixed.hpp"
 #include "geometry.hpp"
 
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
-class World {
+class JobSystem;
+class LevelStream;
+
+inline constexpr size_t maxPlayers = 2;
+
+// Uniform grid over the bricks of a level, as stored in level files. Bricks
+// are sorted by the cell that holds their center, row by row, and the bricks
+// of cell i are the ones from cellStarts[i] up to cellStarts[i + 1]. A grid
+// without cells means the bricks are in no particular order.
+struct BrickGrid {
+    Vector origin;
+    float cellSize = 0;
+    uint32_t columns = 0;
+    uint32_t rows = 0;
+    // Largest distance from the center of a brick to its edge, along x or y
+    float margin = 0;
+    std::span<const uint32_t> cellStarts;
+};
+
+// A brick that was destroyed or brought back, or a range of bricks that a
+// stream unloaded or loaded. The bricks of an unloaded range are gone from
+// wherever they were, and the ones of a loaded range are new, anywhere.
+struct BrickChange {
+    enum class Kind : uint8_t {
+        State,
+        Unloaded,
+        Loaded,
+    };
+
+    uint32_t first = 0;
+    uint32_t count = 1;
+    Kind kind = Kind::State;
+    // Whether the brick is alive after a change of its state
+    bool alive = false;
+};
+
+// A slot of a LevelStream that changed chunks. The slot's bricks now belong
+// to the loaded chunk.
+struct ChunkSwap {
+    static constexpr uint32_t noChunk = UINT32_MAX;
+
+    size_t slot = 0;
+    uint32_t evicted = noChunk;
+    uint32_t evictedBricks = 0;
+    uint32_t loaded = noChunk;
+    uint32_t loadedBricks = 0;
+};
+
+// Components of the bodies that move in a world. The ball is a circle with
+// a velocity; a pad is a rectangle that belongs to a player.
+template <Scalar T>
+struct Velocity {
+    BasicVector<T> value;
+};
+
+struct Pad {
+    size_t player = 0;
+};
+
+// Simulation state at one tick, for rollback and for seeking in replays. It
+// has a fixed size and is trivially copyable, so a ring of them can be kept
+// for every tick. Bricks are not copied: the world keeps the order in which
+// bricks were destroyed in the level, and a snapshot records how far into
+// that history it was taken, with a hash to check that the history still
+// matches. The history starts over with a new level, and when a stream
+// unloads a slot that has bricks in it.
+template <Scalar T>
+struct BasicWorldSnapshot {
+    uint64_t history = 0;
+    uint64_t destroyedBricks = 0;
+    uint64_t destroyedHash = 0;
+    uint64_t lastObstacle = 0;
+    BasicCircle<T> ball;
+    BasicVector<T> ballVelocity;
+    std::array<BasicRectangle<T>, maxPlayers> pads;
+};
+
+// The simulation is a template on the scalar type. The game runs World, on
+// floats. FixedWorld runs on Fixed and gives bit-identical results on every
+// build, which lockstep networking and replays rely on.
+template <Scalar T>
+class BasicWorld {
 public:
-    void setupTestLevel();
+    static constexpr size_t maxBrickChanges = 4096;
+
+    BasicWorld();
+
+    // With two players, each pad moves in its own half of the field
+    void setupLevel(std::vector<BasicRectangle<T>> bricks, size_t players = 1);
+    // Uses the bricks and the grid in place, e.g. from a mapped level file, so
+    // they must outlive the level. With a grid, the ball only checks bricks
+    // in the cells it can reach.
+    void setupLevel(
+        std::span<const BasicRectangle<T>> bricks,
+        const BrickGrid& grid,
+        size_t players = 1);
+    // Streams a chunked level, and takes its field. Chunks around the ball
+    // and the focus areas are kept in memory, and bricks destroyed in a
+    // chunk stay destroyed when it comes back. Chunks replace the bricks of
+    // the slots they are loaded into, which is reported as brick changes of
+    // the slots' ranges; the generation stays. The stream must outlive the
+    // level.
+    void setupLevel(LevelStream& stream, size_t players = 1)
+        requires std::same_as<T, float>;
+    void setupTestLevel(size_t players = 1);
+
+    // Areas to stream in besides the surroundings of the ball, e.g. what the
+    // camera shows
+    void focus(std::span<const BasicRectangle<T>> areas);
+
+    // Levels with many bricks check them for collisions in parallel. The
+    // results are the same as without jobs.
+    void setJobs(JobSystem* jobs);
+
+    void update(T delta);
+    // From 0 at the left end of the pad's range to 1 at the right end
+    void setPadPosition(T pos);
+    void setPadPosition(size_t player, T pos);
+
+    BasicRectangle<T> field() const;
+    // Thick rectangles just outside of the field, at the left, right and top
+    std::array<BasicRectangle<T>, 3> walls() const;
+    std::span<const BasicRectangle<T>> bricks() const;
+    bool brickAlive(size_t brickIndex) const;
+    size_t liveBricks() const;
+    // The stream of a streamed level, or null
+    const LevelStream* stream() const;
 
-    void update(float delta);
-    void setPadPosition(float pos);
+    // Bricks change in two ways. A new level replaces all of them, and
+    // increments the generation. Within a level, changes are numbered from
+    // zero, and observers catch up from the number they saw last, up to
+    // brickChanges(). Only the last maxBrickChanges changes are kept: an
+    // observer that fell further behind, i.e. whose number is below
+    // oldestBrickChange(), has to look at all bricks again.
+    uint64_t bricksGeneration() const;
+    uint64_t brickChanges() const;
+    uint64_t oldestBrickChange() const;
+    BrickChange brickChange(uint64_t change) const;
+    // Whether the brick's range was unloaded after the change, so that the
+    // brick at its index is another one now
+    bool brickUnloadedAfter(size_t brickIndex, uint64_t change) const;
 
-    const std::vector<Rectangle>& bricks() const;
-    const Rectangle& pad() const;
-    const Circle& ball() const;
+    // Bricks destroyed in the current history, in order, including the ones
+    // that a rollback brought back. Restoring a snapshot of the history only
+    // ever revives bricks from this list.
+    size_t destroyedBrickCount() const;
+    size_t destroyedBrick(size_t order) const;
+
+    size_t players() const;
+    // Moving bodies, as entities. Components may be added to them, and
+    // bodies of new kinds added, without changes to the world.
+    Registry& bodies();
+    const Registry& bodies() const;
+    const BasicRectangle<T>& pad(size_t player = 0) const;
+    const BasicCircle<T>& ball() const;
+    const BasicVector<T>& ballVelocity() const;
+
+    // Obstacles are numbered: bricks by index, then the pads, then the walls.
+    // The ball cannot hit the obstacle it bounced off last again right away.
+    // SIZE_MAX means there is none.
+    size_t lastObstacle() const;
+
+    // Hash of the whole simulation state, for comparing runs
+    uint64_t stateHash() const;
+
+    // Restoring costs one write per brick destroyed between the snapshot and
+    // the current state, and restored bricks are reported as brick changes.
+    // Snapshots from later ticks can be restored too, as long as the
+    // simulation has not taken a different path since they were taken.
+    BasicWorldSnapshot<T> snapshot() const;
+    bool canRestore(const BasicWorldSnapshot<T>& snapshot) const;
+    void restore(const BasicWorldSnapshot<T>& snapshot);
 
 private:
-    float _minx = -10;
-    float _maxx = 10;
-    float _miny = 0;
-    float _maxy = 8;
-
-    std::vector<Rectangle> _bricks;
-    Rectangle _pad{{0, 2}, 5, 1};
-    Circle _ball;
-    Vector _ballVelocity;
-};
\ No newline at end of file
+    static constexpr size_t noObstacle = SIZE_MAX;
+    static constexpr size_t parallelBricks = 4096;
+    static constexpr size_t bricksPerJob = 1024;
+
+    struct DestroyedBrick {
+        uint32_t brick = 0;
+        // Hash of the history up to and including this brick
+        uint64_t hash = 0;
+    };
+
+    struct BrickHit {
+        BasicCollision<T> collision;
+        size_t brick = noObstacle;
+    };
+
+    struct Grid {
+        BasicVector<T> origin;
+        T cellSize = 0;
+        uint32_t columns = 0;
+        uint32_t rows = 0;
+        // How far from the path of the ball a brick center can be for the
+        // ball to hit the brick, including a little for rounding
+        T reach = 0;
+        std::span<const uint32_t> cellStarts;
+    };
+
+    static Grid makeGrid(const BrickGrid& grid);
+
+    void setupBricks(size_t players);
+    void setField(T minx, T maxx, T miny, T maxy);
+    void streamChunks(T delta);
+    void applySwaps();
+    BrickHit nearestBrick(size_t begin, size_t end) const;
+    BrickHit nearestBrickInGrid(const Grid& grid, size_t base, T within) const;
+    BrickHit nearestBrickInStream(T within);
+    // Only collisions within the given time are sure to be found
+    BrickHit nearestBrick(T within);
+    void resetBall();
+    size_t padId(size_t player = 0) const;
+    void changeBrick(size_t brickIndex);
+    void logBrickChange(const BrickChange& change);
+    void clearBrickChanges();
+    void startHistory();
+    void destroyBrick(size_t brickIndex);
+    uint64_t destroyedHash(size_t count) const;
+
+    T _minx = -12;
+    T _maxx = 12;
+    T _miny = 0;
+    T _maxy = 20;
+
+    // Bricks given by value are owned here, and shared between copies of the
+    // world, since they never change
+    std::shared_ptr<const std::vector<BasicRectangle<T>>> _ownedBricks;
+    std::span<const BasicRectangle<T>> _bricks;
+    Grid _grid;
+    LevelStream* _stream = nullptr;
+    std::vector<BasicRectangle<T>> _focus;
+    std::vector<BasicRectangle<T>> _streamAreas;
+    std::vector<ChunkSwap> _swaps;
+    // Bricks destroyed in chunks that are not resident, by chunk, and lists
+    // of chunks that came back, for reuse
+    std::unordered_map<uint32_t, std::vector<uint32_t>> _destroyedInChunks;
+    std::vector<std::vector<uint32_t>> _spareDestroyed;
+    std::vector<bool> _bricksAlive;
+    size_t _liveBricks = 0;
+    uint64_t _bricksGeneration = 0;
+    // Ring of the last maxBrickChanges changes; change n is at n modulo
+    // the size
+    std::vector<BrickChange> _brickChanges;
+    uint64_t _brickChangeCount = 0;
+    // Bricks in the order they were destroyed in this history. Only the
+    // first _destroyedApplied are destroyed in the current state; the rest
+    // is kept after a rollback, for replaying the same path. The history is
+    // numbered, for snapshots to tell which one they are from.
+    uint64_t _history = 0;
+    std::vector<DestroyedBrick> _destroyedBricks;
+    size_t _destroyedApplied = 0;
+    // For every slot of a stream, the number of its bricks in the history,
+    // and the number of the change that last unloaded it, plus one
+    std::vector<uint32_t> _slotHistory;
+    std::vector<uint64_t> _slotUnloaded;
+    size_t _players = 1;
+    Registry _bodies;
+    Entity _ball;
+    std::array<Entity, maxPlayers> _pads;
+    Query<const Pad, const BasicRectangle<T>> _padQuery;
+
+    // The ball cannot hit the same obstacle twice in a row. Skipping it
+    // avoids zero-time collisions right after a bounce.
+    size_t _lastObstacle = noObstacle;
+
+    JobSystem* _jobs = nullptr;
+    std::vector<BrickHit> _brickHits;
+};
+
+extern template class BasicWorld<float>;
+extern template class BasicWorld<Fixed>;
+
+using World = BasicWorld<float>;
+using FixedWorld = BasicWorld<Fixed>;
+using WorldSnapshot = BasicWorldSnapshot<float>;
+using FixedWorldSnapshot = BasicWorldSnapshot<Fixed>;
+
+static_assert(std::is_trivially_copyable_v<WorldSnapshot>);
+static_assert(std::is_trivially_copyable_v<FixedWorldSnapshot>);
\ No newline at end of file
@@ -1,18 +1,28 @@
+#include "levels.hpp"
 #include "schema_generated.h"
 
+#include "sdl.hpp"
+
 #include <arg.hpp>
 
 #include <yaml-cpp/yaml.h>
 
+#include <algorithm>
+#include <bit>
 #include <cctype>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <ostream>
 #include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -31,13 +41,21 @@ std::vector<uint8_t> readFile(const std::filesystem::path& path)
     return content;
 }
 
+// The file is written next to its destination and renamed over it, so that a
+// running game never maps a half-written file, and keeps its old mapping
+// valid while reloading.
 void writeFile(
     std::span<const uint8_t> data, const std::filesystem::path& path)
 {
-    auto stream = std::ofstream{path, std::ios::binary};
+    auto temporaryPath = path;
+    temporaryPath += ".tmp";
+
+    auto stream = std::ofstream{temporaryPath, std::ios::binary};
     stream.exceptions(std::ios::badbit | std::ios::failbit);
     stream.write(reinterpret_cast<const char*>(data.data()), data.size());
     stream.close();
+
+    std::filesystem::rename(temporaryPath, path);
 }
 
 std::string spriteNameToValueName(std::string spriteName)
@@ -46,6 +64,487 @@ std::string spriteNameToValueName(std::string spriteName)
     return spriteName;
 }
 
+// Must match the hash function written to the generated header, see
+// writeHeader.
+constexpr uint32_t nameHash(std::string_view name, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 15;
+    return hash;
+}
+
+// Perfect hash for a fixed set of names, built with "hash and displace": a
+// name is first hashed into a bucket, and each bucket stores the seed for a
+// second hash, chosen so that all names of the bucket land in distinct free
+// slots of the table. Empty slots hold -1. Lookup is two hashes and a string
+// comparison.
+struct PerfectHash {
+    std::vector<uint32_t> seeds;
+    std::vector<int> table;
+};
+
+PerfectHash buildPerfectHash(const std::vector<std::string>& names)
+{
+    static constexpr uint32_t maxSeed = 10'000'000;
+
+    size_t tableSize = std::bit_ceil(names.size() + names.size() / 4 + 1);
+    size_t bucketCount = std::max<size_t>(tableSize / 2, 1);
+
+    auto buckets = std::vector<std::vector<size_t>>(bucketCount);
+    for (size_t i = 0; i < names.size(); i++) {
+        buckets[nameHash(names[i], 0) & (bucketCount - 1)].push_back(i);
+    }
+
+    auto bucketOrder = std::vector<size_t>(bucketCount);
+    for (size_t i = 0; i < bucketCount; i++) {
+        bucketOrder[i] = i;
+    }
+    std::ranges::stable_sort(bucketOrder, [&buckets] (size_t x, size_t y) {
+        return buckets[x].size() > buckets[y].size();
+    });
+
+    auto hash = PerfectHash{
+        .seeds = std::vector<uint32_t>(bucketCount),
+        .table = std::vector<int>(tableSize, -1),
+    };
+    auto slots = std::vector<size_t>{};
+    for (size_t bucketIndex : bucketOrder) {
+        const auto& bucket = buckets[bucketIndex];
+        if (bucket.empty()) {
+            break;
+        }
+
+        uint32_t seed = 1;
+        for (; seed < maxSeed; seed++) {
+            slots.clear();
+            for (size_t nameIndex : bucket) {
+                auto slot = nameHash(names[nameIndex], seed) & (tableSize - 1);
+                if (hash.table[slot] != -1 ||
+                        std::ranges::find(slots, slot) != slots.end()) {
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (slots.size() == bucket.size()) {
+                break;
+            }
+        }
+        if (seed == maxSeed) {
+            throw std::runtime_error{
+                "failed to build perfect hash for sprite names"};
+        }
+
+        hash.seeds[bucketIndex] = seed;
+        for (size_t i = 0; i < bucket.size(); i++) {
+            hash.table[slots[i]] = static_cast<int>(bucket[i]);
+        }
+    }
+
+    return hash;
+}
+
+template <class T, class F>
+void writeArray(std::ostream& output, const std::vector<T>& values, F&& write)
+{
+    for (size_t i = 0; i < values.size(); i++) {
+        output << (i % 8 == 0 ? "\n    " : " ");
+        write(values[i]);
+        output << ",";
+    }
+    output << "\n";
+}
+
+void writeHeader(
+    const std::filesystem::path& path,
+    const std::vector<std::string>& spriteNames,
+    const std::vector<std::vector<fb::Frame>>& spriteFrames,
+    const std::vector<std::string>& soundNames,
+    const std::vector<std::string>& fontNames)
+{
+    auto frameCounts = std::vector<size_t>{};
+    auto firstFrames = std::vector<size_t>{};
+    auto frames = std::vector<fb::Frame>{};
+    for (const auto& spriteFrameList : spriteFrames) {
+        firstFrames.push_back(frames.size());
+        frameCounts.push_back(spriteFrameList.size());
+        frames.insert(frames.end(), spriteFrameList.begin(), spriteFrameList.end());
+    }
+
+    auto hash = buildPerfectHash(spriteNames);
+
+    auto headerFile = std::ofstream{path};
+    headerFile.exceptions(std::ios::badbit | std::ios::failbit);
+
+    headerFile <<
+        "#pragma once\n"
+        "\n"
+        "#include <array>\n"
+        "#include <cstddef>\n"
+        "#include <cstdint>\n"
+        "#include <optional>\n"
+        "#include <span>\n"
+        "#include <string_view>\n"
+        "\n"
+        "namespace r {\n"
+        "\n"
+        "enum class Sprite {\n";
+
+    for (const auto& name : spriteNames) {
+        headerFile << "    " << spriteNameToValueName(name) << ",\n";
+    }
+
+    headerFile <<
+        "};\n"
+        "\n"
+        "enum class Sound {\n";
+
+    for (const auto& name : soundNames) {
+        headerFile << "    " << spriteNameToValueName(name) << ",\n";
+    }
+
+    headerFile <<
+        "};\n"
+        "\n"
+        "enum class Font {\n";
+
+    for (const auto& name : fontNames) {
+        headerFile << "    " << spriteNameToValueName(name) << ",\n";
+    }
+
+    headerFile <<
+        "};\n"
+        "\n"
+        "// Frames of the atlas as packed at build time, at level 0, in its\n"
+        "// pixels. Resources reloaded at run time may have other frames, and\n"
+        "// other levels are scaled, so drawing goes by the frames that\n"
+        "// Resources loaded; these are for code that needs sizes at compile\n"
+        "// time. Names and enums do not depend on the atlas.\n"
+        "struct FrameRect {\n"
+        "    int x = 0;\n"
+        "    int y = 0;\n"
+        "    int w = 0;\n"
+        "    int h = 0;\n"
+        "    int duration = 0;\n"
+        "};\n"
+        "\n"
+        "inline constexpr size_t spriteCount = " << spriteNames.size() << ";\n"
+        "\n"
+        "inline constexpr std::array<std::string_view, spriteCount> spriteNames {";
+    writeArray(headerFile, spriteNames, [&headerFile] (const auto& name) {
+        headerFile << "\"" << name << "\"";
+    });
+    headerFile <<
+        "};\n"
+        "\n"
+        "inline constexpr size_t soundCount = " << soundNames.size() << ";\n"
+        "\n"
+        "inline constexpr std::array<std::string_view, soundCount> soundNames {";
+    writeArray(headerFile, soundNames, [&headerFile] (const auto& name) {
+        headerFile << "\"" << name << "\"";
+    });
+    headerFile <<
+        "};\n"
+        "\n"
+        "inline constexpr size_t fontCount = " << fontNames.size() << ";\n"
+        "\n"
+        "inline constexpr std::array<std::string_view, fontCount> fontNames {";
+    writeArray(headerFile, fontNames, [&headerFile] (const auto& name) {
+        headerFile << "\"" << name << "\"";
+    });
+    headerFile <<
+        "};\n"
+        "\n"
+        "inline constexpr std::array<size_t, spriteCount> frameCounts {";
+    writeArray(headerFile, frameCounts, [&headerFile] (size_t count) {
+        headerFile << count;
+    });
+    headerFile <<
+        "};\n"
+        "\n"
+        "inline constexpr std::array<size_t, spriteCount> firstFrames {";
+    writeArray(headerFile, firstFrames, [&headerFile] (size_t index) {
+        headerFile << index;
+    });
+    headerFile <<
+        "};\n"
+        "\n"
+        "inline constexpr std::array<FrameRect, " << frames.size() << "> frames {{";
+    writeArray(headerFile, frames, [&headerFile] (const fb::Frame& frame) {
+        headerFile << "{" << frame.x() << ", " << frame.y() << ", " <<
+            frame.w() << ", " << frame.h() << ", " << frame.duration() << "}";
+    });
+    headerFile <<
+        "}};\n"
+        "\n"
+        "constexpr size_t frameCount(Sprite sprite)\n"
+        "{\n"
+        "    return frameCounts[static_cast<size_t>(sprite)];\n"
+        "}\n"
+        "\n"
+        "constexpr std::span<const FrameRect> spriteFrames(Sprite sprite)\n"
+        "{\n"
+        "    auto index = static_cast<size_t>(sprite);\n"
+        "    return std::span{frames}.subspan(firstFrames[index], frameCounts[index]);\n"
+        "}\n"
+        "\n"
+        "constexpr const FrameRect& frame(Sprite sprite, size_t frameIndex)\n"
+        "{\n"
+        "    return frames[firstFrames[static_cast<size_t>(sprite)] + frameIndex];\n"
+        "}\n"
+        "\n"
+        "namespace internal {\n"
+        "\n"
+        "constexpr uint32_t nameHash(std::string_view name, uint32_t seed)\n"
+        "{\n"
+        "    uint32_t hash = 2166136261u ^ seed;\n"
+        "    for (char c : name) {\n"
+        "        hash ^= static_cast<uint8_t>(c);\n"
+        "        hash *= 16777619u;\n"
+        "    }\n"
+        "    hash ^= hash >> 15;\n"
+        "    return hash;\n"
+        "}\n"
+        "\n"
+        "inline constexpr std::array<uint32_t, " << hash.seeds.size() << "> spriteHashSeeds {";
+    writeArray(headerFile, hash.seeds, [&headerFile] (uint32_t seed) {
+        headerFile << seed;
+    });
+    headerFile <<
+        "};\n"
+        "\n"
+        "inline constexpr std::array<int, " << hash.table.size() << "> spriteHashTable {";
+    writeArray(headerFile, hash.table, [&headerFile] (int index) {
+        headerFile << index;
+    });
+    headerFile <<
+        "};\n"
+        "\n"
+        "} // namespace internal\n"
+        "\n"
+        "constexpr std::optional<Sprite> spriteByName(std::string_view name)\n"
+        "{\n"
+        "    auto bucket = internal::nameHash(name, 0) &\n"
+        "        (internal::spriteHashSeeds.size() - 1);\n"
+        "    auto seed = internal::spriteHashSeeds[bucket];\n"
+        "    auto slot = internal::nameHash(name, seed) &\n"
+        "        (internal::spriteHashTable.size() - 1);\n"
+        "    auto index = internal::spriteHashTable[slot];\n"
+        "    if (index < 0 || spriteNames[index] != name) {\n"
+        "        return std::nullopt;\n"
+        "    }\n"
+        "    return static_cast<Sprite>(index);\n"
+        "}\n"
+        "\n"
+        "} // namespace r\n";
+
+    headerFile.close();
+}
+
+// Pixels in ARGB8888, one uint32_t each
+struct Image {
+    uint32_t& at(int x, int y)
+    {
+        return pixels[static_cast<size_t>(y) * w + x];
+    }
+
+    uint32_t at(int x, int y) const
+    {
+        return pixels[static_cast<size_t>(y) * w + x];
+    }
+
+    int w = 0;
+    int h = 0;
+    std::vector<uint32_t> pixels;
+};
+
+Image decodeImage(std::span<const uint8_t> data)
+{
+    auto surface = img::load(std::as_bytes(data))
+        .convert(SDL_PIXELFORMAT_ARGB8888);
+
+    auto image = Image{
+        .w = surface.w(),
+        .h = surface.h(),
+        .pixels = std::vector<uint32_t>(
+            static_cast<size_t>(surface.w()) * surface.h()),
+    };
+    for (int y = 0; y < image.h; y++) {
+        std::memcpy(
+            &image.at(0, y), surface.pixels(0, y), image.w * sizeof(uint32_t));
+    }
+    return image;
+}
+
+// Box filter: every target pixel is the average of the source pixels it
+// covers. Colors are weighted by alpha, so that transparent pixels around a
+// sprite do not darken its edges.
+Image downscale(const Image& source, const fb::Frame& frame, int w, int h)
+{
+    auto image = Image{
+        .w = w,
+        .h = h,
+        .pixels = std::vector<uint32_t>(static_cast<size_t>(w) * h),
+    };
+    for (int ty = 0; ty < h; ty++) {
+        int sy0 = frame.y() + ty * frame.h() / h;
+        int sy1 = frame.y() + ((ty + 1) * frame.h() + h - 1) / h;
+        for (int tx = 0; tx < w; tx++) {
+            int sx0 = frame.x() + tx * frame.w() / w;
+            int sx1 = frame.x() + ((tx + 1) * frame.w() + w - 1) / w;
+
+            uint64_t a = 0;
+            uint64_t r = 0;
+            uint64_t g = 0;
+            uint64_t b = 0;
+            for (int sy = sy0; sy < sy1; sy++) {
+                for (int sx = sx0; sx < sx1; sx++) {
+                    auto pixel = source.at(sx, sy);
+                    uint64_t alpha = pixel >> 24;
+                    a += alpha;
+                    r += alpha * ((pixel >> 16) & 0xff);
+                    g += alpha * ((pixel >> 8) & 0xff);
+                    b += alpha * (pixel & 0xff);
+                }
+            }
+
+            uint64_t count = static_cast<uint64_t>(sx1 - sx0) * (sy1 - sy0);
+            if (a == 0) {
+                image.at(tx, ty) = 0;
+                continue;
+            }
+            image.at(tx, ty) = static_cast<uint32_t>(
+                (a + count / 2) / count << 24 |
+                (r + a / 2) / a << 16 |
+                (g + a / 2) / a << 8 |
+                (b + a / 2) / a);
+        }
+    }
+    return image;
+}
+
+struct AtlasLevel {
+    Image image;
+    std::vector<std::vector<fb::Frame>> spriteFrames;
+};
+
+// Border around each frame in downscaled levels, filled with copies of the
+// frame's edge pixels, so that filtering at the edges stays within the frame
+constexpr int atlasPadding = 1;
+constexpr int maxAtlasLevels = 5;
+
+// Frames scaled by 1/2^level are placed on shelves, tallest first. The atlas
+// is about square.
+AtlasLevel buildAtlasLevel(
+    const Image& sheet,
+    const std::vector<std::vector<fb::Frame>>& spriteFrames,
+    int level)
+{
+    struct Placement {
+        size_t sprite = 0;
+        size_t frame = 0;
+        int w = 0;
+        int h = 0;
+        int x = 0;
+        int y = 0;
+    };
+
+    auto scaled = [level] (int size) {
+        return std::max(1, (size + (1 << level) - 1) >> level);
+    };
+
+    auto placements = std::vector<Placement>{};
+    size_t area = 0;
+    int widest = 0;
+    for (size_t sprite = 0; sprite < spriteFrames.size(); sprite++) {
+        for (size_t frame = 0; frame < spriteFrames[sprite].size(); frame++) {
+            const auto& source = spriteFrames[sprite][frame];
+            auto placement = Placement{
+                .sprite = sprite,
+                .frame = frame,
+                .w = scaled(source.w()),
+                .h = scaled(source.h()),
+            };
+            area += static_cast<size_t>(placement.w + 2 * atlasPadding) *
+                (placement.h + 2 * atlasPadding);
+            widest = std::max(widest, placement.w + 2 * atlasPadding);
+            placements.push_back(placement);
+        }
+    }
+
+    auto byHeight = placements;
+    std::ranges::stable_sort(byHeight, std::greater{}, &Placement::h);
+
+    int width = std::max(
+        widest, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(area)))));
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    for (auto& placement : byHeight) {
+        int paddedWidth = placement.w + 2 * atlasPadding;
+        if (x + paddedWidth > width) {
+            y += shelfHeight;
+            x = 0;
+            shelfHeight = 0;
+        }
+        placement.x = x + atlasPadding;
+        placement.y = y + atlasPadding;
+        x += paddedWidth;
+        shelfHeight = std::max(shelfHeight, placement.h + 2 * atlasPadding);
+    }
+
+    auto atlas = AtlasLevel{
+        .image = Image{
+            .w = width,
+            .h = y + shelfHeight,
+            .pixels = std::vector<uint32_t>(
+                static_cast<size_t>(width) * (y + shelfHeight)),
+        },
+        .spriteFrames = spriteFrames,
+    };
+    for (const auto& placement : byHeight) {
+        const auto& source = spriteFrames[placement.sprite][placement.frame];
+        auto frameImage = downscale(sheet, source, placement.w, placement.h);
+        for (int py = -atlasPadding; py < placement.h + atlasPadding; py++) {
+            for (int px = -atlasPadding; px < placement.w + atlasPadding; px++) {
+                atlas.image.at(placement.x + px, placement.y + py) =
+                    frameImage.at(
+                        std::clamp(px, 0, placement.w - 1),
+                        std::clamp(py, 0, placement.h - 1));
+            }
+        }
+        atlas.spriteFrames[placement.sprite][placement.frame] = fb::Frame{
+            placement.x,
+            placement.y,
+            placement.w,
+            placement.h,
+            source.duration()};
+    }
+    return atlas;
+}
+
+// Levels are added while the largest frame is still at least 4 pixels in
+// size, up to maxAtlasLevels
+std::vector<AtlasLevel> buildAtlasLevels(
+    const Image& sheet, const std::vector<std::vector<fb::Frame>>& spriteFrames)
+{
+    int largest = 0;
+    for (const auto& frames : spriteFrames) {
+        for (const auto& frame : frames) {
+            largest = std::max({largest, frame.w(), frame.h()});
+        }
+    }
+
+    auto levels = std::vector<AtlasLevel>{};
+    for (int level = 1; level <= maxAtlasLevels && (largest >> level) >= 4; level++) {
+        levels.push_back(buildAtlasLevel(sheet, spriteFrames, level));
+    }
+    return levels;
+}
+
 struct FrameName {
     std::string object;
     std::string tag;
@@ -67,10 +566,309 @@ FrameName parseFrameName(std::string_view name)
     };
 }
 
+// Sample format of sounds in the data file, and of the mixer
+constexpr int soundFrequency = 48000;
+constexpr int soundChannels = 2;
+
+struct AssetFile {
+    std::string name;
+    std::filesystem::path path;
+};
+
+// Every file with the extension in the directory is an asset named after the
+// file. The directory is optional.
+std::vector<AssetFile> findAssets(
+    const std::filesystem::path& directory, std::string_view extension)
+{
+    auto assets = std::vector<AssetFile>{};
+    if (!std::filesystem::is_directory(directory)) {
+        return assets;
+    }
+    for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+        if (entry.is_regular_file() && entry.path().extension() == extension) {
+            assets.push_back(AssetFile{
+                .name = entry.path().stem().string(),
+                .path = entry.path(),
+            });
+        }
+    }
+    std::ranges::sort(assets, {}, &AssetFile::name);
+    return assets;
+}
+
+// Fonts are rendered at one size, for the HUD, with printable ASCII only
+constexpr int fontPointSize = 16;
+constexpr char32_t firstGlyph = 32;
+constexpr char32_t lastGlyph = 126;
+constexpr int glyphPadding = 1;
+
+struct FontAtlas {
+    Image image;
+    int lineHeight = 0;
+    std::vector<fb::Glyph> glyphs;
+};
+
+// Glyphs are cropped to their visible pixels, and placed on shelves, tallest
+// first. The padding stays transparent, so that filtering does not pick up
+// a neighbouring glyph.
+FontAtlas buildFontAtlas(std::span<const uint8_t> fontData)
+{
+    struct Rendered {
+        char32_t codepoint = 0;
+        Image image;
+        int left = 0;
+        int top = 0;
+        int advance = 0;
+        int x = 0;
+        int y = 0;
+    };
+
+    auto font = ttf::Font{std::as_bytes(fontData), fontPointSize};
+    auto rendered = std::vector<Rendered>{};
+    size_t area = 0;
+    int widest = 0;
+    for (char32_t codepoint = firstGlyph; codepoint <= lastGlyph; codepoint++) {
+        auto glyph = Rendered{
+            .codepoint = codepoint,
+            .image = {},
+            .advance = font.advance(codepoint),
+        };
+
+        auto surface = font.renderGlyph(codepoint).convert(SDL_PIXELFORMAT_ARGB8888);
+        int xmin = surface.w();
+        int xmax = 0;
+        int ymin = surface.h();
+        int ymax = 0;
+        for (int y = 0; y < surface.h(); y++) {
+            const auto* row = static_cast<const uint32_t*>(surface.pixels(0, y));
+            for (int x = 0; x < surface.w(); x++) {
+                if (row[x] >> 24 != 0) {
+                    xmin = std::min(xmin, x);
+                    xmax = std::max(xmax, x + 1);
+                    ymin = std::min(ymin, y);
+                    ymax = std::max(ymax, y + 1);
+                }
+            }
+        }
+
+        // Blank glyphs, like the space, only advance the pen
+        if (xmin < xmax) {
+            glyph.left = xmin;
+            glyph.top = ymin;
+            glyph.image = Image{
+                .w = xmax - xmin,
+                .h = ymax - ymin,
+                .pixels = std::vector<uint32_t>(
+                    static_cast<size_t>(xmax - xmin) * (ymax - ymin)),
+            };
+            for (int y = 0; y < glyph.image.h; y++) {
+                std::memcpy(
+                    &glyph.image.at(0, y),
+                    surface.pixels(xmin, ymin + y),
+                    glyph.image.w * sizeof(uint32_t));
+            }
+            area += static_cast<size_t>(glyph.image.w + 2 * glyphPadding) *
+                (glyph.image.h + 2 * glyphPadding);
+            widest = std::max(widest, glyph.image.w + 2 * glyphPadding);
+        }
+        rendered.push_back(std::move(glyph));
+    }
+
+    auto order = std::vector<Rendered*>{};
+    for (auto& glyph : rendered) {
+        order.push_back(&glyph);
+    }
+    std::ranges::stable_sort(order, std::greater{}, [] (const Rendered* glyph) {
+        return glyph->image.h;
+    });
+
+    int width = std::max(
+        widest, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(area)))));
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    for (auto* glyph : order) {
+        if (glyph->image.w == 0) {
+            continue;
+        }
+        int paddedWidth = glyph->image.w + 2 * glyphPadding;
+        if (x + paddedWidth > width) {
+            y += shelfHeight;
+            x = 0;
+            shelfHeight = 0;
+        }
+        glyph->x = x + glyphPadding;
+        glyph->y = y + glyphPadding;
+        x += paddedWidth;
+        shelfHeight = std::max(shelfHeight, glyph->image.h + 2 * glyphPadding);
+    }
+
+    // A font without visible glyphs still gets a texture
+    width = std::max(width, 1);
+    int height = std::max(y + shelfHeight, 1);
+    auto atlas = FontAtlas{
+        .image = Image{
+            .w = width,
+            .h = height,
+            .pixels = std::vector<uint32_t>(static_cast<size_t>(width) * height),
+        },
+        .lineHeight = font.lineSkip(),
+        .glyphs = {},
+    };
+    for (const auto& glyph : rendered) {
+        for (int py = 0; py < glyph.image.h; py++) {
+            for (int px = 0; px < glyph.image.w; px++) {
+                atlas.image.at(glyph.x + px, glyph.y + py) = glyph.image.at(px, py);
+            }
+        }
+        atlas.glyphs.push_back(fb::Glyph{
+            static_cast<uint32_t>(glyph.codepoint),
+            glyph.x,
+            glyph.y,
+            glyph.image.w,
+            glyph.image.h,
+            glyph.left,
+            glyph.top,
+            glyph.advance});
+    }
+    return atlas;
+}
+
+// Bricks in level sources are given by center and size, either one by one:
+//
+//   bricks:
+//     - [-10, 15, 2, 1]
+//
+// or as a block that fills an area with rows of bricks, with gaps between
+// them:
+//
+//   fills:
+//     - {x: 0, y: 14, w: 24, h: 8, columns: 12, rows: 8, gap: 0.1}
+//
+// or generated at random, for stress tests, with the keys of
+// GeneratorOptions that are given:
+//
+//   generate:
+//     - {seed: 3, bricks: 100000, size_spread: 0.5, clustering: 0.8}
+//
+// Levels with a chunk_size are compiled into chunks that the game streams.
+// Their field is [xmin, xmax, ymin, ymax], and reaches 4 units above the
+// highest brick by default.
+struct LevelSource {
+    std::vector<fb::Brick> bricks;
+    float chunkSize = 0;
+    fb::Brick field;
+};
+
+LevelSource loadLevelSource(const std::filesystem::path& path)
+{
+    auto brick = [] (float x, float y, float w, float h) {
+        return fb::Brick{x - w / 2, x + w / 2, y - h / 2, y + h / 2};
+    };
+
+    auto bricks = std::vector<fb::Brick>{};
+    auto levelYaml = YAML::LoadFile(path.string());
+    for (const auto& brickYaml : levelYaml["bricks"]) {
+        bricks.push_back(brick(
+            brickYaml[0].as<float>(),
+            brickYaml[1].as<float>(),
+            brickYaml[2].as<float>(),
+            brickYaml[3].as<float>()));
+    }
+    for (const auto& fillYaml : levelYaml["fills"]) {
+        auto x = fillYaml["x"].as<float>();
+        auto y = fillYaml["y"].as<float>();
+        auto w = fillYaml["w"].as<float>();
+        auto h = fillYaml["h"].as<float>();
+        auto columns = fillYaml["columns"].as<int>();
+        auto rows = fillYaml["rows"].as<int>();
+        auto gap = fillYaml["gap"].as<float>(0);
+        if (columns <= 0 || rows <= 0) {
+            throw std::runtime_error{
+                path.string() + ": fill needs at least one column and row"};
+        }
+
+        float cellW = w / static_cast<float>(columns);
+        float cellH = h / static_cast<float>(rows);
+        for (int row = 0; row < rows; row++) {
+            for (int column = 0; column < columns; column++) {
+                bricks.push_back(brick(
+                    x - w / 2 + cellW * (static_cast<float>(column) + 0.5f),
+                    y - h / 2 + cellH * (static_cast<float>(row) + 0.5f),
+                    cellW - gap,
+                    cellH - gap));
+            }
+        }
+    }
+    for (const auto& generateYaml : levelYaml["generate"]) {
+        auto options = GeneratorOptions{};
+        options.seed = generateYaml["seed"].as<uint64_t>(options.seed);
+        options.bricks = generateYaml["bricks"].as<size_t>(options.bricks);
+        if (auto areaYaml = generateYaml["area"]) {
+            options.area = fb::Brick{
+                areaYaml[0].as<float>(),
+                areaYaml[1].as<float>(),
+                areaYaml[2].as<float>(),
+                areaYaml[3].as<float>()};
+        }
+        options.fill = generateYaml["fill"].as<float>(options.fill);
+        options.aspect = generateYaml["aspect"].as<float>(options.aspect);
+        options.sizeSpread =
+            generateYaml["size_spread"].as<float>(options.sizeSpread);
+        options.clustering =
+            generateYaml["clustering"].as<float>(options.clustering);
+        options.clusters =
+            generateYaml["clusters"].as<uint32_t>(options.clusters);
+        options.clusterRadius =
+            generateYaml["cluster_radius"].as<float>(options.clusterRadius);
+        auto generated = generateBricks(options);
+        bricks.insert(bricks.end(), generated.begin(), generated.end());
+    }
+
+    auto top = 20.f;
+    for (const auto& b : bricks) {
+        top = std::max(top, b.ymax() + 4);
+    }
+    auto field = fb::Brick{-12, 12, 0, top};
+    if (auto fieldYaml = levelYaml["field"]) {
+        field = fb::Brick{
+            fieldYaml[0].as<float>(),
+            fieldYaml[1].as<float>(),
+            fieldYaml[2].as<float>(),
+            fieldYaml[3].as<float>()};
+    }
+    return LevelSource{
+        .bricks = std::move(bricks),
+        .chunkSize = levelYaml["chunk_size"].as<float>(0),
+        .field = field,
+    };
+}
+
+// Every level source is compiled into its own file, which the game maps
+// when the level starts, or streams if the level is chunked
+void packLevels(
+    const std::filesystem::path& source, const std::filesystem::path& output)
+{
+    std::filesystem::create_directories(output);
+    for (const auto& [name, path] : findAssets(source, ".yaml")) {
+        auto level = loadLevelSource(path);
+        if (level.chunkSize > 0) {
+            writeFile(
+                compileChunkedLevel(
+                    name, level.bricks, level.field, level.chunkSize),
+                output / (name + ".chunks"));
+        } else {
+            writeFile(
+                compileLevel(name, level.bricks), output / (name + ".level"));
+        }
+    }
+}
+
 struct Paths {
     std::filesystem::path source;
     std::filesystem::path data;
     std::filesystem::path header;
+    std::filesystem::path levels;
 };
 
 void pack(const Paths& paths)
@@ -106,44 +904,90 @@ void pack(const Paths& paths)
     }
 
     auto spriteNames = std::vector<std::string>{};
+    auto spriteFrameLists = std::vector<std::vector<fb::Frame>>{};
     auto sprites = std::vector<flatbuffers::Offset<fb::Sprite>>{};
     for (const auto& [name, frames] : spriteFrames) {
         auto fbName = builder.CreateString(name);
         auto fbFrames = builder.CreateVectorOfStructs(frames);
         sprites.push_back(fb::CreateSprite(builder, fbName, fbFrames));
         spriteNames.push_back(name);
+        spriteFrameLists.push_back(frames);
     }
 
     auto fbSprites = builder.CreateVector(sprites);
 
+    // Pixels are stored as they are in memory, so the game can upload them
+    // without decoding. ARGB8888 is defined on native uint32_t values, and
+    // the data file is built on the machine that runs it.
+    auto sheet = decodeImage(spritesheetData);
+    auto levels = std::vector<flatbuffers::Offset<fb::AtlasLevel>>{};
+    for (const auto& level : buildAtlasLevels(sheet, spriteFrameLists)) {
+        auto frames = std::vector<fb::Frame>{};
+        for (const auto& spriteFrameList : level.spriteFrames) {
+            frames.insert(frames.end(), spriteFrameList.begin(), spriteFrameList.end());
+        }
+        auto fbPixels = builder.CreateVector(
+            reinterpret_cast<const uint8_t*>(level.image.pixels.data()),
+            level.image.pixels.size() * sizeof(uint32_t));
+        auto fbFrames = builder.CreateVectorOfStructs(frames);
+        levels.push_back(fb::CreateAtlasLevel(
+            builder, level.image.w, level.image.h, fbPixels, fbFrames));
+    }
+    auto fbLevels = builder.CreateVector(levels);
+
+    // Sounds are decoded here, so that the game only has to mix them
+    auto soundNames = std::vector<std::string>{};
+    auto sounds = std::vector<flatbuffers::Offset<fb::Sound>>{};
+    for (const auto& [name, path] : findAssets(paths.source / "sounds", ".wav")) {
+        auto wav = readFile(path);
+        auto samples = sdl::decodeWav(
+            std::as_bytes(std::span{wav}), soundFrequency, soundChannels);
+        auto fbName = builder.CreateString(name);
+        auto fbSamples = builder.CreateVector(samples);
+        sounds.push_back(fb::CreateSound(builder, fbName, fbSamples));
+        soundNames.push_back(name);
+    }
+    auto fbSounds = builder.CreateVector(sounds);
+
+    auto ttfInit = ttf::Init{};
+    auto fontNames = std::vector<std::string>{};
+    auto fonts = std::vector<flatbuffers::Offset<fb::Font>>{};
+    for (const auto& [name, path] : findAssets(paths.source / "fonts", ".ttf")) {
+        auto fontData = readFile(path);
+        auto atlas = buildFontAtlas(fontData);
+        auto fbName = builder.CreateString(name);
+        auto fbPixels = builder.CreateVector(
+            reinterpret_cast<const uint8_t*>(atlas.image.pixels.data()),
+            atlas.image.pixels.size() * sizeof(uint32_t));
+        auto fbGlyphs = builder.CreateVectorOfStructs(atlas.glyphs);
+        fonts.push_back(fb::CreateFont(
+            builder,
+            fbName,
+            atlas.lineHeight,
+            atlas.image.w,
+            atlas.image.h,
+            fbPixels,
+            fbGlyphs));
+        fontNames.push_back(name);
+    }
+    auto fbFonts = builder.CreateVector(fonts);
+
     auto resources = fb::CreateResources(
         builder,
         fbSpritesheet,
-        fbSprites
+        fbSprites,
+        fbLevels,
+        fbSounds,
+        fbFonts
     );
 
     builder.Finish(resources);
 
     writeFile(builder.GetBufferSpan(), paths.data);
+    writeHeader(
+        paths.header, spriteNames, spriteFrameLists, soundNames, fontNames);
 
-    auto headerFile = std::ofstream{paths.header};
-    headerFile <<
-        "#pragma once\n"
-        "\n"
-        "namespace r {\n"
-        "\n"
-        "enum class Sprite {\n";
-
-    for (const auto& name : spriteNames) {
-        headerFile << "    " << spriteNameToValueName(name) << ",\n";
-    }
-
-    headerFile <<
-        "};\n"
-        "\n"
-        "} // namespace r\n";
-
-    headerFile.close();
+    packLevels(paths.source / "levels", paths.levels);
 }
 
 int main(int argc, char* argv[]) try
@@ -163,6 +1007,11 @@ int main(int argc, char* argv[]) try
         .markRequired()
         .metavar("FILE")
         .help("path to output header with resource ids");
+    auto outputLevelDirectory = arg::option<std::filesystem::path>()
+        .keys("--levels")
+        .markRequired()
+        .metavar("DIR")
+        .help("path to output directory for compiled levels");
     arg::helpKeys("-h", "--help");
     arg::parse(argc, argv);
 
@@ -170,6 +1019,7 @@ int main(int argc, char* argv[]) try
         .source = source,
         .data = outputDataFilePath,
         .header = outputHeaderFilePath,
+        .levels = outputLevelDirectory,
     });
 } catch (const std::exception& e) {
     std::cerr << e.what() << "\n";
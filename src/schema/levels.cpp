@@ -0,0 +1,365 @@
+#include "levels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr float bricksPerCell = 4;
+constexpr uint64_t maxCells = uint64_t{1} << 22;
+constexpr uint32_t maxChunkCells = 64;
+
+// SplitMix64, which is simple enough to give the same numbers everywhere
+class Random {
+public:
+    explicit Random(uint64_t seed)
+        : _state(seed)
+    { }
+
+    uint64_t next()
+    {
+        uint64_t z = (_state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1)
+    float unit()
+    {
+        return static_cast<float>(next() >> 40) * 0x1p-24f;
+    }
+
+    float between(float min, float max)
+    {
+        return min + (max - min) * unit();
+    }
+
+private:
+    uint64_t _state;
+};
+
+float center(float min, float max)
+{
+    return min + (max - min) / 2;
+}
+
+// Bounds of the brick centers, and the largest half extent of a brick
+struct Extent {
+    float minx = 0;
+    float miny = 0;
+    float maxx = 0;
+    float maxy = 0;
+    float margin = 0;
+
+    float width() const
+    {
+        return maxx - minx;
+    }
+
+    float height() const
+    {
+        return maxy - miny;
+    }
+};
+
+Extent measure(std::string_view name, std::span<const fb::Brick> bricks)
+{
+    if (bricks.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error{std::format(
+            "level {}: too many bricks ({})", name, bricks.size())};
+    }
+    if (bricks.empty()) {
+        return {};
+    }
+
+    auto extent = Extent{
+        .minx = std::numeric_limits<float>::max(),
+        .miny = std::numeric_limits<float>::max(),
+        .maxx = std::numeric_limits<float>::lowest(),
+        .maxy = std::numeric_limits<float>::lowest(),
+    };
+    for (size_t i = 0; i < bricks.size(); i++) {
+        const auto& brick = bricks[i];
+        if (!std::isfinite(brick.xmin()) || !std::isfinite(brick.xmax()) ||
+                !std::isfinite(brick.ymin()) || !std::isfinite(brick.ymax()) ||
+                brick.xmin() > brick.xmax() || brick.ymin() > brick.ymax()) {
+            throw std::runtime_error{std::format(
+                "level {}: brick {} has invalid bounds", name, i)};
+        }
+        float x = center(brick.xmin(), brick.xmax());
+        float y = center(brick.ymin(), brick.ymax());
+        extent.minx = std::min(extent.minx, x);
+        extent.maxx = std::max(extent.maxx, x);
+        extent.miny = std::min(extent.miny, y);
+        extent.maxy = std::max(extent.maxy, y);
+        extent.margin = std::max({extent.margin,
+            (brick.xmax() - brick.xmin()) / 2,
+            (brick.ymax() - brick.ymin()) / 2});
+    }
+    return extent;
+}
+
+// Cells along an extent, counting the one that holds its far end
+uint64_t cellCount(float extent, float cellSize)
+{
+    return static_cast<uint64_t>(std::floor(extent / cellSize)) + 1;
+}
+
+struct GridLayout {
+    float x = 0;
+    float y = 0;
+    float cellSize = 0;
+    uint32_t columns = 0;
+    uint32_t rows = 0;
+};
+
+// Sorts the bricks by the cell that holds their center, row by row, with a
+// counting sort that keeps the given order within a cell. Appends the
+// sorted bricks, and the start of every cell relative to the first appended
+// brick, plus the end.
+void sortIntoCells(
+    std::span<const fb::Brick> bricks,
+    const GridLayout& grid,
+    std::vector<fb::Brick>& sorted,
+    std::vector<uint32_t>& cellStarts)
+{
+    auto cell = [&] (float value, float origin, uint32_t cells) {
+        auto index = static_cast<int64_t>(
+            std::floor((value - origin) / grid.cellSize));
+        return static_cast<uint32_t>(std::clamp<int64_t>(index, 0, cells - 1));
+    };
+    auto cellOf = [&] (const fb::Brick& brick) {
+        return cell(center(brick.ymin(), brick.ymax()), grid.y, grid.rows) *
+            grid.columns +
+            cell(center(brick.xmin(), brick.xmax()), grid.x, grid.columns);
+    };
+
+    size_t firstStart = cellStarts.size();
+    size_t cells = size_t{grid.columns} * grid.rows;
+    cellStarts.resize(firstStart + cells + 1);
+    auto starts = std::span{cellStarts}.subspan(firstStart);
+    for (const auto& brick : bricks) {
+        starts[cellOf(brick) + 1]++;
+    }
+    for (size_t i = 1; i < starts.size(); i++) {
+        starts[i] += starts[i - 1];
+    }
+
+    size_t firstBrick = sorted.size();
+    sorted.resize(firstBrick + bricks.size());
+    auto next = std::vector<uint32_t>(starts.begin(), starts.end() - 1);
+    for (const auto& brick : bricks) {
+        sorted[firstBrick + next[cellOf(brick)]++] = brick;
+    }
+}
+
+} // namespace
+
+std::vector<uint8_t> compileLevel(
+    std::string_view name, std::span<const fb::Brick> bricks)
+{
+    auto extent = measure(name, bricks);
+
+    // Cells are no smaller than the largest brick, so that the ball checks
+    // few cells, and otherwise small enough for a few bricks each
+    float cellSize = std::max({
+        std::sqrt(extent.width() * extent.height() * bricksPerCell /
+            static_cast<float>(std::max<size_t>(bricks.size(), 1))),
+        2 * extent.margin,
+        std::numeric_limits<float>::min()});
+    while (cellCount(extent.width(), cellSize) *
+            cellCount(extent.height(), cellSize) > maxCells) {
+        cellSize *= 2;
+    }
+    auto grid = GridLayout{
+        .x = extent.minx,
+        .y = extent.miny,
+        .cellSize = cellSize,
+        .columns = static_cast<uint32_t>(cellCount(extent.width(), cellSize)),
+        .rows = static_cast<uint32_t>(cellCount(extent.height(), cellSize)),
+    };
+
+    auto sorted = std::vector<fb::Brick>{};
+    auto cellStarts = std::vector<uint32_t>{};
+    sortIntoCells(bricks, grid, sorted, cellStarts);
+
+    auto builder = flatbuffers::FlatBufferBuilder{1024 +
+        sorted.size() * sizeof(fb::Brick) +
+        cellStarts.size() * sizeof(uint32_t)};
+    auto fbName = builder.CreateString(std::string{name});
+    auto fbBricks = builder.CreateVectorOfStructs(sorted);
+    auto fbCellStarts = builder.CreateVector(cellStarts);
+    auto level = fb::CreateLevel(
+        builder,
+        fbName,
+        fbBricks,
+        grid.x,
+        grid.y,
+        grid.cellSize,
+        grid.columns,
+        grid.rows,
+        extent.margin,
+        fbCellStarts);
+    fb::FinishLevelBuffer(builder, level);
+
+    auto buffer = builder.GetBufferSpan();
+    return {buffer.begin(), buffer.end()};
+}
+
+std::vector<uint8_t> compileChunkedLevel(
+    std::string_view name,
+    std::span<const fb::Brick> bricks,
+    const fb::Brick& field,
+    float chunkSize)
+{
+    auto extent = measure(name, bricks);
+    if (!(chunkSize > 0) || !std::isfinite(chunkSize)) {
+        throw std::runtime_error{std::format(
+            "level {}: invalid chunk size {}", name, chunkSize)};
+    }
+    if (cellCount(extent.width(), chunkSize) *
+            cellCount(extent.height(), chunkSize) > maxCells) {
+        throw std::runtime_error{std::format(
+            "level {}: too many chunks of size {}", name, chunkSize)};
+    }
+
+    auto chunks = GridLayout{
+        .x = extent.minx,
+        .y = extent.miny,
+        .cellSize = chunkSize,
+        .columns = static_cast<uint32_t>(cellCount(extent.width(), chunkSize)),
+        .rows = static_cast<uint32_t>(cellCount(extent.height(), chunkSize)),
+    };
+    auto byChunk = std::vector<fb::Brick>{};
+    auto chunkStarts = std::vector<uint32_t>{};
+    sortIntoCells(bricks, chunks, byChunk, chunkStarts);
+
+    // All chunks share one cell size, picked for the densest chunk
+    uint32_t maxChunkBricks = 0;
+    for (size_t chunk = 0; chunk + 1 < chunkStarts.size(); chunk++) {
+        maxChunkBricks = std::max(
+            maxChunkBricks, chunkStarts[chunk + 1] - chunkStarts[chunk]);
+    }
+    float cellSize = std::max(
+        2 * extent.margin,
+        std::sqrt(chunkSize * chunkSize * bricksPerCell /
+            static_cast<float>(std::max<uint32_t>(maxChunkBricks, 1))));
+    auto chunkCells = static_cast<uint32_t>(std::clamp<float>(
+        std::floor(chunkSize / cellSize), 1, maxChunkCells));
+
+    auto sorted = std::vector<fb::Brick>{};
+    sorted.reserve(byChunk.size());
+    auto cellStarts = std::vector<uint32_t>{};
+    for (uint32_t row = 0; row < chunks.rows; row++) {
+        for (uint32_t column = 0; column < chunks.columns; column++) {
+            size_t chunk = size_t{row} * chunks.columns + column;
+            auto chunkBricks = std::span{byChunk}.subspan(
+                chunkStarts[chunk],
+                chunkStarts[chunk + 1] - chunkStarts[chunk]);
+            // The same expressions as where the game places the chunk grid
+            auto cells = GridLayout{
+                .x = chunks.x + chunkSize * static_cast<float>(column),
+                .y = chunks.y + chunkSize * static_cast<float>(row),
+                .cellSize = chunkSize / static_cast<float>(chunkCells),
+                .columns = chunkCells,
+                .rows = chunkCells,
+            };
+            sortIntoCells(chunkBricks, cells, sorted, cellStarts);
+        }
+    }
+
+    auto builder = flatbuffers::FlatBufferBuilder{1024 +
+        sorted.size() * sizeof(fb::Brick) +
+        chunkStarts.size() * sizeof(uint64_t) +
+        cellStarts.size() * sizeof(uint32_t)};
+    auto fbName = builder.CreateString(std::string{name});
+    auto fbBricks = builder.CreateVectorOfStructs(sorted);
+    auto fbChunkStarts = builder.CreateVector(
+        std::vector<uint64_t>(chunkStarts.begin(), chunkStarts.end()));
+    auto fbCellStarts = builder.CreateVector(cellStarts);
+    auto level = fb::CreateChunkedLevel(
+        builder,
+        fbName,
+        &field,
+        chunks.x,
+        chunks.y,
+        chunkSize,
+        chunks.columns,
+        chunks.rows,
+        chunkCells,
+        extent.margin,
+        maxChunkBricks,
+        fbBricks,
+        fbChunkStarts,
+        fbCellStarts);
+    fb::FinishChunkedLevelBuffer(builder, level);
+
+    auto buffer = builder.GetBufferSpan();
+    return {buffer.begin(), buffer.end()};
+}
+
+// Cluster points are drawn from a disc by rejection, and sizes from a
+// uniform range, so that only basic float arithmetic is involved
+std::vector<fb::Brick> generateBricks(const GeneratorOptions& options)
+{
+    const auto& area = options.area;
+    float width = area.xmax() - area.xmin();
+    float height = area.ymax() - area.ymin();
+    if (!(width > 0) || !(height > 0) || !(options.fill > 0) ||
+            !(options.aspect > 0) || !(options.sizeSpread >= 0) ||
+            !(options.sizeSpread < 1) || !(options.clustering >= 0) ||
+            !(options.clustering <= 1) || !(options.clusterRadius > 0)) {
+        throw std::runtime_error{"invalid level generator options"};
+    }
+
+    auto random = Random{options.seed};
+    auto clusters = std::vector<std::pair<float, float>>{};
+    for (uint32_t i = 0; i < std::max<uint32_t>(options.clusters, 1); i++) {
+        clusters.emplace_back(
+            random.between(area.xmin(), area.xmax()),
+            random.between(area.ymin(), area.ymax()));
+    }
+    float radius = options.clusterRadius * std::min(width, height);
+
+    // Average brick size, from the share of the area that each brick gets
+    float share = width * height * options.fill /
+        static_cast<float>(std::max<size_t>(options.bricks, 1));
+    float averageH = std::sqrt(share / options.aspect);
+    float averageW = averageH * options.aspect;
+
+    auto bricks = std::vector<fb::Brick>{};
+    bricks.reserve(options.bricks);
+    for (size_t i = 0; i < options.bricks; i++) {
+        float x = 0;
+        float y = 0;
+        if (random.unit() < options.clustering) {
+            const auto& [cx, cy] = clusters[random.next() % clusters.size()];
+            float dx = 0;
+            float dy = 0;
+            do {
+                dx = random.between(-1, 1);
+                dy = random.between(-1, 1);
+            } while (dx * dx + dy * dy > 1);
+            x = std::clamp(cx + dx * radius, area.xmin(), area.xmax());
+            y = std::clamp(cy + dy * radius, area.ymin(), area.ymax());
+        } else {
+            x = random.between(area.xmin(), area.xmax());
+            y = random.between(area.ymin(), area.ymax());
+        }
+
+        float scale = 1 + options.sizeSpread * random.between(-1, 1);
+        float w = averageW * scale / 2;
+        float h = averageH * scale / 2;
+        bricks.emplace_back(x - w, x + w, y - h, y + h);
+    }
+    return bricks;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "chunks_generated.h"
+#include "level_generated.h"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Random levels for stress tests and benchmarks. The same options give the
+// same bricks on every platform.
+struct GeneratorOptions {
+    uint64_t seed = 1;
+    size_t bricks = 100;
+    // Bricks are placed with their centers inside this area
+    fb::Brick area{-12, 12, 8, 20};
+    // Average share of the area covered by bricks, if they did not overlap
+    float fill = 0.5f;
+    // Width over height of an average brick
+    float aspect = 2;
+    // Brick sizes vary by up to this factor either way, from 0 to below 1
+    float sizeSpread = 0;
+    // Share of the bricks that are placed in clusters rather than spread
+    // evenly, from 0 to 1
+    float clustering = 0;
+    uint32_t clusters = 8;
+    // Cluster radius as a share of the smaller side of the area
+    float clusterRadius = 0.1f;
+};
+
+std::vector<fb::Brick> generateBricks(const GeneratorOptions& options);
+
+// Builds the contents of a level file. The bricks are sorted into a uniform
+// grid with a few bricks per cell, so that the game can map the file and
+// use it as it is.
+std::vector<uint8_t> compileLevel(
+    std::string_view name, std::span<const fb::Brick> bricks);
+
+// Builds the contents of a chunked level file, for levels too large to keep
+// in memory. The field is given as a brick, and chunks are squares of
+// chunkSize world units.
+std::vector<uint8_t> compileChunkedLevel(
+    std::string_view name,
+    std::span<const fb::Brick> bricks,
+    const fb::Brick& field,
+    float chunkSize);
@@ -1,14 +1,17 @@
 #pragma once
 
+#include <chrono>
 #include <concepts>
 #include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <span>
 #include <utility>
+#include <vector>
 
 #include <SDL.h>
 #include <SDL_image.h>
+#include <SDL_ttf.h>
 
 namespace sdl {
 
@@ -66,10 +69,25 @@ public:
 class Surface : public internal::Holder<SDL_Surface, SDL_FreeSurface> {
 public:
     using internal::Holder<SDL_Surface, SDL_FreeSurface>::Holder;
+
+    Surface convert(uint32_t format) const;
+
+    int w() const;
+    int h() const;
+    int pitch() const;
+    const void* pixels() const;
+    const void* pixels(int x, int y) const;
 };
 
 class Texture : public internal::Holder<SDL_Texture, SDL_DestroyTexture> {
+public:
     using internal::Holder<SDL_Texture, SDL_DestroyTexture>::Holder;
+    using Size = Window::Size;
+
+    Size size();
+
+    void update(const SDL_Rect* rect, const void* pixels, int pitch);
+    void blendMode(SDL_BlendMode mode);
 };
 
 class Renderer : public internal::Holder<SDL_Renderer, SDL_DestroyRenderer> {
@@ -78,10 +96,28 @@ public:
 
     Texture loadTexture(std::span<const std::byte> mem);
     Texture loadTexture(const void* data, size_t size);
+    Texture createTexture(uint32_t format, int access, int w, int h);
 
     void copy(Texture& texture, const SDL_Rect* srcrect, const SDL_Rect* dstrect);
     void copy(Texture& texture, const SDL_Rect* srcrect, const SDL_FRect* dstrect);
     void copy(Texture& texture, const SDL_Rect& srcrect, const SDL_FRect& dstrect);
+    void copy(Texture& texture);
+    void geometry(
+        Texture& texture,
+        std::span<const SDL_Vertex> vertices,
+        std::span<const int> indices);
+    // Untextured: triangles are filled with the vertex colors
+    void geometry(
+        std::span<const SDL_Vertex> vertices, std::span<const int> indices);
+
+    void target(Texture* texture);
+    void clipRect(const SDL_Rect* rect);
+    void drawColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+    void drawBlendMode(SDL_BlendMode mode);
+    void fillRect(const SDL_Rect& rect);
+
+    void readPixels(
+        const SDL_Rect* rect, uint32_t format, void* pixels, int pitch);
 
     void clear();
     void present();
@@ -98,6 +134,30 @@ private:
     std::unique_ptr<SDL_RWops, int(*)(SDL_RWops*)> _ptr {nullptr, SDL_RWclose};
 };
 
+class AudioDevice {
+public:
+    // Opens the default output device, paused. The format that the device
+    // actually uses is written to obtained.
+    AudioDevice(
+        const SDL_AudioSpec& desired, SDL_AudioSpec& obtained, int allowedChanges);
+    ~AudioDevice();
+
+    AudioDevice(const AudioDevice&) = delete;
+    AudioDevice(AudioDevice&&) = delete;
+    AudioDevice& operator=(const AudioDevice&) = delete;
+    AudioDevice& operator=(AudioDevice&&) = delete;
+
+    void pause(bool paused);
+
+private:
+    SDL_AudioDeviceID _id = 0;
+};
+
+// Decodes a WAV file to interleaved float samples with the given rate and
+// number of channels
+std::vector<float> decodeWav(
+    std::span<const std::byte> mem, int frequency, int channels);
+
 class PollEventSentinel {};
 
 class PollEventIterator {
@@ -106,6 +166,13 @@ public:
     using difference_type = std::ptrdiff_t;
     using value_type = SDL_Event;
 
+    PollEventIterator() = default;
+
+    // Starts with the first event that arrives within the timeout, if any
+    explicit PollEventIterator(int timeoutMs)
+        : _hasEvent(SDL_WaitEventTimeout(&_event, timeoutMs))
+    { }
+
     const SDL_Event& operator*() const
     {
         return _event;
@@ -139,8 +206,17 @@ static_assert(std::sentinel_for<PollEventSentinel, PollEventIterator>);
 
 class PollEventRange {
 public:
+    PollEventRange() = default;
+
+    explicit PollEventRange(int timeoutMs)
+        : _timeoutMs(timeoutMs)
+    { }
+
     PollEventIterator begin()
     {
+        if (_timeoutMs > 0) {
+            return PollEventIterator{_timeoutMs};
+        }
         return PollEventIterator{}++;
     }
 
@@ -148,6 +224,9 @@ public:
     {
         return {};
     }
+
+private:
+    int _timeoutMs = 0;
 };
 
 inline PollEventRange pollEvents()
@@ -155,6 +234,13 @@ inline PollEventRange pollEvents()
     return {};
 }
 
+// Sleeps until the first event arrives or the timeout passes, and then
+// polls the rest, like pollEvents()
+inline PollEventRange waitEvents(std::chrono::milliseconds timeout)
+{
+    return PollEventRange{static_cast<int>(timeout.count())};
+}
+
 } // namespace sdl
 
 namespace img {
@@ -171,5 +257,35 @@ public:
 };
 
 sdl::Surface load(const std::filesystem::path& file);
+sdl::Surface load(std::span<const std::byte> mem);
+
+} // namespace img
+namespace ttf {
+
+class Init {
+public:
+    Init();
+    ~Init();
+
+    Init(const Init&) = delete;
+    Init(Init&&) = delete;
+    Init& operator=(const Init&) = delete;
+    Init& operator=(Init&&) = delete;
+};
+
+class Font : public sdl::internal::Holder<TTF_Font, TTF_CloseFont> {
+public:
+    // The font reads from memory while it is used, so mem must outlive it
+    Font(std::span<const std::byte> mem, int pointSize);
+
+    int ascent();
+    int lineSkip();
+    // Horizontal distance from this glyph's origin to the next one's
+    int advance(char32_t codepoint);
+
+    // White glyph with coverage in alpha, as tall as the font, with the
+    // glyph's origin at its left edge
+    sdl::Surface renderGlyph(char32_t codepoint);
+};
 
-} // namespace img
\ No newline at end of file
+} // namespace ttf
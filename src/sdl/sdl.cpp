@@ -1,6 +1,8 @@
 #include "sdl.hpp"
 
+#include <cstring>
 #include <format>
+#include <memory>
 #include <stdexcept>
 
 namespace sdl {
@@ -44,6 +46,23 @@ T* check(T* ptr)
 
 } // namespace img
 
+namespace ttf {
+
+namespace {
+
+template <class T>
+T* check(T* ptr)
+{
+    if (ptr == nullptr) {
+        throw std::runtime_error{std::format("SDL_ttf: {}", TTF_GetError())};
+    }
+    return ptr;
+}
+
+} // namespace
+
+} // namespace ttf
+
 namespace sdl {
 
 Init::Init(uint32_t flags)
@@ -67,6 +86,55 @@ Window::Size Window::size()
     return size;
 }
 
+Surface Surface::convert(uint32_t format) const
+{
+    return Surface{check(SDL_ConvertSurfaceFormat(
+        const_cast<SDL_Surface*>(ptr()), format, 0))};
+}
+
+int Surface::w() const
+{
+    return ptr()->w;
+}
+
+int Surface::h() const
+{
+    return ptr()->h;
+}
+
+int Surface::pitch() const
+{
+    return ptr()->pitch;
+}
+
+const void* Surface::pixels() const
+{
+    return ptr()->pixels;
+}
+
+const void* Surface::pixels(int x, int y) const
+{
+    return static_cast<const std::byte*>(ptr()->pixels) +
+        y * ptr()->pitch + x * ptr()->format->BytesPerPixel;
+}
+
+Texture::Size Texture::size()
+{
+    auto size = Size{};
+    check(SDL_QueryTexture(ptr(), nullptr, nullptr, &size.w, &size.h));
+    return size;
+}
+
+void Texture::update(const SDL_Rect* rect, const void* pixels, int pitch)
+{
+    check(SDL_UpdateTexture(ptr(), rect, pixels, pitch));
+}
+
+void Texture::blendMode(SDL_BlendMode mode)
+{
+    check(SDL_SetTextureBlendMode(ptr(), mode));
+}
+
 Renderer::Renderer(Window& window, int index, uint32_t flags)
     : Holder(check(SDL_CreateRenderer(window.ptr(), index, flags)))
 { }
@@ -82,6 +150,11 @@ Texture Renderer::loadTexture(const void* data, size_t size)
     return loadTexture({reinterpret_cast<const std::byte*>(data), size});
 }
 
+Texture Renderer::createTexture(uint32_t format, int access, int w, int h)
+{
+    return Texture{check(SDL_CreateTexture(ptr(), format, access, w, h))};
+}
+
 void Renderer::copy(
     Texture& texture, const SDL_Rect* srcrect, const SDL_Rect* dstrect)
 {
@@ -98,6 +171,68 @@ void Renderer::copy(Texture& texture, const SDL_Rect& srcrect, const SDL_FRect&
     copy(texture, &srcrect, &dstrect);
 }
 
+void Renderer::copy(Texture& texture)
+{
+    check(SDL_RenderCopy(ptr(), texture.ptr(), nullptr, nullptr));
+}
+
+void Renderer::geometry(
+    Texture& texture,
+    std::span<const SDL_Vertex> vertices,
+    std::span<const int> indices)
+{
+    check(SDL_RenderGeometry(
+        ptr(),
+        texture.ptr(),
+        vertices.data(),
+        static_cast<int>(vertices.size()),
+        indices.data(),
+        static_cast<int>(indices.size())));
+}
+
+void Renderer::geometry(
+    std::span<const SDL_Vertex> vertices, std::span<const int> indices)
+{
+    check(SDL_RenderGeometry(
+        ptr(),
+        nullptr,
+        vertices.data(),
+        static_cast<int>(vertices.size()),
+        indices.data(),
+        static_cast<int>(indices.size())));
+}
+
+void Renderer::target(Texture* texture)
+{
+    check(SDL_SetRenderTarget(ptr(), texture ? texture->ptr() : nullptr));
+}
+
+void Renderer::clipRect(const SDL_Rect* rect)
+{
+    check(SDL_RenderSetClipRect(ptr(), rect));
+}
+
+void Renderer::drawColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+    check(SDL_SetRenderDrawColor(ptr(), r, g, b, a));
+}
+
+void Renderer::drawBlendMode(SDL_BlendMode mode)
+{
+    check(SDL_SetRenderDrawBlendMode(ptr(), mode));
+}
+
+void Renderer::fillRect(const SDL_Rect& rect)
+{
+    check(SDL_RenderFillRect(ptr(), &rect));
+}
+
+void Renderer::readPixels(
+    const SDL_Rect* rect, uint32_t format, void* pixels, int pitch)
+{
+    check(SDL_RenderReadPixels(ptr(), rect, format, pixels, pitch));
+}
+
 void Renderer::clear()
 {
     check(SDL_RenderClear(ptr()));
@@ -123,6 +258,53 @@ const SDL_RWops* RW::ptr() const
     return _ptr.get();
 }
 
+AudioDevice::AudioDevice(
+    const SDL_AudioSpec& desired, SDL_AudioSpec& obtained, int allowedChanges)
+    : _id(SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, allowedChanges))
+{
+    if (_id == 0) {
+        throw std::runtime_error{std::format("SDL: {}", SDL_GetError())};
+    }
+}
+
+AudioDevice::~AudioDevice()
+{
+    SDL_CloseAudioDevice(_id);
+}
+
+void AudioDevice::pause(bool paused)
+{
+    SDL_PauseAudioDevice(_id, paused ? 1 : 0);
+}
+
+std::vector<float> decodeWav(
+    std::span<const std::byte> mem, int frequency, int channels)
+{
+    auto rw = RW{mem};
+    auto spec = SDL_AudioSpec{};
+    Uint8* buffer = nullptr;
+    Uint32 length = 0;
+    check(SDL_LoadWAV_RW(rw.ptr(), 0, &spec, &buffer, &length));
+    auto wav = std::unique_ptr<Uint8, void(*)(Uint8*)>{buffer, SDL_FreeWAV};
+
+    auto cvt = SDL_AudioCVT{};
+    if (SDL_BuildAudioCVT(
+            &cvt, spec.format, spec.channels, spec.freq,
+            AUDIO_F32SYS, static_cast<Uint8>(channels), frequency) < 0) {
+        throw std::runtime_error{std::format("SDL: {}", SDL_GetError())};
+    }
+
+    auto work = std::vector<Uint8>(static_cast<size_t>(length) * cvt.len_mult);
+    std::memcpy(work.data(), wav.get(), length);
+    cvt.buf = work.data();
+    cvt.len = static_cast<int>(length);
+    check(SDL_ConvertAudio(&cvt));
+
+    auto samples = std::vector<float>(cvt.len_cvt / sizeof(float));
+    std::memcpy(samples.data(), work.data(), samples.size() * sizeof(float));
+    return samples;
+}
+
 } // namespace sdl
 
 namespace img {
@@ -139,4 +321,59 @@ Init::~Init()
     IMG_Quit();
 }
 
-} // namespace img
\ No newline at end of file
+sdl::Surface load(std::span<const std::byte> mem)
+{
+    auto rw = sdl::RW{mem};
+    return sdl::Surface{check(IMG_Load_RW(rw.ptr(), 0))};
+}
+
+} // namespace img
+namespace ttf {
+
+Init::Init()
+{
+    if (TTF_Init() != 0) {
+        throw std::runtime_error{std::format("SDL_ttf: {}", TTF_GetError())};
+    }
+}
+
+Init::~Init()
+{
+    TTF_Quit();
+}
+
+// The font closes the RWops, but not the memory behind it
+Font::Font(std::span<const std::byte> mem, int pointSize)
+    : Holder(check(TTF_OpenFontRW(
+        sdl::check(SDL_RWFromConstMem(mem.data(), (int)mem.size())),
+        1,
+        pointSize)))
+{ }
+
+int Font::ascent()
+{
+    return TTF_FontAscent(ptr());
+}
+
+int Font::lineSkip()
+{
+    return TTF_FontLineSkip(ptr());
+}
+
+int Font::advance(char32_t codepoint)
+{
+    int advance = 0;
+    if (TTF_GlyphMetrics32(
+            ptr(), codepoint, nullptr, nullptr, nullptr, nullptr, &advance) != 0) {
+        throw std::runtime_error{std::format("SDL_ttf: {}", TTF_GetError())};
+    }
+    return advance;
+}
+
+sdl::Surface Font::renderGlyph(char32_t codepoint)
+{
+    return sdl::Surface{check(TTF_RenderGlyph32_Blended(
+        ptr(), codepoint, SDL_Color{255, 255, 255, 255}))};
+}
+
+} // namespace ttf